@@ -0,0 +1,1032 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Bench.cpp - repeatable benchmarks for the hc12Radio library
+ *
+ *  Every result is written as one JSON object per line (to stdout or
+ *  the --output file), so runs of different releases can be compared
+ *  by scripts.
+ *
+ *  The micro benchmarks (response parsing, command formatting, AT
+ *  round trips over an in-memory loopback) need no device. Command
+ *  round trips and transparent mode throughput run against a device,
+ *  normally the pty of hc12Emulator. Given --emulator
+ *  the benchmark starts the emulator itself and drives its SET "pin"
+ *  by signals, which allows a throughput sweep over all baud rates.
+ *
+ ***********************************************************************
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ *
+ * Options:
+ *
+ * --com devicename (same as --com=devicename resp. -c devicename)
+ *
+ *   run round trips against devicename, the module has to be in
+ *   command mode. Without --com and --emulator only the micro
+ *   benchmarks run.
+ *
+ * --emulator path (same as --emulator=path resp. -E path)
+ *
+ *   start the emulator binary path on a private pty and run all
+ *   benchmarks against it
+ *
+ * --latency scale (same as --latency=scale resp. -t scale)
+ *
+ *   latency scale handed to the emulator, default is --latency=1.0
+ *
+ * --iterations n (same as --iterations=n resp. -n n)
+ *
+ *   amount of round trips per command, default is --iterations=20.
+ *   Micro benchmarks run a fixed time instead.
+ *
+ * --output file (same as --output=file resp. -o file)
+ *
+ *   write the results to file instead of stdout, which keeps them
+ *   apart from diagnostic output of the library
+ *
+ * --help     (same as -? )
+ *
+ *   Show options and exit
+ *
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "hc12Radio.h"
+#include "hc12Crc.h"
+
+/*
+ ****************************************************************************
+*/
+
+#define BENCH_MICRO_NS        200000000ULL     // per micro benchmark
+#define BENCH_DEFAULT_ITER    20
+#define BENCH_TT_SECONDS      0.25             // payload per baud rate
+#define BENCH_TT_CHUNK        32
+#define BENCH_TT_SETTLE_US    20000
+#define BENCH_MAX_SAMPLES     1000
+
+struct _bench_param {
+    char    *device;
+    char    *emulator;
+    char    *latency;
+    char    *output;
+    int      iterations;
+};
+
+static struct _bench_param benchParam;
+static FILE *benchOut;
+static pid_t emuPid = -1;
+static char emuLink[64];
+
+// keeps the compiler from dropping the measured work
+static volatile int benchSink;
+
+/* ----------------------------------------------------------------------------
+ | uint64_t nowNs( void )
+ ------------------------------------------------------------------------------
+*/
+
+static uint64_t nowNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+/* ----------------------------------------------------------------------------
+ | void jsonString( const char *pText )
+ |
+ | print pText as JSON string, control characters escaped
+ ------------------------------------------------------------------------------
+*/
+
+static void jsonString( const char *pText )
+{
+    fputc( '"', benchOut );
+    for( ; *pText != '\0'; pText++ )
+    {
+        switch( *pText )
+        {
+            case '"':
+            case '\\':
+                fprintf( benchOut, "\\%c", *pText );
+                break;
+            case '\r':
+                fprintf( benchOut, "\\r" );
+                break;
+            case '\n':
+                fprintf( benchOut, "\\n" );
+                break;
+            default:
+                fputc( *pText, benchOut );
+                break;
+        }
+    }
+    fputc( '"', benchOut );
+}
+
+/* ----------------------------------------------------------------------------
+ | void reportMicro( const char *pBench, const char *pCase,
+ |                   uint64_t ops, uint64_t ns )
+ ------------------------------------------------------------------------------
+*/
+
+static void reportMicro( const char *pBench, const char *pCase,
+                         uint64_t ops, uint64_t ns )
+{
+    fprintf( benchOut, "{\"bench\":\"%s\",\"case\":", pBench );
+    jsonString( pCase );
+    fprintf( benchOut, ",\"ops\":%llu,\"ns_per_op\":%.2f}\n",
+            (unsigned long long) ops, (double) ns / ops );
+    fflush( benchOut );
+}
+
+/*
+ ****************************************************************************
+ | micro benchmarks
+ ****************************************************************************
+*/
+
+//
+// one entry per response form, plus the multi line AT+RX reply and
+// the version string with its vendor prefix
+//
+static const char *benchResponses[] = {
+    "OK\r\n",
+    "OK+DEFAULT\r\n",
+    "OK+SLEEP\r\n",
+    "OK+B9600\r\n",
+    "OK+C021\r\n",
+    "OK+RC021\r\n",
+    "OK+FU3\r\n",
+    "OK+P8\r\n",
+    "OK+RP:+20dBm\r\n",
+    "OK+U8N1\r\n",
+    "HC-12_V2.4\r\n",
+    "www.hc01.com  HC-12_V2.4\r\n",
+    "ERROR\r\n",
+    "OK+FU3\r\nOK+B9600\r\nOK+RC001\r\nOK+RP:+20dBm\r\n",
+    NULL
+};
+
+/* ----------------------------------------------------------------------------
+ | void benchParse( void )
+ |
+ | feed every response form through the parser, ns per complete reply
+ ------------------------------------------------------------------------------
+*/
+
+static void benchParse( void )
+{
+    hc12Parser parser;
+    const char *pRsp;
+    uint64_t start;
+    uint64_t ops;
+    int i;
+
+    for( i = 0; (pRsp = benchResponses[i]) != NULL; i++ )
+    {
+        ops = 0;
+        start = nowNs();
+        do
+        {
+            for( int n = 0; n < 1000; n++ )
+            {
+                parser.reset();
+                for( const char *p = pRsp; *p != '\0'; p++ )
+                {
+                    if( parser.feed( *p ) == HC12_PARSE_LINE )
+                    {
+                        benchSink += parser.response()->type;
+                    }
+                }
+            }
+            ops += 1000;
+        } while( nowNs() - start < BENCH_MICRO_NS );
+
+        reportMicro( "parse", pRsp, ops, nowNs() - start );
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | void benchFormat( hc12Radio *pRadio )
+ |
+ | build the set commands the way applyParam() does
+ ------------------------------------------------------------------------------
+*/
+
+static void benchFormat( hc12Radio *pRadio )
+{
+    static const struct {
+        const char *name;
+        int field;
+        int value;
+    } cases[] = {
+        { "AT+C%03d", HC12_PARAM_FIELD_CHANNEL, 21 },
+        { "AT+P%d",   HC12_PARAM_FIELD_POWER,   HC12_POWER_20_DBM },
+        { "AT+FU%d",  HC12_PARAM_FIELD_TTMODE,  HC12_TTMODE_FU3 },
+        { "AT+B%u",   HC12_PARAM_FIELD_BAUD,    HC12_BAUD_115200 },
+    };
+    char buffer[IO_BUFFER_SIZE];
+    uint64_t start;
+    uint64_t ops;
+    unsigned int i;
+
+    for( i = 0; i < sizeof(cases) / sizeof(cases[0]); i++ )
+    {
+        ops = 0;
+        start = nowNs();
+        do
+        {
+            for( int n = 0; n < 1000; n++ )
+            {
+                benchSink += pRadio->formatSetCommand( cases[i].field,
+                                                       cases[i].value,
+                                                       buffer );
+            }
+            ops += 1000;
+        } while( nowNs() - start < BENCH_MICRO_NS );
+
+        reportMicro( "format", cases[i].name, ops, nowNs() - start );
+    }
+
+    ops = 0;
+    start = nowNs();
+    do
+    {
+        for( int n = 0; n < 1000; n++ )
+        {
+            benchSink += hc12FormatCommand( HC12_CMD_CODE_SET_SERIAL,
+                                  HC12_SERIAL_ARG( 8, 'N', 1 ), buffer );
+        }
+        ops += 1000;
+    } while( nowNs() - start < BENCH_MICRO_NS );
+
+    reportMicro( "format", "AT+U%d%c%d", ops, nowNs() - start );
+}
+
+/* ----------------------------------------------------------------------------
+ | void benchChecksum( void )
+ |
+ | checksums over a short command, a frame and a bulk block. crc32c runs
+ | on the kernel picked at startup ("crc32c sse4.2 256") and on the
+ | portable one for comparison.
+ ------------------------------------------------------------------------------
+*/
+
+static void benchChecksum( void )
+{
+    static const size_t sizes[] = { 8, 64, 256, 4096 };
+    static uint8_t data[4096];
+    char name[64];
+    uint64_t start;
+    uint64_t ops;
+    unsigned int i;
+    int kernel;
+
+    for( i = 0; i < sizeof(data); i++ )
+    {
+        data[i] = (uint8_t) (i * 31 + 7);
+    }
+
+    for( i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ )
+    {
+        for( kernel = 0; kernel < 3; kernel++ )
+        {
+            ops = 0;
+            start = nowNs();
+            do
+            {
+                for( int n = 0; n < 1000; n++ )
+                {
+                    switch( kernel )
+                    {
+                        case 0:
+                            benchSink += hc12Crc16( HC12_CRC16_INIT,
+                                                    data, sizes[i] );
+                            break;
+                        case 1:
+                            benchSink += hc12Crc32cPortable(
+                                         HC12_CRC32C_INIT, data, sizes[i] );
+                            break;
+                        default:
+                            benchSink += hc12Crc32c( HC12_CRC32C_INIT,
+                                                     data, sizes[i] );
+                            break;
+                    }
+                }
+                ops += 1000;
+            } while( nowNs() - start < BENCH_MICRO_NS );
+
+            if( kernel == 0 )
+            {
+                snprintf( name, sizeof(name), "crc16 %u",
+                          (unsigned) sizes[i] );
+            }
+            else
+            {
+                snprintf( name, sizeof(name), "crc32c %s %u",
+                          kernel == 1 ? "portable" : hc12Crc32cKernel(),
+                          (unsigned) sizes[i] );
+            }
+            reportMicro( "checksum", name, ops, nowNs() - start );
+        }
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | int answerLines( hc12LoopbackEnd *pModule )
+ |
+ | module side of the loopback: take what the radio wrote in place and
+ | put an OK for each line straight into the radio's input
+ | returns the amount of lines answered
+ ------------------------------------------------------------------------------
+*/
+
+static int answerLines( hc12LoopbackEnd *pModule )
+{
+    static const char ok[] = "OK\r\n";
+    const uint8_t *pData;
+    uint8_t *pReply;
+    size_t len;
+    size_t i;
+    int retVal = 0;
+
+    while( (len = pModule->peek( &pData )) > 0 )
+    {
+        for( i = 0; i < len; i++ )
+        {
+            if( pData[i] == '\n' &&
+                pModule->reserve( &pReply ) >= sizeof(ok) - 1 )
+            {
+                memcpy( pReply, ok, sizeof(ok) - 1 );
+                pModule->commit( sizeof(ok) - 1 );
+                retVal++;
+            }
+        }
+        pModule->consume( len );
+    }
+
+    return( retVal );
+}
+
+static volatile bool responderRun;
+
+/* ----------------------------------------------------------------------------
+ | void* responderThread( void *pArg )
+ ------------------------------------------------------------------------------
+*/
+
+static void* responderThread( void *pArg )
+{
+    hc12LoopbackEnd *pModule = (hc12LoopbackEnd*) pArg;
+
+    while( responderRun )
+    {
+        if( pModule->waitData( 10 ) )
+        {
+            answerLines( pModule );
+        }
+    }
+
+    return( NULL );
+}
+
+/* ----------------------------------------------------------------------------
+ | void benchLoopback( void )
+ |
+ | AT round trips over an in-memory loopback, no kernel tty involved.
+ | "inline" plays the module in the same thread through the non-blocking
+ | API and the zero copy access of both ends, so it is the cost of the
+ | library alone. "thread" runs the blocking test() against a responder
+ | thread and adds the hand over between two cores.
+ ------------------------------------------------------------------------------
+*/
+
+static void benchLoopback( void )
+{
+    hc12Loopback loop;
+    hc12Radio *pRadio;
+    pthread_t responder;
+    const uint8_t *pData;
+    size_t len;
+    uint64_t start;
+    uint64_t ops;
+    int rc;
+
+    if( loop.open() != 0 )
+    {
+        fprintf(stderr, "hc12Bench: loopback not available\n");
+        return;
+    }
+
+    pRadio = new hc12Radio( loop.a() );
+
+    if( pRadio->connect( NULL ) == E_OK &&
+        pRadio->enterCommandMode() == HC12_ERR_OK )
+    {
+        ops = 0;
+        start = nowNs();
+        do
+        {
+            for( int n = 0; n < 1000; n++ )
+            {
+                rc = pRadio->startRequest( HC12_CMD_CODE_TEST );
+                answerLines( loop.b() );
+                while( rc == HC12_ERR_OK &&
+                       (len = loop.a()->peek( &pData )) > 0 )
+                {
+                    rc = pRadio->feedResponse( (const char*) pData, len );
+                    loop.a()->consume( len );
+                }
+                benchSink += rc;
+            }
+            ops += 1000;
+        } while( nowNs() - start < BENCH_MICRO_NS );
+
+        reportMicro( "loopback", "AT inline", ops, nowNs() - start );
+
+        responderRun = true;
+        if( pthread_create( &responder, NULL, responderThread,
+                            loop.b() ) == 0 )
+        {
+            ops = 0;
+            start = nowNs();
+            do
+            {
+                for( int n = 0; n < 100; n++ )
+                {
+                    benchSink += pRadio->test();
+                }
+                ops += 100;
+            } while( nowNs() - start < BENCH_MICRO_NS );
+
+            reportMicro( "loopback", "AT thread", ops, nowNs() - start );
+
+            responderRun = false;
+            pthread_join( responder, NULL );
+        }
+
+        pRadio->disconnect();
+    }
+
+    delete pRadio;
+    loop.close();
+}
+
+/*
+ ****************************************************************************
+ | device benchmarks
+ ****************************************************************************
+*/
+
+/* ----------------------------------------------------------------------------
+ | int compareU64( const void *pA, const void *pB )
+ ------------------------------------------------------------------------------
+*/
+
+static int compareU64( const void *pA, const void *pB )
+{
+    uint64_t a = *(const uint64_t*) pA;
+    uint64_t b = *(const uint64_t*) pB;
+
+    return( a < b ? -1 : (a > b ? 1 : 0) );
+}
+
+/* ----------------------------------------------------------------------------
+ | void reportRoundTrip( const char *pCase, uint64_t *pSamples, int count,
+ |                       int failed )
+ ------------------------------------------------------------------------------
+*/
+
+static void reportRoundTrip( const char *pCase, uint64_t *pSamples,
+                             int count, int failed )
+{
+    uint64_t sum = 0;
+    int i;
+
+    qsort( pSamples, count, sizeof(uint64_t), compareU64 );
+
+    for( i = 0; i < count; i++ )
+    {
+        sum += pSamples[i];
+    }
+
+    fprintf( benchOut, "{\"bench\":\"roundtrip\",\"case\":\"%s\",\"ops\":%d,"
+            "\"failed\":%d", pCase, count, failed );
+    if( count > 0 )
+    {
+        fprintf( benchOut, ",\"mean_us\":%.1f,\"min_us\":%.1f,\"p50_us\":%.1f,"
+                "\"p90_us\":%.1f,\"max_us\":%.1f",
+                sum / 1000.0 / count, pSamples[0] / 1000.0,
+                pSamples[count / 2] / 1000.0,
+                pSamples[(count * 9) / 10] / 1000.0,
+                pSamples[count - 1] / 1000.0 );
+    }
+    fprintf( benchOut, "}\n" );
+    fflush( benchOut );
+}
+
+/* ----------------------------------------------------------------------------
+ | void setMode( hc12Radio *pRadio, int mode )
+ |
+ | switch library and module, the emulator gets its SET "pin" by signal
+ ------------------------------------------------------------------------------
+*/
+
+static void setMode( hc12Radio *pRadio, int mode )
+{
+    if( mode == HC12_OP_CMD_MODE )
+    {
+        if( emuPid > 0 )
+        {
+            kill( emuPid, SIGUSR1 );
+        }
+        pRadio->enterCommandMode();
+    }
+    else
+    {
+        pRadio->leaveCommandMode();
+        if( emuPid > 0 )
+        {
+            kill( emuPid, SIGUSR2 );
+        }
+    }
+
+    usleep( BENCH_TT_SETTLE_US );
+}
+
+/* ----------------------------------------------------------------------------
+ | void benchRoundTrips( hc12Radio *pRadio )
+ |
+ | time complete commands from the call to the return of the library
+ ------------------------------------------------------------------------------
+*/
+
+static void benchRoundTrips( hc12Radio *pRadio )
+{
+    static const char *names[] = {
+        "test", "getBaud", "getComChannel", "getTTMode", "getTPower",
+        "getParam", "getFWVersion", "setComChannel", "setTPower",
+        "applyParam", NULL
+    };
+    uint64_t samples[BENCH_MAX_SAMPLES];
+    struct _hc12_param param;
+    uint64_t start;
+    int iterations = benchParam.iterations;
+    int count;
+    int failed;
+    int rc = HC12_ERR_OK;
+    int c;
+    int i;
+
+    if( iterations > BENCH_MAX_SAMPLES )
+    {
+        iterations = BENCH_MAX_SAMPLES;
+    }
+
+    setMode( pRadio, HC12_OP_CMD_MODE );
+
+    for( c = 0; names[c] != NULL; c++ )
+    {
+        count = failed = 0;
+
+        for( i = 0; i < iterations; i++ )
+        {
+            start = nowNs();
+            switch( c )
+            {
+                case 0:
+                    rc = pRadio->test();
+                    break;
+                case 1:
+                    rc = pRadio->getBaud( HC12_READ_REFRESH );
+                    break;
+                case 2:
+                    rc = pRadio->getComChannel( HC12_READ_REFRESH );
+                    break;
+                case 3:
+                    rc = pRadio->getTTMode( HC12_READ_REFRESH );
+                    break;
+                case 4:
+                    rc = pRadio->getTPower( HC12_READ_REFRESH );
+                    break;
+                case 5:
+                    rc = pRadio->getParam( HC12_READ_REFRESH );
+                    break;
+                case 6:
+                    rc = pRadio->getFWVersion( HC12_READ_REFRESH );
+                    break;
+                case 7:
+                    rc = pRadio->setComChannel( 1 + (i % 2) );
+                    break;
+                case 8:
+                    rc = pRadio->setTPower( HC12_POWER_17_DBM + (i % 2) );
+                    break;
+                case 9:
+                    // two fields differ each time
+                    pRadio->getCachedParam( &param );
+                    param.comChannel = 3 + (i % 2);
+                    param.power = HC12_POWER_11_DBM + (i % 2);
+                    rc = pRadio->applyParam( &param );
+                    break;
+            }
+
+            if( rc >= 0 )
+            {
+                samples[count++] = nowNs() - start;
+            }
+            else
+            {
+                failed++;
+            }
+        }
+
+        reportRoundTrip( names[c], samples, count, failed );
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | void benchThroughput( hc12Radio *pRadio, uint32_t baud )
+ |
+ | send a paced payload in transparent mode and take the echo of the
+ | emulator back, the result is the effective end to end rate
+ ------------------------------------------------------------------------------
+*/
+
+static void benchThroughput( hc12Radio *pRadio, uint32_t baud )
+{
+    uint8_t chunk[BENCH_TT_CHUNK];
+    uint8_t rxBuffer[1024];
+    size_t payload = (size_t) (baud / 10 * BENCH_TT_SECONDS);
+    size_t sent = 0;
+    size_t received = 0;
+    uint64_t chunkNs = (uint64_t) BENCH_TT_CHUNK * 10 * 1000000000ULL / baud;
+    uint64_t start;
+    uint64_t last;
+    uint64_t deadline;
+    int rc;
+
+    if( payload < 2 * BENCH_TT_CHUNK )
+    {
+        payload = 2 * BENCH_TT_CHUNK;
+    }
+
+    memset( chunk, 0x55, sizeof(chunk) );
+
+    while( pRadio->receive( rxBuffer, sizeof(rxBuffer) ) > 0 )
+    {
+        ;
+    }
+
+    start = last = nowNs();
+    deadline = start + (uint64_t) payload * 10 * 1000000000ULL / baud * 4
+                     + 2000000000ULL;
+
+    while( (sent < payload || received < sent) && nowNs() < deadline )
+    {
+        // a UART would not deliver faster than the baud rate either
+        if( sent < payload && nowNs() >= start + (sent / BENCH_TT_CHUNK) * chunkNs )
+        {
+            if( (rc = pRadio->send( chunk, sizeof(chunk) )) > 0 )
+            {
+                sent += rc;
+            }
+        }
+
+        if( (rc = pRadio->receive( rxBuffer, sizeof(rxBuffer) )) > 0 )
+        {
+            received += rc;
+            last = nowNs();
+        }
+        else
+        {
+            usleep( 200 );
+        }
+    }
+
+    fprintf( benchOut, "{\"bench\":\"throughput\",\"case\":\"%u\",\"baud\":%u,"
+            "\"sent\":%zu,\"received\":%zu,\"lost\":%zu,"
+            "\"seconds\":%.3f,\"bytes_per_s\":%.1f}\n",
+            baud, baud, sent, received,
+            sent > received ? sent - received : 0,
+            (last - start) / 1e9,
+            received > 0 ? received / ((last - start) / 1e9) : 0.0 );
+    fflush( benchOut );
+}
+
+/* ----------------------------------------------------------------------------
+ | void benchBaudSweep( hc12Radio *pRadio )
+ |
+ | throughput at every baud rate the module supports
+ ------------------------------------------------------------------------------
+*/
+
+static void benchBaudSweep( hc12Radio *pRadio )
+{
+    static const uint32_t bauds[] = {
+        HC12_BAUD_1200, HC12_BAUD_2400, HC12_BAUD_4800, HC12_BAUD_9600,
+        HC12_BAUD_19200, HC12_BAUD_38400, HC12_BAUD_57600, HC12_BAUD_115200
+    };
+    unsigned int i;
+    int rc;
+
+    for( i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++ )
+    {
+        setMode( pRadio, HC12_OP_CMD_MODE );
+        if( (rc = pRadio->setBaud( bauds[i] )) == HC12_ERR_OK )
+        {
+            // the new rate is used after leaving command mode
+            setMode( pRadio, HC12_OP_TT_MODE );
+            benchThroughput( pRadio, bauds[i] );
+        }
+        else
+        {
+            fprintf( benchOut, "{\"bench\":\"throughput\",\"case\":\"%u\","
+                    "\"error\":\"setBaud\",\"rc\":%d}\n", bauds[i], rc );
+        }
+    }
+
+    setMode( pRadio, HC12_OP_CMD_MODE );
+    pRadio->setBaud( HC12_DEFAULT_BAUD );
+}
+
+/*
+ ****************************************************************************
+ | emulator control
+ ****************************************************************************
+*/
+
+/* ----------------------------------------------------------------------------
+ | bool startEmulator( void )
+ |
+ | fork the emulator with echo on a private link and wait for the link
+ ------------------------------------------------------------------------------
+*/
+
+static bool startEmulator( void )
+{
+    bool retVal = false;
+    struct stat st;
+    int i;
+
+    snprintf( emuLink, sizeof(emuLink), "/tmp/hc12Bench.%d", (int) getpid() );
+
+    if( (emuPid = fork()) == 0 )
+    {
+        // keep the JSON output clean
+        freopen( "/dev/null", "w", stdout );
+        execl( benchParam.emulator, benchParam.emulator,
+               "--link", emuLink, "--echo",
+               "--latency", benchParam.latency, (char*) NULL );
+        perror( "hc12Bench: emulator" );
+        _exit( 1 );
+    }
+
+    for( i = 0; emuPid > 0 && i < 200 && !retVal; i++ )
+    {
+        if( lstat( emuLink, &st ) == 0 )
+        {
+            retVal = true;
+        }
+        else
+        {
+            usleep( 10000 );
+        }
+    }
+
+    return( retVal );
+}
+
+/* ----------------------------------------------------------------------------
+ | void stopEmulator( void )
+ ------------------------------------------------------------------------------
+*/
+
+static void stopEmulator( void )
+{
+    if( emuPid > 0 )
+    {
+        kill( emuPid, SIGTERM );
+        waitpid( emuPid, NULL, 0 );
+        unlink( emuLink );
+        emuPid = -1;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | void help( short failed )
+ |
+ | show options and exit
+ ------------------------------------------------------------------------------
+*/
+
+static void help( short failed )
+{
+    fprintf(stderr, "hc12Radio benchmarks, JSON lines on stdout\n");
+    fprintf(stderr, "valid options are:\n");
+    fprintf(stderr,
+        "--com devicename (same as --com=devicename resp. -c devicename)\n");
+    fprintf(stderr, "run round trips against a module in command mode\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--emulator path (same as --emulator=path resp. -E path)\n");
+    fprintf(stderr, "start emulator path and run all benchmarks against it\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--latency scale (same as --latency=scale resp. -t scale)\n");
+    fprintf(stderr, "latency scale of the emulator\n");
+    fprintf(stderr, "Default is --latency=1.0\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--iterations n (same as --iterations=n resp. -n n)\n");
+    fprintf(stderr, "round trips per command\n");
+    fprintf(stderr, "Default is --iterations=%d\n", BENCH_DEFAULT_ITER);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--output file (same as --output=file resp. -o file)\n");
+    fprintf(stderr, "write results to file, default is stdout\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--help     (same as -? )\n");
+    fprintf(stderr, "display help info\n");
+
+    exit(failed);
+}
+
+/* ----------------------------------------------------------------------------
+ | void get_arguments ( int argc, char **argv )
+ |
+ | scan commandline for arguments an set the corresponding value
+ ------------------------------------------------------------------------------
+*/
+
+static void get_arguments ( int argc, char **argv )
+{
+    int next_option;
+    const char* const short_options = "c:E:t:n:o:?";
+
+    const struct option long_options[] = {
+         { "com",        1, NULL, 'c' },
+         { "emulator",   1, NULL, 'E' },
+         { "latency",    1, NULL, 't' },
+         { "iterations", 1, NULL, 'n' },
+         { "output",     1, NULL, 'o' },
+         { "help",       0, NULL, '?' },
+         { NULL,         0, NULL,  0  }
+    };
+
+    benchParam.device = NULL;
+    benchParam.emulator = NULL;
+    benchParam.latency = strdup( "1.0" );
+    benchParam.output = NULL;
+    benchParam.iterations = BENCH_DEFAULT_ITER;
+
+    do
+    {
+        next_option = getopt_long (argc, argv, short_options,
+            long_options, NULL);
+
+        switch (next_option) {
+            case 'c':
+                benchParam.device = strdup( optarg );
+                break;
+            case 'E':
+                benchParam.emulator = strdup( optarg );
+                break;
+            case 't':
+                benchParam.latency = strdup( optarg );
+                break;
+            case 'n':
+                if( (benchParam.iterations = atoi(optarg)) < 1 )
+                {
+                    help( 1 );
+                }
+                break;
+            case 'o':
+                benchParam.output = strdup( optarg );
+                break;
+            case '?':
+                help( 0 );
+                break;
+            case -1:
+                break;
+            default:
+                fprintf(stderr, "Invalid option %c! \n", next_option);
+                help( 1 );
+        }
+    } while (next_option != -1);
+}
+
+/*
+ ****************************************************************************
+*/
+
+int main( int argc, char *argv[] )
+{
+    int retVal = 0;
+    hc12Radio *pRadio;
+    struct _hc12_serial_param serialParam;
+
+    get_arguments( argc, argv );
+
+    benchOut = stdout;
+    if( benchParam.output != NULL &&
+        (benchOut = fopen( benchParam.output, "w" )) == NULL )
+    {
+        perror( "hc12Bench: output" );
+        return( 1 );
+    }
+
+    fprintf( benchOut, "{\"bench\":\"meta\",\"time\":%ld,\"iterations\":%d,"
+            "\"latency\":%s,\"target\":\"%s\"}\n",
+            (long) time( NULL ), benchParam.iterations, benchParam.latency,
+            benchParam.emulator != NULL ? "emulator" :
+            (benchParam.device != NULL ? "device" : "none") );
+
+    pRadio = new hc12Radio();
+    pRadio->init();
+
+    benchParse();
+    benchFormat( pRadio );
+    benchChecksum();
+    benchLoopback();
+
+    if( benchParam.emulator != NULL )
+    {
+        if( startEmulator() )
+        {
+            benchParam.device = emuLink;
+        }
+        else
+        {
+            fprintf(stderr, "hc12Bench: emulator did not come up\n");
+            stopEmulator();
+            retVal = 1;
+        }
+    }
+
+    if( retVal == 0 && benchParam.device != NULL )
+    {
+        memset( &serialParam, '\0', sizeof(serialParam) );
+        serialParam.device = benchParam.device;
+        serialParam.baud = HC12_DEFAULT_BAUD;
+        serialParam.databit = HC12_DEFAULT_DATABIT;
+        serialParam.parity = HC12_DEFAULT_PARITY;
+        serialParam.stopbits = HC12_DEFAULT_STOPBITS;
+        serialParam.handshake = HC12_DEFAULT_HANDSHAKE;
+
+        if( pRadio->connect( &serialParam ) == E_OK )
+        {
+            benchRoundTrips( pRadio );
+
+            // changing the baud rate needs control over the SET pin
+            if( emuPid > 0 )
+            {
+                benchBaudSweep( pRadio );
+            }
+
+            pRadio->disconnect();
+        }
+        else
+        {
+            fprintf(stderr, "hc12Bench: cannot connect to %s\n",
+                    benchParam.device);
+            retVal = 1;
+        }
+    }
+
+    stopEmulator();
+    delete pRadio;
+
+    if( benchOut != stdout )
+    {
+        fclose( benchOut );
+    }
+
+    return( retVal );
+}
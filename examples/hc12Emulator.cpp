@@ -0,0 +1,861 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Emulator.cpp - a pseudo terminal stand-in for a HC-12 board
+ *
+ *  The emulator opens a pty master and prints the name of the slave
+ *  device. Point the library (or hc12Test -c ...) to that device to
+ *  talk to a software HC-12 instead of real hardware.
+ *
+ *  There is no SET pin on a pty, so the emulator starts in command
+ *  mode. Send SIGUSR2 to switch to transparent mode (SET released)
+ *  and SIGUSR1 to go back to command mode (SET pulled low).
+ *
+ ***********************************************************************
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ *
+ * Options:
+ *
+ * --link path (same as --link=path resp. -l path)
+ *
+ *   create a symbolic link path pointing to the pty slave
+ *
+ * --latency scale (same as --latency=scale resp. -t scale)
+ *
+ *   multiply the per command latency by scale, 0 answers immediately
+ *
+ *   Default is --latency=1.0
+ *
+ * --echo     (same as -e )
+ *
+ *   in transparent mode send received data back after its airtime as
+ *   if a peer module echoed it. Otherwise the data is discarded.
+ *
+ * --mode cmd|tt (same as --mode=cmd resp. -m cmd)
+ *
+ *   mode to start in, default is --mode=cmd
+ *
+ * --buffer size (same as --buffer=size resp. -B size)
+ *
+ *   size of the emulated on-module transmit buffer in bytes
+ *
+ *   Default is --buffer=128
+ *
+ * --help     (same as -? )
+ *
+ *   Show options and exit
+ *
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+
+/*
+ ****************************************************************************
+*/
+
+#define EMU_VERSION          "HC-12_V2.4"
+
+#define EMU_LINE_SIZE        64
+#define EMU_OUT_SIZE       8192
+#define EMU_AIR_SIZE       8192
+
+// a command without line end is taken as complete after this idle time
+#define EMU_CMD_IDLE_US   20000
+
+#define EMU_MODE_CMD          1
+#define EMU_MODE_TT           3
+
+struct _emu_state {
+    uint32_t baud;
+    uint32_t pendingBaud;
+    int      channel;
+    int      ttMode;
+    int      power;
+    int      databits;
+    char     parity;
+    int      stopbits;
+    int      mode;
+    bool     sleeping;
+    bool     updating;
+};
+
+struct _emu_stats {
+    unsigned long commands;
+    unsigned long unknown;
+    unsigned long ttIn;
+    unsigned long ttOut;
+    unsigned long ttDropped;
+};
+
+struct _emu_param {
+    char    *link;
+    double   latencyScale;
+    bool     echo;
+    int      startMode;
+    size_t   bufferSize;
+};
+
+//
+// module response latency in microseconds, measured from the end of
+// the command to the first byte of the reply
+//
+#define EMU_LAT_TEST         12000
+#define EMU_LAT_READ         15000
+#define EMU_LAT_READ_ALL     40000
+#define EMU_LAT_WRITE        25000
+#define EMU_LAT_DEFAULT      60000
+#define EMU_LAT_SLEEP        20000
+#define EMU_LAT_VERSION      14000
+
+static const short emuDbm[] = { -1, 2, 5, 8, 11, 14, 17, 20 };
+
+static volatile sig_atomic_t emuModeRequest = 0;
+static volatile sig_atomic_t emuTerminate = 0;
+
+static struct _emu_state emu;
+static struct _emu_stats emuStats;
+static struct _emu_param emuParam;
+
+// reply bytes waiting for their due time
+static char     outBuffer[EMU_OUT_SIZE];
+static size_t   outLen = 0;
+static uint64_t outDue = 0;
+
+// data on its way over the air
+static char     airBuffer[EMU_AIR_SIZE];
+static size_t   airLen = 0;
+static uint64_t airNext = 0;
+
+/* ----------------------------------------------------------------------------
+ | uint64_t nowUs( void )
+ |
+ | monotonic time in microseconds
+ ------------------------------------------------------------------------------
+*/
+
+static uint64_t nowUs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000 );
+}
+
+/* ----------------------------------------------------------------------------
+ | uint32_t airRate( void )
+ |
+ | over the air data rate of the current FU mode in bits per second
+ ------------------------------------------------------------------------------
+*/
+
+static uint32_t airRate( void )
+{
+    uint32_t retVal;
+
+    switch( emu.ttMode )
+    {
+        case 1:
+        case 2:
+            retVal = 250000;
+            break;
+        case 4:
+            retVal = 500;
+            break;
+        case 3:
+        default:
+            if( emu.baud <= 1200 )
+            {
+                retVal = 5000;
+            }
+            else if( emu.baud <= 2400 )
+            {
+                retVal = 15000;
+            }
+            else if( emu.baud <= 9600 )
+            {
+                retVal = 58000;
+            }
+            else
+            {
+                retVal = 236000;
+            }
+            break;
+    }
+
+    return( retVal );
+}
+
+/* ----------------------------------------------------------------------------
+ | uint64_t byteTimeUs( void )
+ |
+ | time one payload byte occupies the link, whichever of serial port and
+ | air is slower (10 bit per byte on both)
+ ------------------------------------------------------------------------------
+*/
+
+static uint64_t byteTimeUs( void )
+{
+    uint32_t rate = airRate();
+
+    if( emu.baud < rate )
+    {
+        rate = emu.baud;
+    }
+
+    return( 10000000ULL / rate );
+}
+
+/* ----------------------------------------------------------------------------
+ | void setDefaults( void )
+ |
+ | factory defaults of a HC-12
+ ------------------------------------------------------------------------------
+*/
+
+static void setDefaults( void )
+{
+    emu.baud = emu.pendingBaud = 9600;
+    emu.channel = 1;
+    emu.ttMode = 3;
+    emu.power = 8;
+    emu.databits = 8;
+    emu.parity = 'N';
+    emu.stopbits = 1;
+}
+
+/* ----------------------------------------------------------------------------
+ | void reply( const char *pText, uint64_t latencyUs )
+ |
+ | schedule a response line. The reply shows up after the module latency
+ | and is paced with the serial port speed.
+ ------------------------------------------------------------------------------
+*/
+
+static void reply( const char *pText, uint64_t latencyUs )
+{
+    size_t len = strlen(pText);
+    uint64_t now = nowUs();
+    uint64_t due;
+
+    if( outLen + len + 2 <= EMU_OUT_SIZE )
+    {
+        due = now + (uint64_t) (latencyUs * emuParam.latencyScale);
+
+        if( outLen == 0 || due > outDue )
+        {
+            outDue = due;
+        }
+
+        memcpy( &outBuffer[outLen], pText, len );
+        outLen += len;
+        outBuffer[outLen++] = '\r';
+        outBuffer[outLen++] = '\n';
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | bool parseNumber( const char *pText, int digits, long *pValue )
+ |
+ | parse a decimal number consisting of at most digits digits
+ | digits < 0 means no limit
+ ------------------------------------------------------------------------------
+*/
+
+static bool parseNumber( const char *pText, int digits, long *pValue )
+{
+    bool retVal = false;
+    long value = 0;
+    int count = 0;
+
+    while( *pText >= '0' && *pText <= '9' && (digits < 0 || count < digits) )
+    {
+        value = value * 10 + (*pText++ - '0');
+        count++;
+    }
+
+    if( count > 0 && *pText == '\0' )
+    {
+        *pValue = value;
+        retVal = true;
+    }
+
+    return( retVal );
+}
+
+/* ----------------------------------------------------------------------------
+ | void handleCommand( char *pLine )
+ |
+ | execute one AT command and schedule the response
+ ------------------------------------------------------------------------------
+*/
+
+static void handleCommand( char *pLine )
+{
+    char answer[EMU_LINE_SIZE];
+    long value;
+    size_t len;
+
+    // strip trailing white space
+    len = strlen(pLine);
+    while( len > 0 && (pLine[len-1] == ' ' || pLine[len-1] == '\t') )
+    {
+        pLine[--len] = '\0';
+    }
+
+    if( len == 0 || emu.updating )
+    {
+        return;
+    }
+
+    emuStats.commands++;
+
+    // entering command mode wakes the module up
+    emu.sleeping = false;
+
+    if( strcasecmp( pLine, "AT" ) == 0 )
+    {
+        reply( "OK", EMU_LAT_TEST );
+    }
+    else if( strcasecmp( pLine, "AT+DEFAULT" ) == 0 )
+    {
+        setDefaults();
+        reply( "OK+DEFAULT", EMU_LAT_DEFAULT );
+    }
+    else if( strcasecmp( pLine, "AT+SLEEP" ) == 0 )
+    {
+        emu.sleeping = true;
+        reply( "OK+SLEEP", EMU_LAT_SLEEP );
+    }
+    else if( strcasecmp( pLine, "AT+UPDATE" ) == 0 )
+    {
+        // no answer, module waits for a firmware update until power cycle
+        emu.updating = true;
+    }
+    else if( strcasecmp( pLine, "AT+V" ) == 0 )
+    {
+        reply( EMU_VERSION, EMU_LAT_VERSION );
+    }
+    else if( strcasecmp( pLine, "AT+RB" ) == 0 )
+    {
+        snprintf( answer, sizeof(answer), "OK+B%u", emu.pendingBaud );
+        reply( answer, EMU_LAT_READ );
+    }
+    else if( strcasecmp( pLine, "AT+RC" ) == 0 )
+    {
+        snprintf( answer, sizeof(answer), "OK+RC%03d", emu.channel );
+        reply( answer, EMU_LAT_READ );
+    }
+    else if( strcasecmp( pLine, "AT+RF" ) == 0 )
+    {
+        snprintf( answer, sizeof(answer), "OK+FU%d", emu.ttMode );
+        reply( answer, EMU_LAT_READ );
+    }
+    else if( strcasecmp( pLine, "AT+RP" ) == 0 )
+    {
+        snprintf( answer, sizeof(answer), "OK+RP:%+ddBm",
+                  emuDbm[emu.power-1] );
+        reply( answer, EMU_LAT_READ );
+    }
+    else if( strcasecmp( pLine, "AT+RX" ) == 0 )
+    {
+        snprintf( answer, sizeof(answer), "OK+FU%d", emu.ttMode );
+        reply( answer, EMU_LAT_READ_ALL );
+        snprintf( answer, sizeof(answer), "OK+B%u", emu.pendingBaud );
+        reply( answer, 0 );
+        snprintf( answer, sizeof(answer), "OK+RC%03d", emu.channel );
+        reply( answer, 0 );
+        snprintf( answer, sizeof(answer), "OK+RP:%+ddBm",
+                  emuDbm[emu.power-1] );
+        reply( answer, 0 );
+    }
+    else if( strncasecmp( pLine, "AT+B", 4 ) == 0 &&
+             parseNumber( &pLine[4], -1, &value ) &&
+             ( value == 1200 || value == 2400 || value == 4800 ||
+               value == 9600 || value == 19200 || value == 38400 ||
+               value == 57600 || value == 115200 ) )
+    {
+        // new speed is used after leaving command mode
+        emu.pendingBaud = value;
+        snprintf( answer, sizeof(answer), "OK+B%ld", value );
+        reply( answer, EMU_LAT_WRITE );
+    }
+    else if( strncasecmp( pLine, "AT+C", 4 ) == 0 &&
+             parseNumber( &pLine[4], 3, &value ) &&
+             value >= 1 && value <= 127 )
+    {
+        emu.channel = value;
+        snprintf( answer, sizeof(answer), "OK+C%03ld", value );
+        reply( answer, EMU_LAT_WRITE );
+    }
+    else if( strncasecmp( pLine, "AT+FU", 5 ) == 0 &&
+             parseNumber( &pLine[5], 1, &value ) &&
+             value >= 1 && value <= 4 )
+    {
+        emu.ttMode = value;
+        snprintf( answer, sizeof(answer), "OK+FU%ld", value );
+        reply( answer, EMU_LAT_WRITE );
+    }
+    else if( strncasecmp( pLine, "AT+P", 4 ) == 0 &&
+             parseNumber( &pLine[4], 1, &value ) &&
+             value >= 1 && value <= 8 )
+    {
+        emu.power = value;
+        snprintf( answer, sizeof(answer), "OK+P%ld", value );
+        reply( answer, EMU_LAT_WRITE );
+    }
+    else if( strncasecmp( pLine, "AT+U", 4 ) == 0 && len == 7 &&
+             pLine[4] >= '5' && pLine[4] <= '8' &&
+             strchr( "NOEnoe", pLine[5] ) != NULL &&
+             pLine[6] >= '1' && pLine[6] <= '3' )
+    {
+        emu.databits = pLine[4] - '0';
+        emu.parity = pLine[5] & ~0x20;
+        emu.stopbits = pLine[6] - '0';
+        snprintf( answer, sizeof(answer), "OK+U%d%c%d",
+                  emu.databits, emu.parity, emu.stopbits );
+        reply( answer, EMU_LAT_WRITE );
+    }
+    else
+    {
+        emuStats.unknown++;
+        reply( "ERROR", EMU_LAT_TEST );
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | void handleData( const char *pData, size_t len )
+ |
+ | transparent mode: queue received bytes for the air. The module buffer
+ | is limited, everything beyond is lost - like on the real board.
+ ------------------------------------------------------------------------------
+*/
+
+static void handleData( const char *pData, size_t len )
+{
+    size_t accept;
+
+    emuStats.ttIn += len;
+
+    if( emu.sleeping )
+    {
+        emuStats.ttDropped += len;
+        return;
+    }
+
+    accept = emuParam.bufferSize - airLen;
+    if( accept > len )
+    {
+        accept = len;
+    }
+
+    if( airLen == 0 )
+    {
+        airNext = nowUs() + byteTimeUs();
+    }
+
+    memcpy( &airBuffer[airLen], pData, accept );
+    airLen += accept;
+    emuStats.ttDropped += len - accept;
+}
+
+/* ----------------------------------------------------------------------------
+ | void switchMode( int mode )
+ |
+ | emulate the SET pin
+ ------------------------------------------------------------------------------
+*/
+
+static void switchMode( int mode )
+{
+    if( mode != emu.mode )
+    {
+        if( mode == EMU_MODE_TT )
+        {
+            emu.baud = emu.pendingBaud;
+        }
+        else
+        {
+            emu.sleeping = false;
+        }
+
+        emu.mode = mode;
+        fprintf( stderr, "hc12Emulator: %s mode\n",
+                 mode == EMU_MODE_CMD ? "command" : "transparent" );
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | void onSignal( int sig )
+ ------------------------------------------------------------------------------
+*/
+
+static void onSignal( int sig )
+{
+    switch( sig )
+    {
+        case SIGUSR1:
+            emuModeRequest = EMU_MODE_CMD;
+            break;
+        case SIGUSR2:
+            emuModeRequest = EMU_MODE_TT;
+            break;
+        default:
+            emuTerminate = 1;
+            break;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | void help( short failed )
+ |
+ | show options and exit
+ ------------------------------------------------------------------------------
+*/
+
+static void help( short failed )
+{
+    fprintf(stderr, "HC-12 emulator on a pseudo terminal\n");
+    fprintf(stderr, "valid options are:\n");
+    fprintf(stderr, "--link path (same as --link=path resp. -l path)\n");
+    fprintf(stderr, "create symbolic link path to the pty slave\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--latency scale (same as --latency=scale resp. -t scale)\n");
+    fprintf(stderr, "scale module latencies, 0 answers immediately\n");
+    fprintf(stderr, "Default is --latency=1.0\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--echo     (same as -e )\n");
+    fprintf(stderr, "echo transparent data back after its airtime\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--mode mode (same as --mode=mode resp. -m mode)\n");
+    fprintf(stderr, "start in cmd (command) or tt (transparent) mode\n");
+    fprintf(stderr, "Default is --mode=cmd\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--buffer size (same as --buffer=size resp. -B size)\n");
+    fprintf(stderr, "size of the module transmit buffer\n");
+    fprintf(stderr, "Default is --buffer=128\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--help     (same as -? )\n");
+    fprintf(stderr, "display help info\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "SIGUSR1 enters, SIGUSR2 leaves command mode\n");
+
+    exit(failed);
+}
+
+/* ----------------------------------------------------------------------------
+ | void get_arguments ( int argc, char **argv )
+ |
+ | scan commandline for arguments an set the corresponding value
+ ------------------------------------------------------------------------------
+*/
+
+static void get_arguments ( int argc, char **argv )
+{
+    int next_option;
+    const char* const short_options = "l:t:em:B:?";
+
+    const struct option long_options[] = {
+         { "link",       1, NULL, 'l' },
+         { "latency",    1, NULL, 't' },
+         { "echo",       0, NULL, 'e' },
+         { "mode",       1, NULL, 'm' },
+         { "buffer",     1, NULL, 'B' },
+         { "help",       0, NULL, '?' },
+         { NULL,         0, NULL,  0  }
+    };
+
+    emuParam.link = NULL;
+    emuParam.latencyScale = 1.0;
+    emuParam.echo = false;
+    emuParam.startMode = EMU_MODE_CMD;
+    emuParam.bufferSize = 128;
+
+    do
+    {
+        next_option = getopt_long (argc, argv, short_options,
+            long_options, NULL);
+
+        switch (next_option) {
+            case 'l':
+                emuParam.link = strdup( optarg );
+                break;
+            case 't':
+                emuParam.latencyScale = atof(optarg);
+                break;
+            case 'e':
+                emuParam.echo = true;
+                break;
+            case 'm':
+                emuParam.startMode =
+                    strcasecmp(optarg, "tt") == 0 ? EMU_MODE_TT : EMU_MODE_CMD;
+                break;
+            case 'B':
+                emuParam.bufferSize = atol(optarg);
+                if( emuParam.bufferSize < 1 || emuParam.bufferSize > EMU_AIR_SIZE )
+                {
+                    help( 1 );
+                }
+                break;
+            case '?':
+                help( 0 );
+                break;
+            case -1:
+                break;
+            default:
+                fprintf(stderr, "Invalid option %c! \n", next_option);
+                help( 1 );
+        }
+    } while (next_option != -1);
+}
+
+/* ----------------------------------------------------------------------------
+ | int openPty( int *pSlave )
+ |
+ | create the pty pair. The slave side is kept open by the emulator so
+ | the master does not see a hangup between two client sessions.
+ ------------------------------------------------------------------------------
+*/
+
+static int openPty( int *pSlave )
+{
+    int master;
+    char *pName;
+    struct termios tio;
+
+    if( (master = posix_openpt( O_RDWR | O_NOCTTY )) < 0 ||
+        grantpt( master ) != 0 || unlockpt( master ) != 0 ||
+        (pName = ptsname( master )) == NULL )
+    {
+        perror( "hc12Emulator: pty" );
+        exit( 1 );
+    }
+
+    if( (*pSlave = open( pName, O_RDWR | O_NOCTTY )) < 0 )
+    {
+        perror( "hc12Emulator: pty slave" );
+        exit( 1 );
+    }
+
+    tcgetattr( *pSlave, &tio );
+    cfmakeraw( &tio );
+    tcsetattr( *pSlave, TCSANOW, &tio );
+
+    fcntl( master, F_SETFL, fcntl( master, F_GETFL ) | O_NONBLOCK );
+
+    if( emuParam.link != NULL )
+    {
+        unlink( emuParam.link );
+        if( symlink( pName, emuParam.link ) != 0 )
+        {
+            perror( "hc12Emulator: link" );
+        }
+    }
+
+    fprintf( stdout, "hc12Emulator: %s\n", pName );
+    fflush( stdout );
+
+    return( master );
+}
+
+/*
+ ****************************************************************************
+*/
+
+int main( int argc, char *argv[] )
+{
+    int master;
+    int slave;
+    char line[EMU_LINE_SIZE];
+    size_t lineLen = 0;
+    uint64_t lineLast = 0;
+    char buffer[1024];
+    struct pollfd pfd;
+    struct sigaction sa;
+    sigset_t blocked;
+    sigset_t waitMask;
+    struct timespec ts;
+    uint64_t now;
+    uint64_t next;
+    ssize_t len;
+    size_t count;
+    int timeout;
+
+    get_arguments( argc, argv );
+
+    memset( &sa, '\0', sizeof(sa) );
+    sa.sa_handler = onSignal;
+    sigaction( SIGUSR1, &sa, NULL );
+    sigaction( SIGUSR2, &sa, NULL );
+    sigaction( SIGINT, &sa, NULL );
+    sigaction( SIGTERM, &sa, NULL );
+
+    // signals are taken only while waiting in ppoll(), otherwise one
+    // arriving just before the wait would be noticed a timeout late
+    sigemptyset( &blocked );
+    sigaddset( &blocked, SIGUSR1 );
+    sigaddset( &blocked, SIGUSR2 );
+    sigaddset( &blocked, SIGINT );
+    sigaddset( &blocked, SIGTERM );
+    sigprocmask( SIG_BLOCK, &blocked, &waitMask );
+
+    setDefaults();
+    emu.mode = emuParam.startMode;
+    emu.sleeping = false;
+    emu.updating = false;
+
+    master = openPty( &slave );
+
+    while( !emuTerminate )
+    {
+        if( emuModeRequest != 0 )
+        {
+            switchMode( emuModeRequest );
+            emuModeRequest = 0;
+            lineLen = 0;
+        }
+
+        now = nowUs();
+
+        // deliver a due reply, paced with the serial speed
+        if( outLen > 0 && now >= outDue )
+        {
+            count = 1 + (now - outDue) / (10000000ULL / emu.baud);
+            if( count > outLen )
+            {
+                count = outLen;
+            }
+
+            if( (len = write( master, outBuffer, count )) > 0 )
+            {
+                memmove( outBuffer, &outBuffer[len], outLen - len );
+                outLen -= len;
+                outDue += len * (10000000ULL / emu.baud);
+            }
+        }
+
+        // data leaves the module buffer with the air rate
+        while( airLen > 0 && now >= airNext )
+        {
+            if( emuParam.echo && outLen < EMU_OUT_SIZE )
+            {
+                if( outLen == 0 )
+                {
+                    outDue = now;
+                }
+                outBuffer[outLen++] = airBuffer[0];
+            }
+            emuStats.ttOut++;
+            memmove( airBuffer, &airBuffer[1], --airLen );
+            airNext += byteTimeUs();
+        }
+
+        // a command may come without line end
+        if( emu.mode == EMU_MODE_CMD && lineLen > 0 &&
+            now - lineLast >= EMU_CMD_IDLE_US )
+        {
+            line[lineLen] = '\0';
+            handleCommand( line );
+            lineLen = 0;
+        }
+
+        next = now + 100000;
+        if( outLen > 0 && outDue < next )
+        {
+            next = outDue;
+        }
+        if( airLen > 0 && airNext < next )
+        {
+            next = airNext;
+        }
+        if( lineLen > 0 && lineLast + EMU_CMD_IDLE_US < next )
+        {
+            next = lineLast + EMU_CMD_IDLE_US;
+        }
+
+        timeout = next > now ? (int) ((next - now + 999) / 1000) : 0;
+
+        pfd.fd = master;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000L;
+
+        if( ppoll( &pfd, 1, &ts, &waitMask ) > 0 && (pfd.revents & POLLIN) )
+        {
+            if( (len = read( master, buffer, sizeof(buffer) )) > 0 )
+            {
+                if( emu.mode == EMU_MODE_TT )
+                {
+                    handleData( buffer, len );
+                }
+                else
+                {
+                    lineLast = nowUs();
+                    for( ssize_t i = 0; i < len; i++ )
+                    {
+                        if( buffer[i] == '\n' || buffer[i] == '\r' )
+                        {
+                            if( lineLen > 0 )
+                            {
+                                line[lineLen] = '\0';
+                                handleCommand( line );
+                                lineLen = 0;
+                            }
+                        }
+                        else
+                        {
+                            if( lineLen < EMU_LINE_SIZE - 1 )
+                            {
+                                line[lineLen++] = buffer[i];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    fprintf( stderr, "hc12Emulator: %lu commands (%lu unknown), "
+             "tt in %lu out %lu dropped %lu\n",
+             emuStats.commands, emuStats.unknown,
+             emuStats.ttIn, emuStats.ttOut, emuStats.ttDropped );
+
+    if( emuParam.link != NULL )
+    {
+        unlink( emuParam.link );
+    }
+
+    close( slave );
+    close( master );
+
+    return( 0 );
+}
@@ -0,0 +1,365 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Fleet.cpp - bring up a fleet of radios with coroutines
+ *
+ *  Every radio runs the same command sequence (enter command mode,
+ *  AT, AT+V, AT+RX, set the channel, leave command mode) written as
+ *  a coroutine on hc12CoExecutor. All sequences share one thread and
+ *  one hc12Reactor, so the wall time is about that of a single one.
+ *
+ *  Built with -std=c++20, see the fleet target of the Makefile.
+ *
+ ***********************************************************************
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ *
+ * Options:
+ *
+ * --emulator path (same as --emulator=path resp. -E path)
+ *
+ *   start one emulator per radio, each on a private pty. Without it
+ *   the devices are taken from the command line, the modules have to
+ *   be in command mode.
+ *
+ * --radios n (same as --radios=n resp. -n n)
+ *
+ *   amount of emulated radios, default is --radios=16
+ *
+ * --latency scale (same as --latency=scale resp. -t scale)
+ *
+ *   latency scale handed to the emulators, default is --latency=1.0
+ *
+ * --help     (same as -? )
+ *
+ *   Show options and exit
+ *
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "hc12Radio.h"
+#include "hc12Coro.h"
+
+#if !defined(__cpp_impl_coroutine)
+    #error "hc12Fleet needs a compiler with coroutines, e.g. -std=c++20"
+#endif
+
+/*
+ ****************************************************************************
+*/
+
+#define FLEET_DEFAULT_RADIOS  16
+#define FLEET_FIRST_CHANNEL   10
+
+struct _fleet_param {
+    char    *emulator;
+    char    *latency;
+    int      radios;
+};
+
+static struct _fleet_param fleetParam;
+static pid_t emuPid[HC12_REACTOR_MAX_RADIOS];
+static char  emuLink[HC12_REACTOR_MAX_RADIOS][64];
+
+/* ----------------------------------------------------------------------------
+ | hc12CoTask bringUp( hc12CoExecutor &exec, int id, int chan )
+ |
+ | the sequence of one radio, command mode is left in any case
+ ------------------------------------------------------------------------------
+*/
+
+static hc12CoTask bringUp( hc12CoExecutor &exec, int id, int chan )
+{
+    int rc;
+
+    if( (rc = co_await exec.enterCommandMode( id )) == HC12_ERR_OK &&
+        (rc = co_await exec.test( id )) == HC12_ERR_OK &&
+        (rc = co_await exec.getFWVersion( id )) == HC12_ERR_OK &&
+        (rc = co_await exec.getParam( id )) == HC12_ERR_OK )
+    {
+        rc = co_await exec.setComChannel( id, chan );
+    }
+
+    co_await exec.leaveCommandMode( id );
+
+    co_return( rc );
+}
+
+/* ----------------------------------------------------------------------------
+ | bool startEmulator( int n )
+ |
+ | fork emulator n on a private link and wait for the link
+ ------------------------------------------------------------------------------
+*/
+
+static bool startEmulator( int n )
+{
+    bool retVal = false;
+    struct stat st;
+    int devNull;
+    int i;
+
+    snprintf( emuLink[n], sizeof(emuLink[n]), "/tmp/hc12Fleet.%d.%d",
+              (int) getpid(), n );
+
+    if( (emuPid[n] = fork()) == 0 )
+    {
+        // 16 emulators reporting their mode switches drown the result
+        if( (devNull = open( "/dev/null", O_WRONLY )) >= 0 )
+        {
+            dup2( devNull, STDOUT_FILENO );
+            dup2( devNull, STDERR_FILENO );
+        }
+        execl( fleetParam.emulator, fleetParam.emulator,
+               "--link", emuLink[n],
+               "--latency", fleetParam.latency, (char*) NULL );
+        _exit( 1 );
+    }
+
+    for( i = 0; emuPid[n] > 0 && i < 200 && !retVal; i++ )
+    {
+        if( lstat( emuLink[n], &st ) == 0 )
+        {
+            retVal = true;
+        }
+        else
+        {
+            usleep( 10000 );
+        }
+    }
+
+    return( retVal );
+}
+
+/* ----------------------------------------------------------------------------
+ | void stopEmulator( int n )
+ ------------------------------------------------------------------------------
+*/
+
+static void stopEmulator( int n )
+{
+    if( emuPid[n] > 0 )
+    {
+        kill( emuPid[n], SIGTERM );
+        waitpid( emuPid[n], NULL, 0 );
+        unlink( emuLink[n] );
+        emuPid[n] = -1;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+ | void help( short failed )
+ |
+ | show options and exit
+ ------------------------------------------------------------------------------
+*/
+
+static void help( short failed )
+{
+    fprintf(stderr, "bring up a fleet of radios with coroutines\n");
+    fprintf(stderr, "usage: hc12Fleet [options] [device ...]\n");
+    fprintf(stderr, "valid options are:\n");
+    fprintf(stderr, "--emulator path (same as --emulator=path resp. -E path)\n");
+    fprintf(stderr, "start one emulator per radio instead of using devices\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--radios n (same as --radios=n resp. -n n)\n");
+    fprintf(stderr, "amount of emulated radios\n");
+    fprintf(stderr, "Default is --radios=%d\n", FLEET_DEFAULT_RADIOS);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--latency scale (same as --latency=scale resp. -t scale)\n");
+    fprintf(stderr, "latency scale of the emulators\n");
+    fprintf(stderr, "Default is --latency=1.0\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--help     (same as -? )\n");
+    fprintf(stderr, "display help info\n");
+
+    exit(failed);
+}
+
+/* ----------------------------------------------------------------------------
+ | void get_arguments ( int argc, char **argv )
+ |
+ | scan commandline for arguments an set the corresponding value
+ ------------------------------------------------------------------------------
+*/
+
+static void get_arguments ( int argc, char **argv )
+{
+    int next_option;
+    const char* const short_options = "E:n:t:?";
+
+    const struct option long_options[] = {
+         { "emulator",   1, NULL, 'E' },
+         { "radios",     1, NULL, 'n' },
+         { "latency",    1, NULL, 't' },
+         { "help",       0, NULL, '?' },
+         { NULL,         0, NULL,  0  }
+    };
+
+    fleetParam.emulator = NULL;
+    fleetParam.latency = strdup( "1.0" );
+    fleetParam.radios = FLEET_DEFAULT_RADIOS;
+
+    do
+    {
+        next_option = getopt_long (argc, argv, short_options,
+            long_options, NULL);
+
+        switch (next_option) {
+            case 'E':
+                fleetParam.emulator = strdup( optarg );
+                break;
+            case 'n':
+                fleetParam.radios = atoi( optarg );
+                if( fleetParam.radios < 1 ||
+                    fleetParam.radios > HC12_REACTOR_MAX_RADIOS )
+                {
+                    help( 1 );
+                }
+                break;
+            case 't':
+                fleetParam.latency = strdup( optarg );
+                break;
+            case '?':
+                help( 0 );
+                break;
+            case -1:
+                break;
+            default:
+                fprintf(stderr, "Invalid option %c! \n", next_option);
+                help( 1 );
+        }
+    } while (next_option != -1);
+}
+
+/*
+ ****************************************************************************
+*/
+
+int main( int argc, char *argv[] )
+{
+    int retVal = 0;
+    hc12Radio *pRadio[HC12_REACTOR_MAX_RADIOS];
+    hc12CoExecutor exec;
+    struct _hc12_serial_param serialParam;
+    struct timespec start, end;
+    int slot[HC12_REACTOR_MAX_RADIOS];
+    int radios = 0;
+    int failed;
+    int i;
+
+    get_arguments( argc, argv );
+
+    if( fleetParam.emulator == NULL )
+    {
+        fleetParam.radios = argc - optind;
+        if( fleetParam.radios < 1 ||
+            fleetParam.radios > HC12_REACTOR_MAX_RADIOS )
+        {
+            help( 1 );
+        }
+    }
+
+    memset( &serialParam, '\0', sizeof(serialParam) );
+    serialParam.baud = HC12_DEFAULT_BAUD;
+    serialParam.databit = HC12_DEFAULT_DATABIT;
+    serialParam.parity = HC12_DEFAULT_PARITY;
+    serialParam.stopbits = HC12_DEFAULT_STOPBITS;
+    serialParam.handshake = HC12_DEFAULT_HANDSHAKE;
+
+    for( i = 0; i < fleetParam.radios && retVal == 0; i++ )
+    {
+        emuPid[i] = -1;
+
+        if( fleetParam.emulator == NULL )
+        {
+            serialParam.device = argv[optind + i];
+        }
+        else if( startEmulator( i ) )
+        {
+            serialParam.device = emuLink[i];
+        }
+        else
+        {
+            fprintf(stderr, "hc12Fleet: emulator %d did not come up\n", i);
+            retVal = 1;
+        }
+
+        if( retVal == 0 )
+        {
+            pRadio[i] = new hc12Radio();
+            pRadio[i]->init();
+            slot[i] = -1;
+            radios++;
+
+            if( pRadio[i]->connect( &serialParam ) != E_OK ||
+                (slot[i] = exec.add( pRadio[i] )) < 0 )
+            {
+                fprintf(stderr, "hc12Fleet: cannot use %s\n",
+                        serialParam.device);
+                retVal = 1;
+            }
+            else
+            {
+                exec.spawn( bringUp( exec, slot[i],
+                                     FLEET_FIRST_CHANNEL + i ) );
+            }
+        }
+    }
+
+    if( retVal == 0 )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        failed = exec.run();
+        clock_gettime( CLOCK_MONOTONIC, &end );
+
+        printf( "%d sequences, %d failed, %.1f ms\n", radios, failed,
+                (end.tv_sec - start.tv_sec) * 1000.0 +
+                (end.tv_nsec - start.tv_nsec) / 1000000.0 );
+
+        retVal = failed > 0 ? 1 : 0;
+    }
+
+    // the reactor must let go of a radio before it is deleted
+    for( i = 0; i < radios; i++ )
+    {
+        if( slot[i] >= 0 )
+        {
+            exec.reactor()->remove( slot[i] );
+        }
+        delete pRadio[i];
+    }
+
+    for( i = 0; i < fleetParam.radios; i++ )
+    {
+        stopEmulator( i );
+    }
+
+    return( retVal );
+}
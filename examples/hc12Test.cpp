@@ -111,6 +111,12 @@
 #define E_NULL        -16
 #define E_NOFD        -17
 
+// SET pin, a line of the gpiochip given with --gpio
+static int setPin = HC12_NULLPIN;
+static char *gpioChip = NULL;
+// --native, hc12TtyTransport instead of serialConnection
+static bool nativeTty = false;
+
 
 
 //
@@ -193,6 +199,17 @@ void help( struct _hc12_serial_param *ctl_param, short failed )
     fprintf(stderr, "handshake for transmission (n/N for none, x/X for ixon/ixoff)\n");
     fprintf(stderr, "Default is --handshake=n\n");
     fprintf(stderr, "\n");
+    fprintf(stderr, "--gpio chip (same as --gpio=chip resp. -g chip)\n");
+    fprintf(stderr, "switch the SET pin through chip, e.g. /dev/gpiochip0\n");
+    fprintf(stderr, "Default is to switch it by hand\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--set line (same as --set=line resp. -S line)\n");
+    fprintf(stderr, "line of the gpio chip the SET pin is connected to\n");
+    fprintf(stderr, "Default is no SET pin\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "--native   (same as -n )\n");
+    fprintf(stderr, "set up the port for low latency without serialConnection\n");
+    fprintf(stderr, "\n");
     fprintf(stderr, "--help     (same as -? )\n");
     fprintf(stderr, "display help info\n");
 
@@ -214,7 +231,7 @@ void get_arguments ( int argc, char **argv, struct _hc12_serial_param *ctl_param
     int failed = 0;
     int next_option;
     /* valid short options letters */
-    const char* const short_options = "c:b:d:p:s:h:m?";
+    const char* const short_options = "c:b:d:p:s:h:g:S:nm?";
 
     /* valid long options */
     const struct option long_options[] = {
@@ -224,6 +241,9 @@ void get_arguments ( int argc, char **argv, struct _hc12_serial_param *ctl_param
          { "parity",        1, NULL, 'p' },
          { "stop",        1, NULL, 's' },
          { "handshake",        1, NULL, 'h' },
+         { "gpio",        1, NULL, 'g' },
+         { "set",        1, NULL, 'S' },
+         { "native",        0, NULL, 'n' },
          { "mystery",        0, NULL, 'm' },
          { "help",        0, NULL, '?' },
         { NULL,            0, NULL,  0  }
@@ -267,6 +287,15 @@ void get_arguments ( int argc, char **argv, struct _hc12_serial_param *ctl_param
             case 'h':
                 ctl_param->handshake = optarg[0];
                 break;
+            case 'g':
+                gpioChip = strdup( optarg );
+                break;
+            case 'S':
+                setPin = atoi(optarg);
+                break;
+            case 'n':
+                nativeTty = true;
+                break;
             case 'm':
                 if( myst != NULL )
                 {
@@ -365,11 +394,27 @@ int main( int argc, char *argv[] )
     set_defaults( &ctl_param );
     get_arguments ( argc, argv, &ctl_param, &mystic);
 
-// #define PIN_SET    17 // GPIO17 = pin #11
-#define PIN_SET    HC12_NULLPIN
+    if( nativeTty )
+    {
+        pRadio = new hc12Radio(new hc12TtyTransport(), setPin);
+    }
+    else
+    {
+        pRadio = new hc12Radio(setPin);
+    }
 
-    if( (pRadio = new hc12Radio(PIN_SET)) != NULL )
+    if( pRadio != NULL )
     {
+        if( gpioChip != NULL )
+        {
+            pRadio->setGpio( new hc12GpioChip( gpioChip ) );
+        }
+        else
+        {
+            // the user switches the SET pin when asked
+            pRadio->setManualModeSwitch( true );
+        }
+
         if( (failed = check_param( pRadio, &ctl_param )) == HC12_ERR_OK )
         {
             if( (retVal = pRadio->connect(&ctl_param)) != HC12_ERR_OK )
@@ -383,6 +428,7 @@ int main( int argc, char *argv[] )
                 pRadio->test();
                 pRadio->getFWVersion();
                 pRadio->getParam();
+                // served from the cache if getParam() got them
                 pRadio->getBaud();
                 pRadio->getComChannel();
                 pRadio->getTTMode();
@@ -396,6 +442,9 @@ int main( int argc, char *argv[] )
             pRadio->dump( HC12_DUMP_SERIAL_PARAM );
             pRadio->dump( HC12_DUMP_FW_INFO );
             pRadio->dump( HC12_DUMP_HC12_PARAM );
+            pRadio->dump( HC12_DUMP_PARAM_STATE );
+            pRadio->dump( HC12_DUMP_STATS );
+            pRadio->dump( HC12_DUMP_LOG );
         }
     }
     else
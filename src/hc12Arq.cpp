@@ -0,0 +1,795 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Arq.cpp - reliable byte stream over the transparent link
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Arq.h"
+
+#if !defined(ARDUINO)
+    #include <time.h>
+#endif // !defined(ARDUINO)
+
+// sequence numbers are compared modulo 256, the lower half is ahead
+#define HC12_ARQ_SEQ_HALF         128
+
+#define HC12_ARQ_MAX_RETRIES        8
+
+// a segment filling FU2/FU4 packets of HC12_AIR_PACKET_BYTES, resp. two
+#define HC12_ARQ_SEGMENT_SLOW     (HC12_AIR_PACKET_BYTES - \
+                                   HC12_FRAME_AIR_SIZE(0) - \
+                                   HC12_ARQ_DATA_HEADER)
+#define HC12_ARQ_SEGMENT_FAST     (2 * HC12_AIR_PACKET_BYTES - \
+                                   HC12_FRAME_AIR_SIZE(0) - \
+                                   HC12_ARQ_DATA_HEADER)
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Arq::hc12Arq( hc12Radio *pRadio )
+ ------------------------------------------------------------------------------
+*/
+hc12Arq::hc12Arq( hc12Radio *pRadio ) : _framer( pRadio )
+{
+    _pRadio = pRadio;
+    defaults( pRadio != NULL ? pRadio->pacer()->ttMode() :
+                               HC12_DEFAULT_TTMODE, &_param );
+    reset();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Arq::nowMs( void )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Arq::nowMs( void )
+{
+#if defined(ARDUINO)
+    return( millis() );
+#else // NOT defined(ARDUINO)
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint32_t) ts.tv_sec * 1000u + ts.tv_nsec / 1000000 );
+#endif // defined(ARDUINO)
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Arq::defaults( int ttMode, struct _hc12_arq_param *pParam )
+ *
+ * FU1 and FU3 keep the whole window in flight with segments of two air
+ * packets. FU2 and FU4 send a packet every few seconds only (see
+ * hc12Pacer), segments fill one packet there, the window is small and
+ * the timers are long.
+ ------------------------------------------------------------------------------
+*/
+void hc12Arq::defaults( int ttMode, struct _hc12_arq_param *pParam )
+{
+    switch( ttMode )
+    {
+        case HC12_TTMODE_FU1:
+            pParam->window = HC12_ARQ_WINDOW;
+            pParam->segment = HC12_ARQ_SEGMENT_FAST;
+            pParam->ackEvery = HC12_ARQ_WINDOW / 2;
+            pParam->ackDelay = 10;
+            pParam->rtoInit = 250;
+            pParam->rtoMin = 50;
+            pParam->rtoMax = 3000;
+            break;
+        case HC12_TTMODE_FU2:
+            pParam->window = HC12_ARQ_WINDOW < 4 ? HC12_ARQ_WINDOW : 4;
+            pParam->segment = HC12_ARQ_SEGMENT_SLOW;
+            pParam->ackEvery = 2;
+            pParam->ackDelay = 2500;
+            pParam->rtoInit = 5000;
+            pParam->rtoMin = 1000;
+            pParam->rtoMax = 30000;
+            break;
+        case HC12_TTMODE_FU4:
+            pParam->window = HC12_ARQ_WINDOW < 4 ? HC12_ARQ_WINDOW : 4;
+            pParam->segment = HC12_ARQ_SEGMENT_SLOW;
+            pParam->ackEvery = 2;
+            pParam->ackDelay = 4000;
+            pParam->rtoInit = 10000;
+            pParam->rtoMin = 3000;
+            pParam->rtoMax = 60000;
+            break;
+        default:
+            pParam->window = HC12_ARQ_WINDOW;
+            pParam->segment = HC12_ARQ_SEGMENT_FAST;
+            pParam->ackEvery = HC12_ARQ_WINDOW / 2;
+            pParam->ackDelay = 50;
+            pParam->rtoInit = 1000;
+            pParam->rtoMin = 100;
+            pParam->rtoMax = 10000;
+            break;
+    }
+
+    if( pParam->segment > HC12_ARQ_SEGMENT_MAX )
+    {
+        pParam->segment = HC12_ARQ_SEGMENT_MAX;
+    }
+
+    pParam->maxRetries = HC12_ARQ_MAX_RETRIES;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Arq::setParam( const struct _hc12_arq_param *pParam )
+ *
+ * both ends need the same window. Segments already queued keep their
+ * size.
+ * returns HC12_ERR_OK, HC12_ERR_NULLP or HC12_ERR_ARGS
+ ------------------------------------------------------------------------------
+*/
+int hc12Arq::setParam( const struct _hc12_arq_param *pParam )
+{
+    int retVal = HC12_ERR_OK;
+
+    if( pParam == NULL )
+    {
+        retVal = HC12_ERR_NULLP;
+    }
+    else if( pParam->window < 1 || pParam->window > HC12_ARQ_WINDOW ||
+             pParam->segment < 1 || pParam->segment > HC12_ARQ_SEGMENT_MAX ||
+             pParam->ackEvery < 1 || pParam->maxRetries < 1 ||
+             pParam->rtoMin == 0 || pParam->rtoMin > pParam->rtoMax ||
+             pParam->rtoInit < pParam->rtoMin ||
+             pParam->rtoInit > pParam->rtoMax )
+    {
+        retVal = HC12_ERR_ARGS;
+    }
+    else
+    {
+        _param = *pParam;
+        if( _srtt8 == 0 )
+        {
+            _rto = _rtoBase = _param.rtoInit;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Arq::reset( void )
+ *
+ * drop everything queued and start over with segment 0
+ ------------------------------------------------------------------------------
+*/
+void hc12Arq::reset( void )
+{
+    memset( _tx, '\0', sizeof(_tx) );
+    memset( _rx, '\0', sizeof(_rx) );
+    memset( &_stats, '\0', sizeof(_stats) );
+    _framer.resetStats();
+
+    _txBase = 0;
+    _txNext = 0;
+    _peerLimit = (uint8_t) _param.window;
+    _txOrder = 0;
+    _probeMs = nowMs();
+
+    _srtt8 = 0;
+    _rttvar4 = 0;
+    _rto = _rtoBase = _param.rtoInit;
+
+    _rxBase = 0;
+    _rxOffset = 0;
+    _advLimit = (uint8_t) _param.window;
+    _ackPending = false;
+    _ackCount = 0;
+    _ackDueMs = 0;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Arq::send( const void *pData, size_t len )
+ *
+ * queue len bytes, filling up the last segment if it was not sent yet
+ * returns the amount of bytes taken, less than len if the window is
+ * full, or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Arq::send( const void *pData, size_t len )
+{
+    const uint8_t *pSrc = (const uint8_t*) pData;
+    struct _hc12_arq_segment *pSeg;
+    size_t done = 0;
+    size_t chunk;
+
+    if( pData == NULL )
+    {
+        return( HC12_ERR_NULLP );
+    }
+
+    while( done < len )
+    {
+        pSeg = NULL;
+
+        if( _txNext != _txBase )
+        {
+            pSeg = &_tx[(uint8_t) (_txNext - 1) & HC12_ARQ_WINDOW_MASK];
+            if( pSeg->state != HC12_ARQ_SEG_QUEUED ||
+                pSeg->len >= _param.segment )
+            {
+                pSeg = NULL;
+            }
+        }
+
+        if( pSeg == NULL )
+        {
+            if( (uint8_t) (_txNext - _txBase) >= _param.window )
+            {
+                break;
+            }
+
+            pSeg = &_tx[_txNext & HC12_ARQ_WINDOW_MASK];
+            pSeg->state = HC12_ARQ_SEG_QUEUED;
+            pSeg->len = 0;
+            pSeg->tries = 0;
+            pSeg->lost = false;
+            pSeg->repeated = false;
+            pSeg->frame[0] = HC12_ARQ_DATA;
+            pSeg->frame[1] = _txNext++;
+        }
+
+        chunk = _param.segment - pSeg->len;
+        if( chunk > len - done )
+        {
+            chunk = len - done;
+        }
+
+        memcpy( &pSeg->frame[HC12_ARQ_DATA_HEADER + pSeg->len],
+                &pSrc[done], chunk );
+        pSeg->len += chunk;
+        done += chunk;
+    }
+
+    return( (int) done );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Arq::receive( void *pData, size_t len )
+ *
+ * take up to len bytes of the stream, in order and without gaps
+ * returns the amount of bytes copied or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Arq::receive( void *pData, size_t len )
+{
+    uint8_t *pDest = (uint8_t*) pData;
+    struct _hc12_arq_slot *pSlot;
+    size_t done = 0;
+    size_t chunk;
+
+    if( pData == NULL )
+    {
+        return( HC12_ERR_NULLP );
+    }
+
+    while( done < len &&
+           (pSlot = &_rx[_rxBase & HC12_ARQ_WINDOW_MASK])->valid )
+    {
+        chunk = pSlot->len - _rxOffset;
+        if( chunk > len - done )
+        {
+            chunk = len - done;
+        }
+
+        memcpy( &pDest[done], &pSlot->data[_rxOffset], chunk );
+        _rxOffset += chunk;
+        done += chunk;
+
+        if( _rxOffset == pSlot->len )
+        {
+            pSlot->valid = false;
+            _rxOffset = 0;
+            _rxBase++;
+
+            // the sender learns of the free buffer with the next ack,
+            // at once if less than half of the last window is left
+            if( (uint8_t) (_advLimit - cumulativeAck()) <=
+                                                     _param.window / 2 )
+            {
+                _ackPending = true;
+                _ackDueMs = nowMs();
+            }
+            else if( !_ackPending )
+            {
+                _ackPending = true;
+                _ackDueMs = nowMs() + _param.ackDelay;
+            }
+        }
+    }
+
+    _stats.bytesReceived += done;
+
+    return( (int) done );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12Arq::pending( void )
+ ------------------------------------------------------------------------------
+*/
+size_t hc12Arq::pending( void )
+{
+    size_t retVal = 0;
+    uint8_t seq;
+
+    for( seq = _txBase; seq != _txNext; seq++ )
+    {
+        if( _tx[seq & HC12_ARQ_WINDOW_MASK].state != HC12_ARQ_SEG_ACKED )
+        {
+            retVal += _tx[seq & HC12_ARQ_WINDOW_MASK].len;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint8_t hc12Arq::cumulativeAck( void )
+ *
+ * returns the first segment missing
+ ------------------------------------------------------------------------------
+*/
+uint8_t hc12Arq::cumulativeAck( void )
+{
+    uint8_t seq = _rxBase;
+
+    while( (uint8_t) (seq - _rxBase) < _param.window &&
+           _rx[seq & HC12_ARQ_WINDOW_MASK].valid )
+    {
+        seq++;
+    }
+
+    return( seq );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Arq::transmit( uint8_t seq, uint32_t now )
+ *
+ * hand a segment to the framer if the pacer lets it on the air right
+ * away, so the time stamp is the time it goes out and not the time
+ * it was queued
+ * returns > 0 if it went out, 0 if it has to wait
+ ------------------------------------------------------------------------------
+*/
+int hc12Arq::transmit( uint8_t seq, uint32_t now )
+{
+    int retVal = 0;
+    struct _hc12_arq_segment *pSeg = &_tx[seq & HC12_ARQ_WINDOW_MASK];
+    size_t len = HC12_ARQ_DATA_HEADER + pSeg->len;
+
+    if( _pRadio->pacer()->delayUs( HC12_FRAME_AIR_SIZE(len) ) == 0 &&
+        (retVal = _framer.send( pSeg->frame, len )) > 0 )
+    {
+        if( pSeg->state == HC12_ARQ_SEG_QUEUED )
+        {
+            pSeg->state = HC12_ARQ_SEG_SENT;
+            _stats.segmentsSent++;
+        }
+        pSeg->sentMs = now;
+        pSeg->order = ++_txOrder;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Arq::sendAck( void )
+ *
+ * unlike transmit() this does not wait for the pacer, the ack is queued
+ * at once. It still goes on the air through hc12Radio::flush(), paced
+ * in FU2 and FU4 like everything else in the TX ring.
+ * returns > 0 if the ack was queued, 0 if the TX ring is full
+ ------------------------------------------------------------------------------
+*/
+int hc12Arq::sendAck( void )
+{
+    int retVal;
+    uint8_t frame[HC12_ARQ_ACK_SIZE];
+    uint8_t ack = cumulativeAck();
+    uint8_t seq;
+    uint32_t sack = 0;
+    int i;
+
+    for( i = 0; i < 32; i++ )
+    {
+        seq = ack + 1 + i;
+        if( (uint8_t) (seq - _rxBase) < _param.window &&
+            _rx[seq & HC12_ARQ_WINDOW_MASK].valid )
+        {
+            sack |= (uint32_t) 1 << i;
+        }
+    }
+
+    frame[0] = HC12_ARQ_ACK;
+    frame[1] = ack;
+    frame[2] = _advLimit = (uint8_t) (_rxBase + _param.window);
+    frame[3] = (uint8_t) (sack >> 24);
+    frame[4] = (uint8_t) (sack >> 16);
+    frame[5] = (uint8_t) (sack >> 8);
+    frame[6] = (uint8_t) sack;
+
+    if( (retVal = _framer.send( frame, sizeof(frame) )) > 0 )
+    {
+        _ackPending = false;
+        _ackCount = 0;
+        _stats.acksSent++;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Arq::handleData( const uint8_t *pData, int len, uint32_t now )
+ ------------------------------------------------------------------------------
+*/
+void hc12Arq::handleData( const uint8_t *pData, int len, uint32_t now )
+{
+    struct _hc12_arq_slot *pSlot;
+    uint8_t seq;
+    uint8_t offset;
+    bool ackNow = true;
+
+    if( len < HC12_ARQ_DATA_HEADER )
+    {
+        return;
+    }
+
+    seq = pData[1];
+    offset = seq - _rxBase;
+
+    if( offset < _param.window )
+    {
+        pSlot = &_rx[seq & HC12_ARQ_WINDOW_MASK];
+
+        if( pSlot->valid )
+        {
+            _stats.duplicates++;
+        }
+        else
+        {
+            // in order unless something before it is missing
+            ackNow = seq != cumulativeAck();
+
+            pSlot->len = len - HC12_ARQ_DATA_HEADER;
+            memcpy( pSlot->data, &pData[HC12_ARQ_DATA_HEADER], pSlot->len );
+            pSlot->valid = true;
+
+            if( !ackNow && ++_ackCount >= _param.ackEvery )
+            {
+                ackNow = true;
+            }
+        }
+    }
+    else if( offset >= HC12_ARQ_SEQ_HALF )
+    {
+        // the ack for it got lost
+        _stats.duplicates++;
+    }
+    else
+    {
+        _stats.outOfWindow++;
+    }
+
+    if( ackNow )
+    {
+        _ackPending = true;
+        _ackDueMs = now;
+    }
+    else if( !_ackPending )
+    {
+        _ackPending = true;
+        _ackDueMs = now + _param.ackDelay;
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Arq::handleAck( const uint8_t *pData, int len, uint32_t now )
+ ------------------------------------------------------------------------------
+*/
+void hc12Arq::handleAck( const uint8_t *pData, int len, uint32_t now )
+{
+    struct _hc12_arq_segment *pSeg;
+    uint8_t inFlight = _txNext - _txBase;
+    uint8_t ack;
+    uint8_t limit;
+    uint8_t seq;
+    uint32_t sack;
+    uint32_t rtt = 0;
+    uint32_t latest = 0;
+    bool sampled = false;
+    bool progress = false;
+
+    if( len < HC12_ARQ_ACK_SIZE )
+    {
+        return;
+    }
+
+    ack = pData[1];
+    limit = pData[2];
+    sack = ((uint32_t) pData[3] << 24) | ((uint32_t) pData[4] << 16) |
+           ((uint32_t) pData[5] << 8) | pData[6];
+
+    // acks of an older session or a corrupted one that passed the CRC
+    if( (uint8_t) (ack - _txBase) > inFlight )
+    {
+        return;
+    }
+
+    _stats.acksReceived++;
+
+    if( (uint8_t) (limit - _peerLimit) < HC12_ARQ_SEQ_HALF )
+    {
+        _peerLimit = limit;
+    }
+
+    for( seq = _txBase; seq != _txNext; seq++ )
+    {
+        pSeg = &_tx[seq & HC12_ARQ_WINDOW_MASK];
+
+        if( pSeg->state != HC12_ARQ_SEG_SENT )
+        {
+            continue;
+        }
+
+        // the peer is alive, timeouts start counting anew
+        pSeg->tries = 0;
+
+        if( (uint8_t) (seq - _txBase) < (uint8_t) (ack - _txBase) ||
+            ((uint8_t) (seq - ack - 1) < 32 &&
+             (sack & ((uint32_t) 1 << (uint8_t) (seq - ack - 1))) != 0) )
+        {
+            pSeg->state = HC12_ARQ_SEG_ACKED;
+            _stats.bytesSent += pSeg->len;
+
+            if( !progress || (int32_t) (pSeg->order - latest) > 0 )
+            {
+                latest = pSeg->order;
+            }
+            progress = true;
+
+            // the most recent one is closest to the ack in time
+            if( !pSeg->repeated && (!sampled || now - pSeg->sentMs < rtt) )
+            {
+                rtt = now - pSeg->sentMs;
+                sampled = true;
+            }
+        }
+    }
+
+    // the link keeps the order, so what went out before a segment now
+    // acked and is still not acked itself is lost
+    if( progress )
+    {
+        for( seq = _txBase; seq != _txNext; seq++ )
+        {
+            pSeg = &_tx[seq & HC12_ARQ_WINDOW_MASK];
+            if( pSeg->state == HC12_ARQ_SEG_SENT &&
+                (int32_t) (pSeg->order - latest) < 0 )
+            {
+                pSeg->lost = true;
+            }
+        }
+    }
+
+    while( _txBase != _txNext &&
+           _tx[_txBase & HC12_ARQ_WINDOW_MASK].state == HC12_ARQ_SEG_ACKED )
+    {
+        _tx[_txBase & HC12_ARQ_WINDOW_MASK].state = HC12_ARQ_SEG_FREE;
+        _txBase++;
+    }
+
+    if( sampled )
+    {
+        sampleRtt( rtt );
+    }
+    else if( progress )
+    {
+        // the link is passing data again, drop the back off even
+        // without a sample (all of them repeated)
+        _rto = _rtoBase;
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Arq::sampleRtt( uint32_t rtt )
+ *
+ * RFC 6298 in integers, srtt scaled by 8 and rttvar by 4
+ ------------------------------------------------------------------------------
+*/
+void hc12Arq::sampleRtt( uint32_t rtt )
+{
+    int32_t delta;
+
+    if( rtt == 0 )
+    {
+        rtt = 1;
+    }
+
+    if( _srtt8 == 0 )
+    {
+        _srtt8 = rtt << 3;
+        _rttvar4 = rtt << 1;
+    }
+    else
+    {
+        delta = (int32_t) rtt - (int32_t) (_srtt8 >> 3);
+        _srtt8 += delta;
+        if( delta < 0 )
+        {
+            delta = -delta;
+        }
+        _rttvar4 += delta - (int32_t) (_rttvar4 >> 2);
+    }
+
+    _rto = (_srtt8 >> 3) + (_rttvar4 > 0 ? _rttvar4 : 1);
+
+    if( _rto < _param.rtoMin )
+    {
+        _rto = _param.rtoMin;
+    }
+    else if( _rto > _param.rtoMax )
+    {
+        _rto = _param.rtoMax;
+    }
+
+    _rtoBase = _rto;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Arq::service( void )
+ *
+ * take the frames received, send a due ack, repeat what is lost and
+ * send what is new, as far as the pacer and the peer's buffers allow
+ * returns HC12_ERR_OK, HC12_ERR_TIMEOUT if a segment went unanswered
+ * maxRetries times in a row, or an error code of the framer
+ ------------------------------------------------------------------------------
+*/
+int hc12Arq::service( void )
+{
+    int retVal = HC12_ERR_OK;
+    struct _hc12_arq_segment *pSeg;
+    const uint8_t *pData;
+    uint32_t now = nowMs();
+    bool blocked = false;
+    bool backedOff = false;
+    bool inFlight = false;
+    uint8_t seq;
+    int len;
+
+    if( _pRadio == NULL )
+    {
+        return( HC12_ERR_NULLP );
+    }
+
+    while( (len = _framer.receive( &pData )) > 0 )
+    {
+        switch( pData[0] )
+        {
+            case HC12_ARQ_DATA:
+                handleData( pData, len, now );
+                break;
+            case HC12_ARQ_ACK:
+                handleAck( pData, len, now );
+                break;
+        }
+    }
+
+    if( len < 0 )
+    {
+        return( len );
+    }
+
+    if( _ackPending && (int32_t) (now - _ackDueMs) >= 0 )
+    {
+        sendAck();
+    }
+
+    for( seq = _txBase; seq != _txNext && !blocked &&
+                        retVal == HC12_ERR_OK; seq++ )
+    {
+        pSeg = &_tx[seq & HC12_ARQ_WINDOW_MASK];
+
+        if( pSeg->state == HC12_ARQ_SEG_SENT )
+        {
+            inFlight = true;
+
+            if( pSeg->lost )
+            {
+                if( transmit( seq, now ) > 0 )
+                {
+                    pSeg->lost = false;
+                    pSeg->repeated = true;
+                    _stats.fastRetransmits++;
+                }
+                else
+                {
+                    blocked = true;
+                }
+            }
+            else if( now - pSeg->sentMs >= _rto )
+            {
+                if( pSeg->tries >= _param.maxRetries )
+                {
+                    retVal = HC12_ERR_TIMEOUT;
+                }
+                else if( transmit( seq, now ) > 0 )
+                {
+                    pSeg->tries++;
+                    pSeg->repeated = true;
+                    _stats.retransmits++;
+
+                    // once per round, not per segment lost in it
+                    if( !backedOff )
+                    {
+                        backedOff = true;
+                        _rto = _rto * 2 < _param.rtoMax ?
+                                               _rto * 2 : _param.rtoMax;
+                    }
+
+                    HC12_LOG_DEBUG( HC12_EV_ARQ_TIMEOUT, this, seq, _rto );
+                }
+                else
+                {
+                    blocked = true;
+                }
+            }
+        }
+        else if( pSeg->state == HC12_ARQ_SEG_QUEUED )
+        {
+            if( (uint8_t) (seq - _peerLimit) < HC12_ARQ_SEQ_HALF )
+            {
+                // no buffer on the other side. If nothing in flight
+                // brings the ack that opens the window, ask with a
+                // segment now and then.
+                if( !inFlight && now - _probeMs >= _rto &&
+                    transmit( seq, now ) > 0 )
+                {
+                    _probeMs = now;
+                }
+                blocked = true;
+            }
+            else if( transmit( seq, now ) > 0 )
+            {
+                inFlight = true;
+            }
+            else
+            {
+                blocked = true;
+            }
+        }
+    }
+
+    return( retVal );
+}
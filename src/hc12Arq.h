@@ -0,0 +1,188 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Arq.h - reliable byte stream over the transparent link
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_ARQ_H_
+#define _HC12_ARQ_H_
+
+#include "hc12Frame.h"
+
+//
+// Selective repeat on top of hc12Framer. Every frame starts with its
+// type:
+//
+//   data  HC12_ARQ_DATA  seq  payload
+//   ack   HC12_ARQ_ACK   ack  limit  sack (4 bytes, MSB first)
+//
+// seq counts segments modulo 256. ack is the first segment the
+// receiver is missing, all before it arrived. Bit n of sack stands for
+// segment ack + 1 + n, received out of order. limit is the first
+// segment the receiver has no buffer for, the sender stays below it.
+//
+// The sender keeps up to window segments in flight and repeats one if
+// it is not acked within the retransmission timeout, or at once if one
+// sent after it is acked, cumulatively or selectively. The timeout
+// follows the measured round trip time (Jacobson/Karels, samples of
+// repeated segments are not taken, Karn) and doubles with every
+// timeout.
+//
+// The receiver acks after ackEvery segments, ackDelay ms after the
+// first unacked one, and at once for anything out of order or
+// duplicated, so a half-duplex link is not turned around for each
+// segment.
+//
+// Both ends start with segment 0 after construction or reset(), there
+// is no connection setup.
+//
+#if defined(ARDUINO)
+    #define HC12_ARQ_WINDOW         4
+#else // NOT on Arduino platform
+    #define HC12_ARQ_WINDOW        16
+#endif // defined(ARDUINO)
+
+#define HC12_ARQ_WINDOW_MASK       (HC12_ARQ_WINDOW - 1)
+#define HC12_ARQ_DATA_HEADER        2    // type, seq
+#define HC12_ARQ_ACK_SIZE           7    // type, ack, limit, sack
+#define HC12_ARQ_SEGMENT_MAX       (HC12_FRAME_MAX_PAYLOAD - \
+                                    HC12_ARQ_DATA_HEADER)
+
+static_assert( (HC12_ARQ_WINDOW & HC12_ARQ_WINDOW_MASK) == 0 &&
+               HC12_ARQ_WINDOW <= 32,
+               "window has to be a power of two that sack can cover" );
+
+#define HC12_ARQ_DATA            0x44    // 'D'
+#define HC12_ARQ_ACK             0x41    // 'A'
+
+// per FU mode, see hc12Arq::defaults()
+struct _hc12_arq_param {
+    int      window;                      // segments, up to HC12_ARQ_WINDOW
+    int      segment;                     // payload bytes per segment
+    int      ackEvery;                    // segments per ack
+    uint32_t ackDelay;                    // ms
+    uint32_t rtoInit;                     // ms, before the first sample
+    uint32_t rtoMin;                      // ms
+    uint32_t rtoMax;                      // ms
+    int      maxRetries;                  // timeouts without an ack heard
+};
+
+struct _hc12_arq_stats {
+    uint32_t segmentsSent;                // first transmissions
+    uint32_t retransmits;                 // after a timeout
+    uint32_t fastRetransmits;             // a later one was acked
+    uint32_t acksSent;
+    uint32_t acksReceived;
+    uint32_t duplicates;                  // segments received twice
+    uint32_t outOfWindow;                 // segments without a buffer
+    uint32_t bytesSent;                   // acked
+    uint32_t bytesReceived;               // delivered to receive()
+};
+
+#define HC12_ARQ_SEG_FREE           0
+#define HC12_ARQ_SEG_QUEUED         1    // filled, never sent
+#define HC12_ARQ_SEG_SENT           2
+#define HC12_ARQ_SEG_ACKED          3
+
+struct _hc12_arq_segment {
+    uint8_t  state;
+    uint8_t  len;                         // payload
+    uint8_t  tries;                       // timeouts without an ack heard
+    bool     lost;                        // one sent after it was acked
+    bool     repeated;                    // no RTT sample, Karn
+    uint32_t sentMs;
+    uint32_t order;                       // of the last transmission
+    uint8_t  frame[HC12_FRAME_MAX_PAYLOAD];   // header and payload
+};
+
+struct _hc12_arq_slot {
+    bool     valid;
+    uint8_t  len;
+    uint8_t  data[HC12_ARQ_SEGMENT_MAX];
+};
+
+//
+// The ARQ owns the framer and with it the transparent mode data path of
+// the radio. The application calls service() regularly, it moves the
+// frames in both directions and runs the timers; send() and receive()
+// only deal with the buffers.
+//
+class hc12Arq {
+
+  protected:
+    hc12Radio  *_pRadio;
+    hc12Framer  _framer;
+    struct _hc12_arq_param _param;
+    struct _hc12_arq_stats _stats;
+
+// sender
+    struct _hc12_arq_segment _tx[HC12_ARQ_WINDOW];
+    uint8_t     _txBase;                  // oldest segment not acked
+    uint8_t     _txNext;                  // next one to fill
+    uint8_t     _peerLimit;               // first one without a buffer
+    uint32_t    _txOrder;                 // transmissions so far
+    uint32_t    _probeMs;
+
+// round trip time, ms scaled by 8 resp. 4 as in TCP
+    uint32_t    _srtt8;
+    uint32_t    _rttvar4;
+    uint32_t    _rtoBase;                 // without the back off
+    uint32_t    _rto;
+
+// receiver
+    struct _hc12_arq_slot _rx[HC12_ARQ_WINDOW];
+    uint8_t     _rxBase;                  // next one to deliver
+    uint8_t     _rxOffset;                // bytes of it delivered
+    uint8_t     _advLimit;                // limit of the last ack
+    bool        _ackPending;
+    int         _ackCount;
+    uint32_t    _ackDueMs;
+
+    static uint32_t nowMs( void );
+
+    uint8_t cumulativeAck( void );
+    int  transmit( uint8_t seq, uint32_t now );
+    int  sendAck( void );
+    void handleData( const uint8_t *pData, int len, uint32_t now );
+    void handleAck( const uint8_t *pData, int len, uint32_t now );
+    void sampleRtt( uint32_t rtt );
+
+  public:
+    hc12Arq( hc12Radio *pRadio );
+
+    static void defaults( int ttMode, struct _hc12_arq_param *pParam );
+    int  setParam( const struct _hc12_arq_param *pParam );
+    void getParam( struct _hc12_arq_param *pParam ) { *pParam = _param; }
+    void reset( void );
+
+    int send( const void *pData, size_t len );
+    int receive( void *pData, size_t len );
+    int service( void );
+
+// bytes handed to send() and not acked yet
+    size_t pending( void );
+    uint32_t rto( void ) { return( _rto ); }
+    uint32_t srtt( void ) { return( _srtt8 >> 3 ); }
+
+    void getStats( struct _hc12_arq_stats *pStats ) { *pStats = _stats; }
+    void getFrameStats( struct _hc12_frame_stats *pStats )
+                                      { _framer.getStats( pStats ); }
+};
+
+#endif // _HC12_ARQ_H_
@@ -0,0 +1,401 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Async.cpp - non-blocking hc-12 commands completing through
+ *                  callbacks or futures (Linux only)
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Async.h"
+
+#if defined(__linux__)
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Async::hc12Async( void )
+ ------------------------------------------------------------------------------
+*/
+hc12Async::hc12Async( void )
+{
+    _stop = false;
+    _running = false;
+
+    for( int id = 0; id < HC12_REACTOR_MAX_RADIOS; id++ )
+    {
+        _pRadio[id] = NULL;
+        _pData[id] = NULL;
+        _pUser[id] = NULL;
+        _submitted[id] = 0;
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Async::~hc12Async( void )
+ ------------------------------------------------------------------------------
+*/
+hc12Async::~hc12Async( void )
+{
+    stop();
+    _reactor.close();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Async::add( hc12Radio *pRadio, hc12DataReady pData, void *pUser )
+ *
+ * take over a connected radio, see hc12Reactor::add(). pData (may be
+ * NULL) is called in the reactor thread when transparent mode data
+ * has arrived.
+ * returns the id of the radio or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Async::add( hc12Radio *pRadio, hc12DataReady pData, void *pUser )
+{
+    int retVal;
+
+    if( _running )
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+    else if( (retVal = _reactor.open()) == HC12_ERR_OK &&
+             (retVal = _reactor.add( pRadio, commandDone, dataReady,
+                                     this )) >= 0 )
+    {
+        _pRadio[retVal] = pRadio;
+        _pData[retVal] = pData;
+        _pUser[retVal] = pUser;
+        _submitted[retVal] = 0;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Async::start( void )
+ *
+ * start the reactor thread, commands queued before start off now
+ * returns HC12_ERR_OK or HC12_ERR_FAIL
+ ------------------------------------------------------------------------------
+*/
+int hc12Async::start( void )
+{
+    int retVal = HC12_ERR_OK;
+
+    if( !_running )
+    {
+        if( (retVal = _reactor.open()) == HC12_ERR_OK )
+        {
+            _stop = false;
+            _thread = std::thread( &hc12Async::loop, this );
+            _running = true;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::stop( void )
+ *
+ * end the reactor thread. Commands not completed yet are failed with
+ * HC12_ERR_FAIL.
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::stop( void )
+{
+    if( _running )
+    {
+        _stop = true;
+        _reactor.wakeup();
+        _thread.join();
+        _running = false;
+    }
+
+    failAll();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Async::submit( int id, int command, int arg, hc12AsyncDone done )
+ *
+ * queue a HC12_CMD_CODE_* command or HC12_REACTOR_ENTER_CMD /
+ * HC12_REACTOR_LEAVE_CMD, may be called from any thread. done (may be
+ * empty) receives the result in the reactor thread.
+ * returns HC12_ERR_OK or HC12_ERR_ARGS
+ ------------------------------------------------------------------------------
+*/
+int hc12Async::submit( int id, int command, int arg, hc12AsyncDone done )
+{
+    int retVal = HC12_ERR_OK;
+    struct _hc12_async_entry entry;
+
+    if( id < 0 || id >= HC12_REACTOR_MAX_RADIOS || _pRadio[id] == NULL )
+    {
+        retVal = HC12_ERR_ARGS;
+    }
+    else
+    {
+        entry.command = command;
+        entry.arg = arg;
+        entry.done = done;
+
+        {
+            std::lock_guard<std::mutex> guard( _lock );
+            _incoming.push_back( std::make_pair( id, entry ) );
+        }
+
+        _reactor.wakeup();
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * std::future<struct _hc12_async_result> hc12Async::submit( int id,
+ *                                             int command, int arg )
+ *
+ * queue a command like above, the future delivers the result
+ ------------------------------------------------------------------------------
+*/
+std::future<struct _hc12_async_result> hc12Async::submit( int id,
+                                                 int command, int arg )
+{
+    std::shared_ptr< std::promise<struct _hc12_async_result> > pPromise =
+                 std::make_shared< std::promise<struct _hc12_async_result> >();
+    std::future<struct _hc12_async_result> retVal = pPromise->get_future();
+    struct _hc12_async_result result;
+
+    if( (result.result = submit( id, command, arg,
+              [pPromise]( const struct _hc12_async_result *pResult )
+              { pPromise->set_value( *pResult ); } )) != HC12_ERR_OK )
+    {
+        memset( &result.response, '\0', sizeof(result.response) );
+        memset( &result.param, '\0', sizeof(result.param) );
+        result.command = command;
+        result.arg = arg;
+        pPromise->set_value( result );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Async::radioId( hc12Radio *pRadio )
+ ------------------------------------------------------------------------------
+*/
+int hc12Async::radioId( hc12Radio *pRadio )
+{
+    int retVal = -1;
+
+    for( int id = 0; id < HC12_REACTOR_MAX_RADIOS && retVal < 0; id++ )
+    {
+        if( _pRadio[id] == pRadio )
+        {
+            retVal = id;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::finish( int id, int result )
+ *
+ * the oldest command submitted to the reactor is done, report it
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::finish( int id, int result )
+{
+    struct _hc12_async_entry entry;
+    struct _hc12_async_result rsp;
+
+    if( !_queue[id].empty() )
+    {
+        entry = _queue[id].front();
+        _queue[id].pop_front();
+        if( _submitted[id] > 0 )
+        {
+            _submitted[id]--;
+        }
+
+        rsp.command = entry.command;
+        rsp.arg = entry.arg;
+        rsp.result = result;
+        rsp.response = *_pRadio[id]->lastResponse();
+        _pRadio[id]->getCachedParam( &rsp.param );
+
+        if( entry.done )
+        {
+            entry.done( &rsp );
+        }
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::commandDone( hc12Radio *pRadio, int, int,
+ *                              int result, void *pUser )
+ *
+ * command and arg are not needed, the reactor completes the commands of
+ * a radio in order, see finish()
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::commandDone( hc12Radio *pRadio, int, int,
+                             int result, void *pUser )
+{
+    hc12Async *pAsync = (hc12Async*) pUser;
+    int id;
+
+    if( (id = pAsync->radioId( pRadio )) >= 0 )
+    {
+        pAsync->finish( id, result );
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::dataReady( hc12Radio *pRadio, size_t available,
+ *                            void *pUser )
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::dataReady( hc12Radio *pRadio, size_t available,
+                           void *pUser )
+{
+    hc12Async *pAsync = (hc12Async*) pUser;
+    int id;
+
+    if( (id = pAsync->radioId( pRadio )) >= 0 && pAsync->_pData[id] != NULL )
+    {
+        pAsync->_pData[id]( pRadio, available, pAsync->_pUser[id] );
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::feed( int id )
+ *
+ * pass queued commands on to the reactor as far as its queue takes them
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::feed( int id )
+{
+    struct _hc12_async_entry *pEntry;
+    int result;
+
+    while( _submitted[id] < (int) _queue[id].size() &&
+           _submitted[id] < HC12_REACTOR_QUEUE )
+    {
+        pEntry = &_queue[id][_submitted[id]];
+        // the reactor may complete it right away
+        _submitted[id]++;
+
+        if( (result = _reactor.submit( id, pEntry->command,
+                                       pEntry->arg )) != HC12_ERR_OK )
+        {
+            // not taken, so all submitted before are done already
+            finish( id, result );
+        }
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::takeIncoming( void )
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::takeIncoming( void )
+{
+    std::vector< std::pair<int, struct _hc12_async_entry> > incoming;
+    size_t i;
+
+    {
+        std::lock_guard<std::mutex> guard( _lock );
+        incoming.swap( _incoming );
+    }
+
+    for( i = 0; i < incoming.size(); i++ )
+    {
+        _queue[incoming[i].first].push_back( incoming[i].second );
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::loop( void )
+ *
+ * body of the reactor thread
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::loop( void )
+{
+    int id;
+
+    while( !_stop )
+    {
+        takeIncoming();
+
+        for( id = 0; id < HC12_REACTOR_MAX_RADIOS; id++ )
+        {
+            if( _submitted[id] < (int) _queue[id].size() )
+            {
+                feed( id );
+            }
+        }
+
+        if( _reactor.runOnce( -1 ) < 0 )
+        {
+            break;
+        }
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Async::failAll( void )
+ *
+ * the reactor thread is gone, fail whatever is left
+ ------------------------------------------------------------------------------
+*/
+void hc12Async::failAll( void )
+{
+    int id;
+
+    takeIncoming();
+
+    for( id = 0; id < HC12_REACTOR_MAX_RADIOS; id++ )
+    {
+        if( _pRadio[id] != NULL )
+        {
+            _reactor.cancel( id );
+        }
+
+        while( !_queue[id].empty() )
+        {
+            finish( id, HC12_ERR_FAIL );
+        }
+        _submitted[id] = 0;
+    }
+}
+
+#endif // defined(__linux__)
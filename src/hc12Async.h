@@ -0,0 +1,133 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Async.h - non-blocking hc-12 commands completing through
+ *                callbacks or futures (Linux only)
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_ASYNC_H_
+#define _HC12_ASYNC_H_
+
+#if defined(__linux__)
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hc12Reactor.h"
+
+//
+// what a command has brought: result is HC12_ERR_OK or an error code,
+// response the last reply line, param the parameter cache of the
+// radio after the command
+//
+struct _hc12_async_result {
+    int command;
+    int arg;
+    int result;
+    struct _hc12_response response;
+    struct _hc12_param param;
+};
+
+typedef std::function<void( const struct _hc12_async_result *pResult )>
+                                                              hc12AsyncDone;
+
+struct _hc12_async_entry {
+    int command;
+    int arg;
+    hc12AsyncDone done;
+};
+
+//
+// A hc12Reactor running in a thread of its own. Commands may be queued
+// from any thread, every call returns at once. Completion callbacks run
+// in the reactor thread, in the order the commands of a radio were
+// queued; they must not wait for a future of this instance.
+// Radios are added before start().
+//
+class hc12Async {
+
+  protected:
+    hc12Reactor _reactor;
+    std::thread _thread;
+    std::mutex  _lock;
+    std::atomic<bool> _stop;
+    bool        _running;
+    hc12Radio  *_pRadio[HC12_REACTOR_MAX_RADIOS];
+    hc12DataReady _pData[HC12_REACTOR_MAX_RADIOS];
+    void       *_pUser[HC12_REACTOR_MAX_RADIOS];
+
+    // taken over by the reactor thread
+    std::vector< std::pair<int, struct _hc12_async_entry> > _incoming;
+
+    // reactor thread only
+    std::deque<struct _hc12_async_entry> _queue[HC12_REACTOR_MAX_RADIOS];
+    int         _submitted[HC12_REACTOR_MAX_RADIOS];
+
+    static void commandDone( hc12Radio *pRadio, int command, int arg,
+                             int result, void *pUser );
+    static void dataReady( hc12Radio *pRadio, size_t available,
+                           void *pUser );
+    int  radioId( hc12Radio *pRadio );
+    void finish( int id, int result );
+    void feed( int id );
+    void takeIncoming( void );
+    void loop( void );
+    void failAll( void );
+
+  public:
+    hc12Async( void );
+    ~hc12Async( void );
+
+    int  add( hc12Radio *pRadio, hc12DataReady pData = NULL,
+              void *pUser = NULL );
+    int  start( void );
+    void stop( void );
+
+    int  submit( int id, int command, int arg, hc12AsyncDone done );
+    std::future<struct _hc12_async_result> submit( int id, int command,
+                                                   int arg = 0 );
+
+// same as the blocking methods of hc12Radio
+    std::future<struct _hc12_async_result> enterCommandMode( int id )
+                   { return( submit( id, HC12_REACTOR_ENTER_CMD ) ); }
+    std::future<struct _hc12_async_result> leaveCommandMode( int id )
+                   { return( submit( id, HC12_REACTOR_LEAVE_CMD ) ); }
+    std::future<struct _hc12_async_result> test( int id )
+                   { return( submit( id, HC12_CMD_CODE_TEST ) ); }
+    std::future<struct _hc12_async_result> setBaud( int id, uint32_t baud )
+                   { return( submit( id, HC12_CMD_CODE_SET_BAUD, baud ) ); }
+    std::future<struct _hc12_async_result> setComChannel( int id, int chan )
+                   { return( submit( id, HC12_CMD_CODE_SET_CHANNEL, chan ) ); }
+    std::future<struct _hc12_async_result> setTTMode( int id, int mode )
+                   { return( submit( id, HC12_CMD_CODE_SET_TTMODE, mode ) ); }
+    std::future<struct _hc12_async_result> setTPower( int id, int power )
+                   { return( submit( id, HC12_CMD_CODE_SET_POWER, power ) ); }
+    std::future<struct _hc12_async_result> getParam( int id )
+                   { return( submit( id, HC12_CMD_CODE_GET_PARAM ) ); }
+    std::future<struct _hc12_async_result> getFWVersion( int id )
+                   { return( submit( id, HC12_CMD_CODE_GET_VERSION ) ); }
+};
+
+#endif // defined(__linux__)
+
+#endif // _HC12_ASYNC_H_
@@ -0,0 +1,104 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Command.cpp - formatting of the hc-12 AT commands
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include <string.h>
+
+#include "hc12Command.h"
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12EncodeUnsigned( uint32_t value, int minDigits, char *pBuffer )
+ *
+ * write value in decimal, padded with leading zeros to minDigits.
+ * No terminating '\0'.
+ * returns the amount of characters written
+ ------------------------------------------------------------------------------
+*/
+int hc12EncodeUnsigned( uint32_t value, int minDigits, char *pBuffer )
+{
+    char digits[HC12_ARG_MAX_DEC];
+    int retVal = 0;
+    int len = 0;
+
+    do
+    {
+        digits[len++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while( value != 0 );
+
+    while( len < minDigits && len < HC12_ARG_MAX_DEC )
+    {
+        digits[len++] = '0';
+    }
+
+    while( len > 0 )
+    {
+        pBuffer[retVal++] = digits[--len];
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12FormatCommand( int command, int32_t arg, char *pBuffer )
+ *
+ * write the line of command (HC12_CMD_CODE_*) with its argument, if
+ * any, to pBuffer. It is terminated by '\0', pBuffer has to hold
+ * hc12CommandMaxLen( command ) + 1 characters. arg is not range
+ * checked.
+ * returns the length of the line or -1 for an unknown command
+ ------------------------------------------------------------------------------
+*/
+int hc12FormatCommand( int command, int32_t arg, char *pBuffer )
+{
+    const struct _hc12_cmd_desc *pDesc;
+    int retVal = -1;
+
+    if( (pDesc = hc12CommandDesc( command )) != NULL )
+    {
+        memcpy( pBuffer, pDesc->prefix, pDesc->prefixLen );
+        retVal = pDesc->prefixLen;
+
+        switch( pDesc->argEnc )
+        {
+            case HC12_ARG_ENC_DEC:
+                retVal += hc12EncodeUnsigned( (uint32_t) arg, 1,
+                                              &pBuffer[retVal] );
+                break;
+            case HC12_ARG_ENC_DEC3:
+                retVal += hc12EncodeUnsigned( (uint32_t) arg, 3,
+                                              &pBuffer[retVal] );
+                break;
+            case HC12_ARG_ENC_SERIAL:
+                pBuffer[retVal++] = (char) ('0' + ((arg >> 16) & 0xff));
+                pBuffer[retVal++] = (char) ((arg >> 8) & 0xff);
+                pBuffer[retVal++] = (char) ('0' + (arg & 0xff));
+                break;
+        }
+
+        pBuffer[retVal++] = '\n';
+        pBuffer[retVal] = '\0';
+    }
+
+    return( retVal );
+}
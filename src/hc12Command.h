@@ -0,0 +1,202 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Command.h - table of the hc-12 AT commands
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_COMMAND_H_
+#define _HC12_COMMAND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hc12Parser.h"
+
+#define HC12_CMD_CODE_NULL          0
+#define HC12_CMD_CODE_TEST         20
+#define HC12_CMD_CODE_SET_DEFAULT  21
+#define HC12_CMD_CODE_SLEEP        22
+#define HC12_CMD_CODE_UPDATE       23
+#define HC12_CMD_CODE_SET_BAUD     24
+#define HC12_CMD_CODE_SET_CHANNEL  25
+#define HC12_CMD_CODE_SET_TTMODE   26
+#define HC12_CMD_CODE_SET_POWER    27
+#define HC12_CMD_CODE_SET_PARAM    28
+#define HC12_CMD_CODE_SET_SERIAL   29
+#define HC12_CMD_CODE_GET_BAUD     30
+#define HC12_CMD_CODE_GET_CHANNEL  31
+#define HC12_CMD_CODE_GET_TTMODE   32
+#define HC12_CMD_CODE_GET_POWER    33
+#define HC12_CMD_CODE_GET_PARAM    34
+#define HC12_CMD_CODE_GET_SERIAL   35
+#define HC12_CMD_CODE_GET_VERSION  36
+#define HC12_CMD_CODE_FIRST        HC12_CMD_CODE_TEST
+#define HC12_CMD_CODE_LAST         HC12_CMD_CODE_GET_VERSION
+
+// order of the fields is the order the commands are sent in,
+// the baud rate comes last
+#define HC12_PARAM_FIELD_NONE      -1
+#define HC12_PARAM_FIELD_CHANNEL    0
+#define HC12_PARAM_FIELD_POWER      1
+#define HC12_PARAM_FIELD_TTMODE     2
+#define HC12_PARAM_FIELD_BAUD       3
+#define HC12_PARAM_FIELDS           4
+// cached only, not part of applyParam()
+#define HC12_PARAM_FIELD_VERSION    4
+#define HC12_PARAM_FIELD_SERIAL     5
+#define HC12_PARAM_CACHED_FIELDS    6
+
+// how the argument follows the prefix
+#define HC12_ARG_ENC_NONE           0
+#define HC12_ARG_ENC_DEC            1    // AT+B9600
+#define HC12_ARG_ENC_DEC3           2    // AT+C001, three digits
+#define HC12_ARG_ENC_SERIAL         3    // AT+U8N1, see HC12_SERIAL_ARG()
+
+// longest argument of an encoding, in characters. DEC3 pads to three
+// digits but is not cut to them.
+#define HC12_ARG_MAX_DEC           10
+#define HC12_ARG_MAX_SERIAL         3
+
+// databits, parity and stopbits packed into the argument of AT+U
+#define HC12_SERIAL_ARG(d,p,s)     ((((int32_t) (d)) << 16) | \
+                                    (((int32_t) (p)) << 8) | (int32_t) (s))
+
+// when the reply is complete
+#define HC12_DONE_ARGS              0    // rspArgs values have been parsed
+#define HC12_DONE_SEEN_RX           1    // a line for each AT+RX value
+
+//
+// everything known about a command: how it is written, which reply
+// line it gets and when that reply is complete. field is the entry of
+// the parameter cache the reply confirms, echo is set if the reply has
+// to repeat the argument.
+//
+struct _hc12_cmd_desc {
+    int8_t      code;
+    const char *prefix;
+    uint8_t     prefixLen;
+    uint8_t     argEnc;
+    int8_t      rspType;
+    uint8_t     rspArgs;
+    uint8_t     rspLines;
+    uint8_t     done;
+    int8_t      field;
+    bool        echo;
+};
+
+#define HC12_CMD_PREFIX(s)         s, (uint8_t) (sizeof(s) - 1)
+
+//
+// indexed by code - HC12_CMD_CODE_FIRST
+// AT+DEFAULT stands in for the commands the module does not have
+//
+static constexpr struct _hc12_cmd_desc hc12CmdTable[] = {
+    { HC12_CMD_CODE_TEST,        HC12_CMD_PREFIX("AT"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_OK,        0, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_NONE,    false },
+    { HC12_CMD_CODE_SET_DEFAULT, HC12_CMD_PREFIX("AT+DEFAULT"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_DEFAULT,   0, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_NONE,    false },
+    { HC12_CMD_CODE_SLEEP,       HC12_CMD_PREFIX("AT+SLEEP"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_SLEEP,     0, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_NONE,    false },
+    { HC12_CMD_CODE_UPDATE,      HC12_CMD_PREFIX("AT+UPDATE"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_UNKNOWN,   0, 0, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_NONE,    false },
+    { HC12_CMD_CODE_SET_BAUD,    HC12_CMD_PREFIX("AT+B"),
+      HC12_ARG_ENC_DEC,    HC12_RSP_TYPE_BAUD,      1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_BAUD,    true  },
+    { HC12_CMD_CODE_SET_CHANNEL, HC12_CMD_PREFIX("AT+C"),
+      HC12_ARG_ENC_DEC3,   HC12_RSP_TYPE_CHANNEL,   1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_CHANNEL, true  },
+    { HC12_CMD_CODE_SET_TTMODE,  HC12_CMD_PREFIX("AT+FU"),
+      HC12_ARG_ENC_DEC,    HC12_RSP_TYPE_TTMODE,    1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_TTMODE,  true  },
+    { HC12_CMD_CODE_SET_POWER,   HC12_CMD_PREFIX("AT+P"),
+      HC12_ARG_ENC_DEC,    HC12_RSP_TYPE_POWER,     1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_POWER,   true  },
+    { HC12_CMD_CODE_SET_PARAM,   HC12_CMD_PREFIX("AT+DEFAULT"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_DEFAULT,   0, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_NONE,    false },
+    { HC12_CMD_CODE_SET_SERIAL,  HC12_CMD_PREFIX("AT+U"),
+      HC12_ARG_ENC_SERIAL, HC12_RSP_TYPE_SERIAL,    3, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_SERIAL,  false },
+    { HC12_CMD_CODE_GET_BAUD,    HC12_CMD_PREFIX("AT+RB"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_BAUD,      1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_BAUD,    false },
+    { HC12_CMD_CODE_GET_CHANNEL, HC12_CMD_PREFIX("AT+RC"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_CHANNEL,   1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_CHANNEL, false },
+    { HC12_CMD_CODE_GET_TTMODE,  HC12_CMD_PREFIX("AT+RF"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_TTMODE,    1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_TTMODE,  false },
+    { HC12_CMD_CODE_GET_POWER,   HC12_CMD_PREFIX("AT+RP"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_POWER_DBM, 1, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_POWER,   false },
+    { HC12_CMD_CODE_GET_PARAM,   HC12_CMD_PREFIX("AT+RX"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_UNKNOWN,   4, 4, HC12_DONE_SEEN_RX,
+      HC12_PARAM_FIELD_NONE,    false },
+    { HC12_CMD_CODE_GET_SERIAL,  HC12_CMD_PREFIX("AT+DEFAULT"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_DEFAULT,   0, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_NONE,    false },
+    { HC12_CMD_CODE_GET_VERSION, HC12_CMD_PREFIX("AT+V"),
+      HC12_ARG_ENC_NONE,   HC12_RSP_TYPE_VERSION,   2, 1, HC12_DONE_ARGS,
+      HC12_PARAM_FIELD_VERSION, false },
+};
+
+#define HC12_CMD_TABLE_SIZE \
+    (sizeof(hc12CmdTable) / sizeof(hc12CmdTable[0]))
+
+// single return statements only, this has to build as C++11 (Arduino)
+
+constexpr bool hc12CmdTableOrdered( unsigned int i )
+{
+    return( i >= HC12_CMD_TABLE_SIZE ||
+            (hc12CmdTable[i].code == (int) (HC12_CMD_CODE_FIRST + i) &&
+             hc12CmdTableOrdered( i + 1 )) );
+}
+
+static_assert( hc12CmdTableOrdered( 0 ) &&
+               HC12_CMD_TABLE_SIZE ==
+                      HC12_CMD_CODE_LAST - HC12_CMD_CODE_FIRST + 1,
+               "hc12CmdTable has to be indexed by command code" );
+
+// descriptor of command or NULL
+constexpr const struct _hc12_cmd_desc* hc12CommandDesc( int command )
+{
+    return( command >= HC12_CMD_CODE_FIRST && command <= HC12_CMD_CODE_LAST ?
+            &hc12CmdTable[command - HC12_CMD_CODE_FIRST] : NULL );
+}
+
+// longest line command may produce, newline included
+constexpr int hc12CommandMaxLen( int command )
+{
+    return( hc12CommandDesc( command ) == NULL ? 0 :
+            hc12CommandDesc( command )->prefixLen + 1 +
+            (hc12CommandDesc( command )->argEnc == HC12_ARG_ENC_DEC ||
+             hc12CommandDesc( command )->argEnc == HC12_ARG_ENC_DEC3 ?
+                                                   HC12_ARG_MAX_DEC :
+             hc12CommandDesc( command )->argEnc == HC12_ARG_ENC_SERIAL ?
+                                                   HC12_ARG_MAX_SERIAL : 0) );
+}
+
+int hc12EncodeUnsigned( uint32_t value, int minDigits, char *pBuffer );
+int hc12FormatCommand( int command, int32_t arg, char *pBuffer );
+
+#endif // _HC12_COMMAND_H_
@@ -0,0 +1,325 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Coro.h - C++20 coroutine interface for hc-12 command sequences
+ *               (Linux only)
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_CORO_H_
+#define _HC12_CORO_H_
+
+//
+// Header only: the library itself is built with an older standard,
+// everything here is compiled with the application (-std=c++20).
+//
+#if defined(__linux__) && __cplusplus >= 202002L && \
+    defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include "hc12Reactor.h"
+
+class hc12CoExecutor;
+
+//
+// A command sequence. Its body runs only inside hc12CoExecutor::run(),
+// co_return hands back HC12_ERR_OK or an error code:
+//
+//     hc12CoTask bringUp( hc12CoExecutor &exec, int id )
+//     {
+//         int rc;
+//
+//         if( (rc = co_await exec.enterCommandMode( id )) == HC12_ERR_OK &&
+//             (rc = co_await exec.test( id )) == HC12_ERR_OK &&
+//             (rc = co_await exec.getParam( id )) == HC12_ERR_OK )
+//         {
+//             rc = co_await exec.setComChannel( id, 21 );
+//         }
+//         co_await exec.leaveCommandMode( id );
+//         co_return( rc );
+//     }
+//
+//     exec.spawn( bringUp( exec, id ) );
+//     exec.run();
+//
+class hc12CoTask {
+
+  public:
+    struct promise_type {
+        int result = HC12_ERR_OK;
+
+        hc12CoTask get_return_object( void )
+            { return( hc12CoTask( std::coroutine_handle<promise_type>::
+                                               from_promise( *this ) ) ); }
+        // started by the executor, destroyed by it when done
+        std::suspend_always initial_suspend( void ) noexcept { return {}; }
+        std::suspend_always final_suspend( void ) noexcept { return {}; }
+        void return_value( int value ) { result = value; }
+        void unhandled_exception( void ) { result = HC12_ERR_FAIL; }
+    };
+
+    std::coroutine_handle<promise_type> _handle;
+
+    explicit hc12CoTask( std::coroutine_handle<promise_type> handle )
+        : _handle( handle ) {}
+    hc12CoTask( hc12CoTask &&other ) noexcept : _handle( other._handle )
+        { other._handle = nullptr; }
+    hc12CoTask( const hc12CoTask& ) = delete;
+    ~hc12CoTask( void ) { if( _handle ) _handle.destroy(); }
+};
+
+//
+// co_await yields the HC12_ERR_* result of a command, a mode switch
+// (settle time included) or a pause
+//
+struct hc12CoAwait {
+    hc12CoExecutor *pExec;
+    int             id;
+    int             command;
+    int             arg;
+    int             result;
+    std::coroutine_handle<> handle;
+
+    bool await_ready( void ) { return( false ); }
+    inline void await_suspend( std::coroutine_handle<> h );
+    int  await_resume( void ) { return( result ); }
+};
+
+#define HC12_CO_SLEEP              -1
+
+//
+// Single threaded: the coroutines and the hc12Reactor share the thread
+// calling run(). Completions only mark a coroutine ready, it is resumed
+// from the top of the loop, so stacks never nest.
+//
+class hc12CoExecutor {
+
+  protected:
+    struct _hc12_co_timer {
+        uint64_t     deadline;
+        hc12CoAwait *pAwait;
+        bool operator>( const struct _hc12_co_timer &other ) const
+            { return( deadline > other.deadline ); }
+    };
+
+    hc12Reactor _reactor;
+    hc12Radio  *_pRadio[HC12_REACTOR_MAX_RADIOS] = {};
+    std::deque<hc12CoAwait*> _waiting[HC12_REACTOR_MAX_RADIOS];
+    std::deque< std::coroutine_handle<> > _ready;
+    std::priority_queue< struct _hc12_co_timer,
+                         std::vector<struct _hc12_co_timer>,
+                         std::greater<struct _hc12_co_timer> > _timers;
+    std::vector< std::coroutine_handle<hc12CoTask::promise_type> > _tasks;
+    int         _failed = 0;
+
+    static uint64_t nowMs( void )
+    {
+        struct timespec ts;
+
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        return( (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000 );
+    }
+
+    static void commandDone( hc12Radio *pRadio, int, int,
+                             int result, void *pUser )
+    {
+        hc12CoExecutor *pExec = (hc12CoExecutor*) pUser;
+        hc12CoAwait *pAwait;
+
+        for( int id = 0; id < HC12_REACTOR_MAX_RADIOS; id++ )
+        {
+            if( pExec->_pRadio[id] == pRadio && !pExec->_waiting[id].empty() )
+            {
+                // the reactor completes the commands of a radio in order
+                pAwait = pExec->_waiting[id].front();
+                pExec->_waiting[id].pop_front();
+                pAwait->result = result;
+                pExec->_ready.push_back( pAwait->handle );
+                break;
+            }
+        }
+    }
+
+  public:
+    hc12CoExecutor( void ) { _reactor.open(); }
+    ~hc12CoExecutor( void )
+    {
+        for( size_t i = 0; i < _tasks.size(); i++ )
+        {
+            _tasks[i].destroy();
+        }
+    }
+
+    // pData (may be NULL) is passed the executor as pUser
+    int add( hc12Radio *pRadio, hc12DataReady pData = NULL )
+    {
+        int retVal;
+
+        if( (retVal = _reactor.add( pRadio, commandDone, pData,
+                                    this )) >= 0 )
+        {
+            _pRadio[retVal] = pRadio;
+        }
+
+        return( retVal );
+    }
+
+    hc12Reactor* reactor( void ) { return( &_reactor ); }
+
+    // queue a sequence, it starts with the next run()
+    void spawn( hc12CoTask &&task )
+    {
+        _tasks.push_back( task._handle );
+        _ready.push_back( task._handle );
+        task._handle = nullptr;
+    }
+
+    void await( hc12CoAwait *pAwait )
+    {
+        int result;
+
+        if( pAwait->command == HC12_CO_SLEEP )
+        {
+            _timers.push( { nowMs() + pAwait->arg, pAwait } );
+        }
+        else if( pAwait->id < 0 || pAwait->id >= HC12_REACTOR_MAX_RADIOS ||
+                 _pRadio[pAwait->id] == NULL )
+        {
+            pAwait->result = HC12_ERR_ARGS;
+            _ready.push_back( pAwait->handle );
+        }
+        else
+        {
+            _waiting[pAwait->id].push_back( pAwait );
+            if( (result = _reactor.submit( pAwait->id, pAwait->command,
+                                           pAwait->arg )) != HC12_ERR_OK )
+            {
+                _waiting[pAwait->id].pop_back();
+                pAwait->result = result;
+                _ready.push_back( pAwait->handle );
+            }
+        }
+    }
+
+    //
+    // resume ready coroutines and dispatch I/O until all sequences are
+    // done
+    // returns the amount of sequences that ended with an error
+    //
+    int run( void )
+    {
+        std::coroutine_handle<> handle;
+        uint64_t now;
+        int wait;
+        size_t i;
+
+        while( !_tasks.empty() )
+        {
+            while( !_ready.empty() )
+            {
+                handle = _ready.front();
+                _ready.pop_front();
+                handle.resume();
+            }
+
+            for( i = 0; i < _tasks.size(); )
+            {
+                if( _tasks[i].done() )
+                {
+                    if( _tasks[i].promise().result != HC12_ERR_OK )
+                    {
+                        _failed++;
+                    }
+                    _tasks[i].destroy();
+                    _tasks[i] = _tasks.back();
+                    _tasks.pop_back();
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            if( !_tasks.empty() )
+            {
+                wait = -1;
+                if( !_timers.empty() )
+                {
+                    now = nowMs();
+                    wait = _timers.top().deadline > now ?
+                                      _timers.top().deadline - now : 0;
+                }
+
+                _reactor.runOnce( wait );
+
+                now = nowMs();
+                while( !_timers.empty() && _timers.top().deadline <= now )
+                {
+                    _timers.top().pAwait->result = HC12_ERR_OK;
+                    _ready.push_back( _timers.top().pAwait->handle );
+                    _timers.pop();
+                }
+            }
+        }
+
+        wait = _failed;
+        _failed = 0;
+
+        return( wait );
+    }
+
+// awaitable operations, same as the blocking methods of hc12Radio
+    hc12CoAwait command( int id, int command, int arg = 0 )
+                   { return( hc12CoAwait{ this, id, command, arg,
+                                          HC12_ERR_OK, {} } ); }
+    hc12CoAwait sleep( int ms )
+                   { return( hc12CoAwait{ this, -1, HC12_CO_SLEEP, ms,
+                                          HC12_ERR_OK, {} } ); }
+    hc12CoAwait enterCommandMode( int id )
+                   { return( command( id, HC12_REACTOR_ENTER_CMD ) ); }
+    hc12CoAwait leaveCommandMode( int id )
+                   { return( command( id, HC12_REACTOR_LEAVE_CMD ) ); }
+    hc12CoAwait test( int id )
+                   { return( command( id, HC12_CMD_CODE_TEST ) ); }
+    hc12CoAwait setBaud( int id, uint32_t baud )
+                   { return( command( id, HC12_CMD_CODE_SET_BAUD, baud ) ); }
+    hc12CoAwait setComChannel( int id, int chan )
+                   { return( command( id, HC12_CMD_CODE_SET_CHANNEL, chan ) ); }
+    hc12CoAwait setTTMode( int id, int mode )
+                   { return( command( id, HC12_CMD_CODE_SET_TTMODE, mode ) ); }
+    hc12CoAwait setTPower( int id, int power )
+                   { return( command( id, HC12_CMD_CODE_SET_POWER, power ) ); }
+    hc12CoAwait getParam( int id )
+                   { return( command( id, HC12_CMD_CODE_GET_PARAM ) ); }
+    hc12CoAwait getFWVersion( int id )
+                   { return( command( id, HC12_CMD_CODE_GET_VERSION ) ); }
+};
+
+inline void hc12CoAwait::await_suspend( std::coroutine_handle<> h )
+{
+    handle = h;
+    pExec->await( this );
+}
+
+#endif // defined(__linux__) && __cplusplus >= 202002L
+
+#endif // _HC12_CORO_H_
@@ -0,0 +1,384 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Crc.cpp - checksums for data sent over the air
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Crc.h"
+
+#if !defined(ARDUINO)
+    #include <string.h>
+
+    #if defined(__x86_64__) || defined(__i386__)
+        #include <nmmintrin.h>
+
+        #define HC12_CRC32C_SSE42
+    #elif defined(__aarch64__) && defined(__linux__)
+        #include <arm_acle.h>
+        #include <sys/auxv.h>
+        #include <asm/hwcap.h>
+
+        #define HC12_CRC32C_ARMV8
+        #if defined(__clang__)
+            #define HC12_CRC32C_TARGET     "crc"
+        #else
+            #define HC12_CRC32C_TARGET     "+crc"
+        #endif
+    #endif
+#endif // !defined(ARDUINO)
+
+// reflected 0x1edc6f41
+#define HC12_CRC32C_POLY       0x82f63b78
+
+#if defined(ARDUINO)
+
+// a nibble at a time, 32 bytes of table instead of 512 bytes of RAM
+static const uint16_t hc12Crc16Table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
+/*
+ ------------------------------------------------------------------------------
+ * uint16_t hc12Crc16( uint16_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+uint16_t hc12Crc16( uint16_t crc, const void *pData, size_t len )
+{
+    const uint8_t *pByte = (const uint8_t*) pData;
+
+    while( len-- > 0 )
+    {
+        crc = (crc << 4) ^ hc12Crc16Table[(crc >> 12) ^ (*pByte >> 4)];
+        crc = (crc << 4) ^ hc12Crc16Table[(crc >> 12) ^ (*pByte & 0x0f)];
+        pByte++;
+    }
+
+    return( crc );
+}
+
+static const uint32_t hc12Crc32cTable[16] = {
+    0x00000000, 0x105ec76f, 0x20bd8ede, 0x30e349b1,
+    0x417b1dbc, 0x5125dad3, 0x61c69362, 0x7198540d,
+    0x82f63b78, 0x92a8fc17, 0xa24bb5a6, 0xb21572c9,
+    0xc38d26c4, 0xd3d3e1ab, 0xe330a81a, 0xf36e6f75
+};
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Crc32cPortable( uint32_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Crc32cPortable( uint32_t crc, const void *pData, size_t len )
+{
+    const uint8_t *pByte = (const uint8_t*) pData;
+
+    crc = ~crc;
+    while( len-- > 0 )
+    {
+        crc = (crc >> 4) ^ hc12Crc32cTable[(crc ^ *pByte) & 0x0f];
+        crc = (crc >> 4) ^ hc12Crc32cTable[(crc ^ (*pByte >> 4)) & 0x0f];
+        pByte++;
+    }
+
+    return( ~crc );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Crc32c( uint32_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Crc32c( uint32_t crc, const void *pData, size_t len )
+{
+    return( hc12Crc32cPortable( crc, pData, len ) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * const char* hc12Crc32cKernel( void )
+ ------------------------------------------------------------------------------
+*/
+const char* hc12Crc32cKernel( void )
+{
+    return( "table" );
+}
+
+#else // NOT on Arduino platform
+
+static const uint16_t hc12Crc16Table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+/*
+ ------------------------------------------------------------------------------
+ * uint16_t hc12Crc16( uint16_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+uint16_t hc12Crc16( uint16_t crc, const void *pData, size_t len )
+{
+    const uint8_t *pByte = (const uint8_t*) pData;
+
+    while( len-- > 0 )
+    {
+        crc = (crc << 8) ^ hc12Crc16Table[(crc >> 8) ^ *pByte++];
+    }
+
+    return( crc );
+}
+
+//
+// slicing by eight: hc12Crc32cTable[n][b] is the CRC of byte b followed
+// by n zero bytes, so eight table lookups retire eight bytes at once.
+// Filled by crc32cSelect() when the library is loaded.
+//
+static uint32_t hc12Crc32cTable[8][256];
+
+typedef uint32_t (*hc12Crc32cFunc)( uint32_t crc, const void *pData,
+                                    size_t len );
+
+struct _hc12_crc32c_kernel {
+    hc12Crc32cFunc pFunc;
+    const char    *pName;
+};
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Crc32cPortable( uint32_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Crc32cPortable( uint32_t crc, const void *pData, size_t len )
+{
+    const uint8_t *pByte = (const uint8_t*) pData;
+    uint32_t high;
+
+    crc = ~crc;
+
+    while( len >= 8 )
+    {
+        // byte by byte, the compiler makes a single load of it where
+        // the byte order allows
+        crc ^= (uint32_t) pByte[0] | ((uint32_t) pByte[1] << 8) |
+               ((uint32_t) pByte[2] << 16) | ((uint32_t) pByte[3] << 24);
+        high = (uint32_t) pByte[4] | ((uint32_t) pByte[5] << 8) |
+               ((uint32_t) pByte[6] << 16) | ((uint32_t) pByte[7] << 24);
+
+        crc = hc12Crc32cTable[7][crc & 0xff] ^
+              hc12Crc32cTable[6][(crc >> 8) & 0xff] ^
+              hc12Crc32cTable[5][(crc >> 16) & 0xff] ^
+              hc12Crc32cTable[4][crc >> 24] ^
+              hc12Crc32cTable[3][high & 0xff] ^
+              hc12Crc32cTable[2][(high >> 8) & 0xff] ^
+              hc12Crc32cTable[1][(high >> 16) & 0xff] ^
+              hc12Crc32cTable[0][high >> 24];
+
+        pByte += 8;
+        len -= 8;
+    }
+
+    while( len-- > 0 )
+    {
+        crc = (crc >> 8) ^ hc12Crc32cTable[0][(crc ^ *pByte++) & 0xff];
+    }
+
+    return( ~crc );
+}
+
+#if defined(HC12_CRC32C_SSE42)
+/*
+ ------------------------------------------------------------------------------
+ * static uint32_t crc32cSse42( uint32_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42( uint32_t crc, const void *pData, size_t len )
+{
+    const uint8_t *pByte = (const uint8_t*) pData;
+    uint32_t word;
+#if defined(__x86_64__)
+    uint64_t crc64;
+    uint64_t dword;
+#endif // defined(__x86_64__)
+
+    crc = ~crc;
+
+#if defined(__x86_64__)
+    crc64 = crc;
+    while( len >= 8 )
+    {
+        memcpy( &dword, pByte, sizeof(dword) );
+        crc64 = _mm_crc32_u64( crc64, dword );
+        pByte += 8;
+        len -= 8;
+    }
+    crc = (uint32_t) crc64;
+#endif // defined(__x86_64__)
+
+    while( len >= 4 )
+    {
+        memcpy( &word, pByte, sizeof(word) );
+        crc = _mm_crc32_u32( crc, word );
+        pByte += 4;
+        len -= 4;
+    }
+
+    while( len-- > 0 )
+    {
+        crc = _mm_crc32_u8( crc, *pByte++ );
+    }
+
+    return( ~crc );
+}
+#endif // defined(HC12_CRC32C_SSE42)
+
+#if defined(HC12_CRC32C_ARMV8)
+/*
+ ------------------------------------------------------------------------------
+ * static uint32_t crc32cArmv8( uint32_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+__attribute__((target(HC12_CRC32C_TARGET)))
+static uint32_t crc32cArmv8( uint32_t crc, const void *pData, size_t len )
+{
+    const uint8_t *pByte = (const uint8_t*) pData;
+    uint64_t dword;
+
+    crc = ~crc;
+
+    while( len >= 8 )
+    {
+        memcpy( &dword, pByte, sizeof(dword) );
+        crc = __crc32cd( crc, dword );
+        pByte += 8;
+        len -= 8;
+    }
+
+    while( len-- > 0 )
+    {
+        crc = __crc32cb( crc, *pByte++ );
+    }
+
+    return( ~crc );
+}
+#endif // defined(HC12_CRC32C_ARMV8)
+
+/*
+ ------------------------------------------------------------------------------
+ * static struct _hc12_crc32c_kernel crc32cSelect( void )
+ *
+ * build the tables and pick the fastest kernel the CPU supports
+ ------------------------------------------------------------------------------
+*/
+static struct _hc12_crc32c_kernel crc32cSelect( void )
+{
+    struct _hc12_crc32c_kernel retVal = { hc12Crc32cPortable, "table" };
+    uint32_t crc;
+    int i, j;
+
+    for( i = 0; i < 256; i++ )
+    {
+        crc = i;
+        for( j = 0; j < 8; j++ )
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ HC12_CRC32C_POLY : crc >> 1;
+        }
+        hc12Crc32cTable[0][i] = crc;
+    }
+
+    for( i = 0; i < 256; i++ )
+    {
+        for( j = 1; j < 8; j++ )
+        {
+            crc = hc12Crc32cTable[j - 1][i];
+            hc12Crc32cTable[j][i] = (crc >> 8) ^ hc12Crc32cTable[0][crc & 0xff];
+        }
+    }
+
+#if defined(HC12_CRC32C_SSE42)
+    if( __builtin_cpu_supports( "sse4.2" ) )
+    {
+        retVal.pFunc = crc32cSse42;
+        retVal.pName = "sse4.2";
+    }
+#elif defined(HC12_CRC32C_ARMV8)
+    if( (getauxval( AT_HWCAP ) & HWCAP_CRC32) != 0 )
+    {
+        retVal.pFunc = crc32cArmv8;
+        retVal.pName = "armv8";
+    }
+#endif
+
+    return( retVal );
+}
+
+// done before main(), there are no calls from static constructors
+static const struct _hc12_crc32c_kernel hc12Crc32cUse = crc32cSelect();
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Crc32c( uint32_t crc, const void *pData, size_t len )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Crc32c( uint32_t crc, const void *pData, size_t len )
+{
+    return( hc12Crc32cUse.pFunc( crc, pData, len ) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * const char* hc12Crc32cKernel( void )
+ ------------------------------------------------------------------------------
+*/
+const char* hc12Crc32cKernel( void )
+{
+    return( hc12Crc32cUse.pName );
+}
+
+#endif // defined(ARDUINO)
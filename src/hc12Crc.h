@@ -0,0 +1,57 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Crc.h - checksums for data sent over the air
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_CRC_H_
+#define _HC12_CRC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// CRC-16/CCITT-FALSE: polynomial 0x1021, not reflected, no final xor.
+// Start with HC12_CRC16_INIT and hand the result of one call to the
+// next to checksum data in pieces. "123456789" gives 0x29b1.
+//
+#define HC12_CRC16_INIT        0xffff
+
+uint16_t hc12Crc16( uint16_t crc, const void *pData, size_t len );
+
+//
+// CRC-32C (Castagnoli): polynomial 0x1edc6f41, reflected, inverted on
+// the way in and out inside the call, so pieces chain like above
+// starting with HC12_CRC32C_INIT. "123456789" gives 0xe3069283.
+//
+// hc12Crc32c() runs on the CRC instruction of the CPU where there is
+// one, SSE4.2 on x86 and the CRC extension of ARMv8 on aarch64. The
+// kernel is chosen once when the library is loaded, checked through
+// the CPU feature bits, and hc12Crc32cKernel() tells which one it is.
+// hc12Crc32cPortable() is the table driven version everything else
+// falls back to, slicing by eight bytes on Linux and a nibble at a
+// time on the Arduino.
+//
+#define HC12_CRC32C_INIT       0x00000000
+
+uint32_t hc12Crc32c( uint32_t crc, const void *pData, size_t len );
+uint32_t hc12Crc32cPortable( uint32_t crc, const void *pData, size_t len );
+const char* hc12Crc32cKernel( void );
+
+#endif // _HC12_CRC_H_
@@ -0,0 +1,363 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Frame.cpp - packets over the transparent mode byte stream
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Frame.h"
+
+//
+// COBS encoder writing behind the head of a ring. code counts the
+// bytes of the current block plus one and is stored at codePos when
+// the block ends. A frame is a single block of at most 254 bytes, so
+// code never exceeds 0xff.
+//
+struct _hc12_cobs_out {
+    hc12RingBuffer *pRing;
+    size_t          codePos;
+    size_t          pos;
+    uint8_t         code;
+};
+
+/*
+ ------------------------------------------------------------------------------
+ * static inline void cobsPut( struct _hc12_cobs_out *pOut, uint8_t byte )
+ ------------------------------------------------------------------------------
+*/
+static inline void cobsPut( struct _hc12_cobs_out *pOut, uint8_t byte )
+{
+    if( byte == 0 )
+    {
+        *pOut->pRing->headAt( pOut->codePos ) = pOut->code;
+        pOut->codePos = pOut->pos++;
+        pOut->code = 1;
+    }
+    else
+    {
+        *pOut->pRing->headAt( pOut->pos++ ) = byte;
+        pOut->code++;
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Framer::hc12Framer( hc12Radio *pRadio )
+ ------------------------------------------------------------------------------
+*/
+hc12Framer::hc12Framer( hc12Radio *pRadio )
+{
+    _pRadio = pRadio;
+    _scanned = 0;
+    _held = 0;
+    resetStats();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Framer::resetStats( void )
+ ------------------------------------------------------------------------------
+*/
+void hc12Framer::resetStats( void )
+{
+    memset( &_stats, '\0', sizeof(_stats) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Framer::send( const void *pData, size_t len )
+ *
+ * encode len bytes as one frame into the TX ring and start writing it.
+ * A frame is queued completely or not at all.
+ * returns len, 0 if the TX ring has no room for the frame right now,
+ * or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Framer::send( const void *pData, size_t len )
+{
+    int retVal = 0;
+    hc12RingBuffer *pRing;
+    const uint8_t *pSrc = (const uint8_t*) pData;
+    struct _hc12_cobs_out out;
+    uint8_t header = (uint8_t) len;
+    uint16_t crc;
+    size_t i;
+
+    if( _pRadio == NULL || pData == NULL )
+    {
+        return( HC12_ERR_NULLP );
+    }
+
+    if( len == 0 || len > HC12_FRAME_MAX_PAYLOAD )
+    {
+        return( HC12_ERR_ARGS );
+    }
+
+    if( _pRadio->opMode() != HC12_OP_TT_MODE )
+    {
+        return( HC12_ERR_OP_MODE );
+    }
+
+    pRing = _pRadio->txRing();
+
+    if( pRing->space() < HC12_FRAME_AIR_SIZE(len) )
+    {
+        _pRadio->flush();
+    }
+
+    if( pRing->space() >= HC12_FRAME_AIR_SIZE(len) )
+    {
+        crc = hc12Crc16( HC12_CRC16_INIT, &header, HC12_FRAME_HEADER );
+        crc = hc12Crc16( crc, pSrc, len );
+
+        out.pRing = pRing;
+        out.codePos = 0;
+        out.pos = 1;
+        out.code = 1;
+
+        cobsPut( &out, header );
+        for( i = 0; i < len; i++ )
+        {
+            cobsPut( &out, pSrc[i] );
+        }
+        cobsPut( &out, (uint8_t) (crc >> 8) );
+        cobsPut( &out, (uint8_t) crc );
+
+        *pRing->headAt( out.codePos ) = out.code;
+        *pRing->headAt( out.pos++ ) = 0;
+        pRing->commit( out.pos );
+
+        _stats.sent++;
+        _pRadio->flush();
+        retVal = (int) len;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Framer::decode( size_t encoded, const uint8_t **ppBlock )
+ *
+ * undo COBS for the encoded bytes at the tail of the RX ring. Decoded
+ * data is never longer than the encoded one, so it is written over the
+ * encoded bytes from the start. If the frame wraps around the end of
+ * the storage it is decoded into _split instead.
+ * returns the length of the block or HC12_FRAME_ERR_COBS
+ ------------------------------------------------------------------------------
+*/
+int hc12Framer::decode( size_t encoded, const uint8_t **ppBlock )
+{
+    int retVal = 0;
+    hc12RingBuffer *pRing = _pRadio->rxRing();
+    uint8_t *pData;
+    size_t in = 0;
+    size_t out = 0;
+    size_t end;
+    uint8_t code;
+
+    if( pRing->peek( (const uint8_t**) &pData ) >= encoded )
+    {
+        while( retVal == 0 && in < encoded )
+        {
+            // never 0, the frame ends at the first one
+            code = pData[in++];
+            if( (end = in + code - 1) > encoded )
+            {
+                retVal = HC12_FRAME_ERR_COBS;
+            }
+            else
+            {
+                memmove( &pData[out], &pData[in], code - 1 );
+                out += code - 1;
+                in = end;
+                if( code < 0xff && in < encoded )
+                {
+                    pData[out++] = 0;
+                }
+            }
+        }
+        *ppBlock = pData;
+    }
+    else
+    {
+        while( retVal == 0 && in < encoded )
+        {
+            code = *pRing->tailAt( in++ );
+            if( (end = in + code - 1) > encoded )
+            {
+                retVal = HC12_FRAME_ERR_COBS;
+            }
+            else
+            {
+                while( in < end )
+                {
+                    _split[out++] = *pRing->tailAt( in++ );
+                }
+                if( code < 0xff && in < encoded )
+                {
+                    _split[out++] = 0;
+                }
+            }
+        }
+        *ppBlock = _split;
+    }
+
+    if( retVal == 0 )
+    {
+        retVal = (int) out;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Framer::drop( size_t len, int reason )
+ *
+ * throw away len bytes at the tail of the RX ring
+ ------------------------------------------------------------------------------
+*/
+void hc12Framer::drop( size_t len, int reason )
+{
+    _pRadio->rxRing()->consume( len );
+    _stats.droppedBytes += len;
+
+    switch( reason )
+    {
+        case HC12_FRAME_ERR_COBS:
+            _stats.cobsErrors++;
+            break;
+        case HC12_FRAME_ERR_LENGTH:
+            _stats.lengthErrors++;
+            break;
+        case HC12_FRAME_ERR_CRC:
+            _stats.crcErrors++;
+            break;
+        case HC12_FRAME_ERR_OVERSIZE:
+            _stats.oversize++;
+            break;
+    }
+
+    HC12_LOG_DEBUG( HC12_EV_FRAME_DROP, this, reason, len );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Framer::receive( const uint8_t **ppData )
+ *
+ * take the next good frame out of the RX ring, reading from the port
+ * if the ring holds none. *ppData points to the payload, which stays
+ * valid until the next call.
+ * returns the payload length, 0 if there is no complete frame, or an
+ * error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Framer::receive( const uint8_t **ppData )
+{
+    int retVal = 0;
+    hc12RingBuffer *pRing;
+    const uint8_t *pBlock;
+    bool polled = false;
+    bool more = true;
+    size_t used;
+    size_t encoded;
+    int decoded;
+
+    if( _pRadio == NULL || ppData == NULL )
+    {
+        return( HC12_ERR_NULLP );
+    }
+
+    if( _pRadio->opMode() != HC12_OP_TT_MODE )
+    {
+        return( HC12_ERR_OP_MODE );
+    }
+
+    pRing = _pRadio->rxRing();
+
+    // the caller is done with the frame of the last call
+    if( _held > 0 )
+    {
+        pRing->consume( _held );
+        _held = 0;
+    }
+
+    while( retVal == 0 && more )
+    {
+        used = pRing->used();
+        while( _scanned < used && *pRing->tailAt( _scanned ) != 0 )
+        {
+            _scanned++;
+        }
+
+        if( _scanned == used )
+        {
+            // too long for a frame, the next 0x00 ends the rest of it
+            if( used > HC12_FRAME_MAX_ENCODED )
+            {
+                drop( used, HC12_FRAME_ERR_OVERSIZE );
+                _scanned = 0;
+            }
+
+            more = !polled && _pRadio->poll() > 0;
+            polled = true;
+        }
+        else
+        {
+            encoded = _scanned;
+            _scanned = 0;
+
+            if( encoded == 0 )
+            {
+                // a lone delimiter carries nothing
+                pRing->consume( 1 );
+            }
+            else if( encoded > HC12_FRAME_MAX_ENCODED )
+            {
+                drop( encoded + 1, HC12_FRAME_ERR_OVERSIZE );
+            }
+            else if( (decoded = decode( encoded, &pBlock )) < 0 )
+            {
+                drop( encoded + 1, decoded );
+            }
+            else if( decoded <= HC12_FRAME_HEADER + HC12_FRAME_TRAILER ||
+                     pBlock[0] != decoded - HC12_FRAME_HEADER -
+                                            HC12_FRAME_TRAILER )
+            {
+                drop( encoded + 1, HC12_FRAME_ERR_LENGTH );
+            }
+            else if( hc12Crc16( HC12_CRC16_INIT, pBlock,
+                                decoded - HC12_FRAME_TRAILER ) !=
+                     (((uint16_t) pBlock[decoded - 2] << 8) |
+                                  pBlock[decoded - 1]) )
+            {
+                drop( encoded + 1, HC12_FRAME_ERR_CRC );
+            }
+            else
+            {
+                _held = encoded + 1;
+                _stats.received++;
+                *ppData = &pBlock[HC12_FRAME_HEADER];
+                retVal = pBlock[0];
+            }
+        }
+    }
+
+    return( retVal );
+}
@@ -0,0 +1,114 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Frame.h - packets over the transparent mode byte stream
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_FRAME_H_
+#define _HC12_FRAME_H_
+
+#include "hc12Radio.h"
+#include "hc12Crc.h"
+
+//
+// On the air a frame is
+//
+//     COBS( length | payload | CRC-16 high | CRC-16 low ) 0x00
+//
+// length is the payload length, the CRC (see hc12Crc16()) covers length
+// and payload. COBS removes every 0x00 from the block, so 0x00 marks
+// the end of a frame and nothing else. After noise the receiver is in
+// step again with the next 0x00; whatever does not decode, has the
+// wrong length or the wrong CRC is dropped.
+//
+// The block is at most 254 bytes, so COBS adds a single byte.
+//
+#if defined(ARDUINO)
+    #define HC12_FRAME_MAX_PAYLOAD     56
+#else // NOT on Arduino platform
+    #define HC12_FRAME_MAX_PAYLOAD    251
+#endif // defined(ARDUINO)
+
+#define HC12_FRAME_HEADER           1    // length
+#define HC12_FRAME_TRAILER          2    // CRC
+#define HC12_FRAME_MAX_BLOCK       (HC12_FRAME_HEADER + \
+                                    HC12_FRAME_MAX_PAYLOAD + \
+                                    HC12_FRAME_TRAILER)
+// COBS code byte included, delimiter not
+#define HC12_FRAME_MAX_ENCODED     (HC12_FRAME_MAX_BLOCK + 1)
+// bytes on the air for len bytes of payload, delimiter included
+#define HC12_FRAME_AIR_SIZE(len)   ((len) + HC12_FRAME_HEADER + \
+                                    HC12_FRAME_TRAILER + 2)
+
+static_assert( HC12_FRAME_MAX_BLOCK <= 254,
+               "a frame has to fit into a single COBS block" );
+static_assert( HC12_FRAME_MAX_ENCODED + 1 <= HC12_TX_RING_SIZE &&
+               HC12_FRAME_MAX_ENCODED + 1 <= HC12_RX_RING_SIZE,
+               "a frame has to fit into the rings" );
+
+// why a frame was dropped
+#define HC12_FRAME_ERR_COBS        -1    // code byte beyond the delimiter
+#define HC12_FRAME_ERR_LENGTH      -2    // length field does not match
+#define HC12_FRAME_ERR_CRC         -3
+#define HC12_FRAME_ERR_OVERSIZE    -4    // no delimiter where one must be
+
+struct _hc12_frame_stats {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t cobsErrors;
+    uint32_t lengthErrors;
+    uint32_t crcErrors;
+    uint32_t oversize;
+    uint32_t droppedBytes;                // of all frames dropped
+};
+
+//
+// Frames go through the rings of the radio without a copy: send()
+// encodes the payload directly into the TX ring, receive() decodes a
+// frame in place in the RX ring and points into it. Only a frame
+// split by the end of the RX ring storage is copied to a buffer of its
+// own.
+//
+// While a framer is in use it owns the transparent mode data path, the
+// radio's send() and receive() must not be used besides it.
+//
+class hc12Framer {
+
+  protected:
+    hc12Radio *_pRadio;
+    size_t     _scanned;                  // bytes behind tail without 0x00
+    size_t     _held;                     // frame handed out, to consume
+    uint8_t    _split[HC12_FRAME_MAX_BLOCK];
+    struct _hc12_frame_stats _stats;
+
+    int  decode( size_t encoded, const uint8_t **ppBlock );
+    void drop( size_t len, int reason );
+
+  public:
+    hc12Framer( hc12Radio *pRadio );
+
+    int send( const void *pData, size_t len );
+    int receive( const uint8_t **ppData );
+
+    void getStats( struct _hc12_frame_stats *pStats )
+                                      { *pStats = _stats; }
+    void resetStats( void );
+};
+
+#endif // _HC12_FRAME_H_
@@ -0,0 +1,519 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Gpio.cpp - SET and power pin control for hc-12 modules
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include <string.h>
+
+#include "hc12Gpio.h"
+
+#if defined(ARDUINO)
+    #if ARDUINO > 22
+        #include "Arduino.h"
+    #else
+        #include "WProgram.h"
+    #endif
+#else // NOT on Arduino platform
+    #include <time.h>
+    #include <unistd.h>
+#endif // defined(ARDUINO)
+
+#if defined(__linux__)
+    #include <stdlib.h>
+    #include <fcntl.h>
+    #include <sys/ioctl.h>
+    #include <linux/gpio.h>
+#endif // defined(__linux__)
+
+#if defined(RASPBERRY)
+    #include <pigpio.h>
+#endif // defined(RASPBERRY)
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Gpio::write( int pin, int level )
+ *
+ * drive pin to level (0 or 1), or remember it for endBatch()
+ * returns HC12_GPIO_OK or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Gpio::write( int pin, int level )
+{
+    int retVal = HC12_GPIO_OK;
+    int i;
+
+    if( _batch > 0 )
+    {
+        for( i = 0; i < _pending && _pendPin[i] != pin; i++ )
+        {
+            ;
+        }
+
+        if( i == HC12_GPIO_MAX_PINS )
+        {
+            // more pins than any backend drives, let the first go
+            retVal = apply( _pendPin, _pendLevel, _pending );
+            _pending = i = 0;
+        }
+
+        if( i == _pending )
+        {
+            _pendPin[_pending++] = pin;
+        }
+        _pendLevel[i] = level;
+    }
+    else
+    {
+        retVal = apply( &pin, &level, 1 );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Gpio::beginBatch( void )
+ *
+ * collect the following writes, batches may be nested
+ ------------------------------------------------------------------------------
+*/
+void hc12Gpio::beginBatch( void )
+{
+    _batch++;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Gpio::endBatch( void )
+ *
+ * write what has been collected since the outermost beginBatch()
+ * returns HC12_GPIO_OK or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Gpio::endBatch( void )
+{
+    int retVal = HC12_GPIO_OK;
+
+    if( _batch > 0 && --_batch == 0 && _pending > 0 )
+    {
+        retVal = apply( _pendPin, _pendLevel, _pending );
+        _pending = 0;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12GpioMock::hc12GpioMock( void )
+ ------------------------------------------------------------------------------
+*/
+hc12GpioMock::hc12GpioMock( void )
+{
+    memset( _level, -1, sizeof(_level) );
+    _pHook = NULL;
+    _pUser = NULL;
+    _latencyUs = 0;
+    _writes = 0;
+    _calls = 0;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * static uint32_t hc12GpioNow( void )
+ ------------------------------------------------------------------------------
+*/
+static uint32_t hc12GpioNow( void )
+{
+#if defined(ARDUINO)
+    return( micros() );
+#else // NOT defined(ARDUINO)
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint32_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000 );
+#endif // defined(ARDUINO)
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioMock::request( int pin, int level )
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioMock::request( int pin, int level )
+{
+    int retVal = HC12_GPIO_ERR_PIN;
+
+    if( pin >= 0 && pin < HC12_GPIO_MAX_PINS )
+    {
+        _level[pin] = -1;
+        retVal = apply( &pin, &level, 1 );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioMock::apply( const int *pPins, const int *pLevels,
+ *                          int count )
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioMock::apply( const int *pPins, const int *pLevels, int count )
+{
+    int retVal = HC12_GPIO_OK;
+    uint32_t stamp;
+    int i;
+
+    _calls++;
+
+    if( _latencyUs > 0 )
+    {
+#if defined(ARDUINO)
+        delayMicroseconds( _latencyUs );
+#else // NOT defined(ARDUINO)
+        usleep( _latencyUs );
+#endif // defined(ARDUINO)
+    }
+
+    stamp = hc12GpioNow();
+
+    for( i = 0; i < count; i++ )
+    {
+        if( pPins[i] < 0 || pPins[i] >= HC12_GPIO_MAX_PINS )
+        {
+            retVal = HC12_GPIO_ERR_PIN;
+        }
+        else if( _level[pPins[i]] != (pLevels[i] != 0) )
+        {
+            _level[pPins[i]] = (pLevels[i] != 0);
+            _writes++;
+
+            if( _pHook != NULL )
+            {
+                _pHook( pPins[i], _level[pPins[i]], stamp, _pUser );
+            }
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioMock::level( int pin )
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioMock::level( int pin )
+{
+    return( pin >= 0 && pin < HC12_GPIO_MAX_PINS ? _level[pin] : -1 );
+}
+
+#if defined(RASPBERRY)
+
+bool hc12GpioPigpio::_initialised = false;
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioPigpio::request( int pin, int level )
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioPigpio::request( int pin, int level )
+{
+    int retVal = HC12_GPIO_ERR_OPEN;
+
+    if( _initialised || gpioInitialise() >= 0 )
+    {
+        _initialised = true;
+
+        if( gpioSetMode( pin, PI_OUTPUT ) != 0 )
+        {
+            retVal = HC12_GPIO_ERR_PIN;
+        }
+        else
+        {
+            retVal = apply( &pin, &level, 1 );
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioPigpio::apply( const int *pPins, const int *pLevels,
+ *                            int count )
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioPigpio::apply( const int *pPins, const int *pLevels, int count )
+{
+    int retVal = HC12_GPIO_OK;
+    uint32_t setMask = 0;
+    uint32_t clearMask = 0;
+    int i;
+
+    if( !_initialised )
+    {
+        retVal = HC12_GPIO_ERR_OPEN;
+    }
+    else if( count == 1 )
+    {
+        if( gpioWrite( pPins[0], pLevels[0] != 0 ) != 0 )
+        {
+            retVal = HC12_GPIO_ERR_IO;
+        }
+    }
+    else
+    {
+        for( i = 0; i < count; i++ )
+        {
+            if( pPins[i] >= 0 && pPins[i] < 32 )
+            {
+                if( pLevels[i] != 0 )
+                {
+                    setMask |= 1u << pPins[i];
+                }
+                else
+                {
+                    clearMask |= 1u << pPins[i];
+                }
+            }
+            else if( gpioWrite( pPins[i], pLevels[i] != 0 ) != 0 )
+            {
+                retVal = HC12_GPIO_ERR_IO;
+            }
+        }
+
+        if( (clearMask != 0 && gpioWrite_Bits_0_31_Clear( clearMask ) != 0) ||
+            (setMask != 0 && gpioWrite_Bits_0_31_Set( setMask ) != 0) )
+        {
+            retVal = HC12_GPIO_ERR_IO;
+        }
+    }
+
+    return( retVal );
+}
+
+#endif // defined(RASPBERRY)
+
+#if defined(__linux__)
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12GpioChip::hc12GpioChip( const char *pPath )
+ *
+ * nothing is opened before the first request()
+ ------------------------------------------------------------------------------
+*/
+hc12GpioChip::hc12GpioChip( const char *pPath )
+{
+    _pPath = strdup( pPath );
+    _chipFd = -1;
+    _handleFd = -1;
+    _lines = 0;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12GpioChip::~hc12GpioChip( void )
+ *
+ * the lines go back to the kernel, their level is undefined then
+ ------------------------------------------------------------------------------
+*/
+hc12GpioChip::~hc12GpioChip( void )
+{
+    if( _handleFd >= 0 )
+    {
+        close( _handleFd );
+    }
+
+    if( _chipFd >= 0 )
+    {
+        close( _chipFd );
+    }
+
+    free( _pPath );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioChip::find( int pin )
+ *
+ * returns the index of the line in the handle or -1
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioChip::find( int pin )
+{
+    int retVal;
+
+    for( retVal = _lines - 1; retVal >= 0; retVal-- )
+    {
+        if( _offset[retVal] == (uint32_t) pin )
+        {
+            break;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioChip::requestLines( void )
+ *
+ * get a handle for all lines with their current values. The old one is
+ * given back first, the kernel hands out a line only once.
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioChip::requestLines( void )
+{
+    int retVal = HC12_GPIO_OK;
+    struct gpiohandle_request req;
+    int i;
+
+    if( _chipFd < 0 && (_chipFd = open( _pPath, O_RDWR | O_CLOEXEC )) < 0 )
+    {
+        retVal = HC12_GPIO_ERR_OPEN;
+    }
+    else
+    {
+        if( _handleFd >= 0 )
+        {
+            close( _handleFd );
+            _handleFd = -1;
+        }
+
+        memset( &req, '\0', sizeof(req) );
+        for( i = 0; i < _lines; i++ )
+        {
+            req.lineoffsets[i] = _offset[i];
+            req.default_values[i] = _value[i];
+        }
+        req.flags = GPIOHANDLE_REQUEST_OUTPUT;
+        req.lines = _lines;
+        strncpy( req.consumer_label, "hc12Radio",
+                 sizeof(req.consumer_label) - 1 );
+
+        if( ioctl( _chipFd, GPIO_GET_LINEHANDLE_IOCTL, &req ) < 0 )
+        {
+            retVal = HC12_GPIO_ERR_PIN;
+        }
+        else
+        {
+            _handleFd = req.fd;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioChip::request( int pin, int level )
+ *
+ * Adding a line requests the handle again, the lines already in it are
+ * released for that moment. Request all pins before the modules are
+ * in use. If the new line is refused, the others are requested again.
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioChip::request( int pin, int level )
+{
+    int retVal;
+    int i;
+
+    if( pin < 0 )
+    {
+        retVal = HC12_GPIO_ERR_PIN;
+    }
+    else if( (i = find( pin )) >= 0 )
+    {
+        retVal = apply( &pin, &level, 1 );
+    }
+    else if( _lines == HC12_GPIO_MAX_PINS )
+    {
+        retVal = HC12_GPIO_ERR_FULL;
+    }
+    else
+    {
+        _offset[_lines] = pin;
+        _value[_lines] = level != 0;
+        _lines++;
+
+        if( (retVal = requestLines()) != HC12_GPIO_OK )
+        {
+            // the old handle is gone, get one for the lines before
+            _lines--;
+            if( _lines > 0 )
+            {
+                requestLines();
+            }
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12GpioChip::apply( const int *pPins, const int *pLevels,
+ *                          int count )
+ *
+ * one ioctl for all lines of the handle
+ ------------------------------------------------------------------------------
+*/
+int hc12GpioChip::apply( const int *pPins, const int *pLevels, int count )
+{
+    int retVal = HC12_GPIO_OK;
+    struct gpiohandle_data data;
+    int i;
+    int line;
+
+    for( i = 0; i < count; i++ )
+    {
+        if( (line = find( pPins[i] )) < 0 )
+        {
+            retVal = HC12_GPIO_ERR_PIN;
+        }
+        else
+        {
+            _value[line] = pLevels[i] != 0;
+        }
+    }
+
+    if( _handleFd < 0 )
+    {
+        retVal = HC12_GPIO_ERR_OPEN;
+    }
+    else
+    {
+        memset( &data, '\0', sizeof(data) );
+        memcpy( data.values, _value, _lines );
+
+        if( ioctl( _handleFd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data ) < 0 )
+        {
+            retVal = HC12_GPIO_ERR_IO;
+        }
+    }
+
+    return( retVal );
+}
+
+#endif // defined(__linux__)
@@ -0,0 +1,165 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Gpio.h - SET and power pin control for hc-12 modules
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_GPIO_H_
+#define _HC12_GPIO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// pins one backend drives, GPIOHANDLES_MAX of the gpiochip interface
+#define HC12_GPIO_MAX_PINS         64
+
+#define HC12_GPIO_OK                0
+#define HC12_GPIO_ERR_OPEN         -1    // backend could not be set up
+#define HC12_GPIO_ERR_PIN          -2    // pin out of range / not requested
+#define HC12_GPIO_ERR_FULL         -3    // HC12_GPIO_MAX_PINS reached
+#define HC12_GPIO_ERR_IO           -4    // the write itself failed
+
+//
+// A backend drives output pins. Pins are requested once with their
+// initial level, write() changes them afterwards.
+//
+// Between beginBatch() and endBatch() writes are only collected and go
+// out together, with a single call to the hardware where the backend
+// allows it. The SET pins of several modules switch at once that way:
+//
+//     gpio.beginBatch();
+//     radio1.beginModeSwitch( HC12_OP_CMD_MODE );
+//     radio2.beginModeSwitch( HC12_OP_CMD_MODE );
+//     gpio.endBatch();
+//
+// A backend is not thread safe, radios sharing one have to be driven
+// from the same thread.
+//
+class hc12Gpio {
+
+  protected:
+    int  _batch;
+    int  _pending;
+    int  _pendPin[HC12_GPIO_MAX_PINS];
+    int  _pendLevel[HC12_GPIO_MAX_PINS];
+
+    // set count pins to their levels, all at once if possible
+    virtual int apply( const int *pPins, const int *pLevels, int count ) = 0;
+
+  public:
+    hc12Gpio( void ) : _batch( 0 ), _pending( 0 ) {}
+    virtual ~hc12Gpio( void ) {}
+
+    virtual int request( int pin, int level ) = 0;
+
+    int write( int pin, int level );
+    void beginBatch( void );
+    int endBatch( void );
+};
+
+//
+// called for each pin change of a hc12GpioMock, stamp is in
+// microseconds (0 on Arduino)
+//
+typedef void (*hc12GpioHook)( int pin, int level, uint32_t stamp,
+                              void *pUser );
+
+//
+// No hardware at all: the levels are kept in memory and each change is
+// reported to the hook, e.g. to switch the mode of an emulator after
+// the settle time. latencyUs delays every call to the "hardware" to
+// play a slow GPIO bus.
+//
+class hc12GpioMock : public hc12Gpio {
+
+  protected:
+    int8_t       _level[HC12_GPIO_MAX_PINS];
+    hc12GpioHook _pHook;
+    void        *_pUser;
+    uint32_t     _latencyUs;
+    uint32_t     _writes;
+    uint32_t     _calls;
+
+    int apply( const int *pPins, const int *pLevels, int count );
+
+  public:
+    hc12GpioMock( void );
+
+    void setHook( hc12GpioHook pHook, void *pUser = NULL )
+                                       { _pHook = pHook; _pUser = pUser; }
+    void setLatency( uint32_t us ) { _latencyUs = us; }
+
+    int request( int pin, int level );
+
+    // -1 if pin has not been requested
+    int level( int pin );
+    // pin changes resp. calls to the "hardware" so far
+    uint32_t writes( void ) { return( _writes ); }
+    uint32_t calls( void ) { return( _calls ); }
+};
+
+#if defined(RASPBERRY)
+//
+// pigpio, pin numbers are the Broadcom ones. The library is set up
+// with the first request, not at construction time. Batches of pins
+// 0 - 31 are written with one set and one clear of the bank.
+//
+class hc12GpioPigpio : public hc12Gpio {
+
+  protected:
+    static bool _initialised;
+
+    int apply( const int *pPins, const int *pLevels, int count );
+
+  public:
+    int request( int pin, int level );
+};
+#endif // defined(RASPBERRY)
+
+#if defined(__linux__)
+//
+// Linux GPIO character device, /dev/gpiochipN, v1 ioctl interface.
+// Pins are the line offsets of the chip. All requested lines share one
+// line handle, so a batch is a single GPIOHANDLE_SET_LINE_VALUES_IOCTL.
+// The handle is requested again when a line is added, so request all
+// pins before the modules are in use.
+//
+class hc12GpioChip : public hc12Gpio {
+
+  protected:
+    char    *_pPath;
+    int      _chipFd;
+    int      _handleFd;
+    int      _lines;
+    uint32_t _offset[HC12_GPIO_MAX_PINS];
+    uint8_t  _value[HC12_GPIO_MAX_PINS];
+
+    int find( int pin );
+    int requestLines( void );
+    int apply( const int *pPins, const int *pLevels, int count );
+
+  public:
+    hc12GpioChip( const char *pPath = "/dev/gpiochip0" );
+    ~hc12GpioChip( void );
+
+    int request( int pin, int level );
+};
+#endif // defined(__linux__)
+
+#endif // _HC12_GPIO_H_
@@ -0,0 +1,300 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Log.cpp - binary event log, formatted on demand
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hc12Log.h"
+#include "hc12Command.h"
+
+#if defined(ARDUINO)
+    #if ARDUINO > 22
+        #include "Arduino.h"
+    #else
+        #include "WProgram.h"
+    #endif
+#else // NOT on Arduino platform
+    #include <time.h>
+#endif // defined(ARDUINO)
+
+#if defined(__linux__)
+    #include <atomic>
+    typedef std::atomic<uint32_t> hc12LogCounter;
+    #define HC12_LOG_LOAD(v,o)         (v).load( std::o )
+    #define HC12_LOG_STORE(v,x,o)      (v).store( x, std::o )
+    #define HC12_LOG_NEXT(v)           (v).fetch_add( 1, \
+                                                  std::memory_order_relaxed )
+    #define HC12_LOG_FENCE(o)          std::atomic_thread_fence( std::o )
+#else // NOT defined(__linux__)
+    // single threaded
+    typedef volatile uint32_t hc12LogCounter;
+    #define HC12_LOG_LOAD(v,o)         (v)
+    #define HC12_LOG_STORE(v,x,o)      ((v) = (x))
+    #define HC12_LOG_NEXT(v)           ((v)++)
+    #define HC12_LOG_FENCE(o)
+#endif // defined(__linux__)
+
+#define HC12_LOG_MASK              (HC12_LOG_EVENTS - 1)
+
+//
+// seq is the event number + 1 once the slot is complete, 0 while it is
+// written. The reader copies the event and checks seq again, so a slot
+// overwritten meanwhile is counted as lost instead of being torn.
+//
+struct _hc12_log_slot {
+    hc12LogCounter         seq;
+    struct _hc12_log_event event;
+};
+
+struct _hc12_log_format {
+    const char *pName;
+    const char *pFormat;
+    bool        cmdArg;                   // arg1 is a HC12_CMD_CODE_*
+};
+
+static const struct _hc12_log_format hc12LogFormats[HC12_EV_COUNT] = {
+    { "-",       "",                          false },
+    { "gpio",    "pin %ld error %ld",          false },
+    { "send",    "%s len %ld",                true  },
+    { "done",    "%s result %ld",             true  },
+    { "failed",  "%s status %ld",             true  },
+    { "reply",   "%s type %ld",               true  },
+    { "error",   "%s ERROR",                  true  },
+    { "unknown", "%s no match",               true  },
+    { "mode",    "op mode %ld settle %ld ms", false },
+    { "apply",   "%ld fields len %ld",        false },
+    { "drain",   "%ld bytes dropped, cut %ld", false },
+    { "settle",  "%ld ms, %ld probes",        false },
+    { "frame",   "dropped %ld, %ld bytes",    false },
+    { "arq",     "repeat %ld, rto %ld ms",    false },
+};
+
+static const char hc12LogLevels[] = "-EID";
+
+static struct _hc12_log_slot hc12LogRing[HC12_LOG_EVENTS];
+static hc12LogCounter hc12LogHead;
+
+// consumer only
+static uint32_t hc12LogTail;
+static uint32_t hc12LogLostEvents;
+
+/*
+ ------------------------------------------------------------------------------
+ * static uint32_t hc12LogNow( void )
+ ------------------------------------------------------------------------------
+*/
+static uint32_t hc12LogNow( void )
+{
+#if defined(ARDUINO)
+    return( micros() );
+#else // NOT defined(ARDUINO)
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint32_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000 );
+#endif // defined(ARDUINO)
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12LogRecord( int level, int id, const void *pSource,
+ *                     int32_t arg1, int32_t arg2 )
+ *
+ * called through the HC12_LOG_* macros only
+ ------------------------------------------------------------------------------
+*/
+void hc12LogRecord( int level, int id, const void *pSource,
+                    int32_t arg1, int32_t arg2 )
+{
+    uint32_t seq;
+    struct _hc12_log_slot *pSlot;
+
+    seq = HC12_LOG_NEXT( hc12LogHead );
+    pSlot = &hc12LogRing[seq & HC12_LOG_MASK];
+
+    HC12_LOG_STORE( pSlot->seq, 0, memory_order_relaxed );
+    HC12_LOG_FENCE(memory_order_release);
+
+    pSlot->event.stamp = hc12LogNow();
+    pSlot->event.pSource = pSource;
+    pSlot->event.arg1 = arg1;
+    pSlot->event.arg2 = arg2;
+    pSlot->event.id = (uint8_t) id;
+    pSlot->event.level = (uint8_t) level;
+
+    HC12_LOG_STORE( pSlot->seq, seq + 1, memory_order_release );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * bool hc12LogRead( struct _hc12_log_event *pEvent )
+ *
+ * take the oldest event not read yet
+ * returns false if there is none
+ ------------------------------------------------------------------------------
+*/
+bool hc12LogRead( struct _hc12_log_event *pEvent )
+{
+    bool retVal = false;
+    struct _hc12_log_slot *pSlot;
+    uint32_t head;
+    uint32_t seq;
+
+    while( !retVal && hc12LogTail !=
+           (head = HC12_LOG_LOAD( hc12LogHead, memory_order_acquire )) )
+    {
+        if( head - hc12LogTail > HC12_LOG_EVENTS )
+        {
+            hc12LogLostEvents += head - hc12LogTail - HC12_LOG_EVENTS;
+            hc12LogTail = head - HC12_LOG_EVENTS;
+        }
+
+        pSlot = &hc12LogRing[hc12LogTail & HC12_LOG_MASK];
+        seq = HC12_LOG_LOAD( pSlot->seq, memory_order_acquire );
+
+        if( seq == hc12LogTail + 1 )
+        {
+            memcpy( pEvent, (const void*) &pSlot->event, sizeof(*pEvent) );
+            HC12_LOG_FENCE(memory_order_acquire);
+
+            if( HC12_LOG_LOAD( pSlot->seq, memory_order_relaxed ) ==
+                                                          hc12LogTail + 1 )
+            {
+                retVal = true;
+            }
+            else
+            {
+                hc12LogLostEvents++;
+            }
+            hc12LogTail++;
+        }
+        else if( (int32_t) (seq - (hc12LogTail + 1)) > 0 )
+        {
+            // a newer event is in the slot already
+            hc12LogLostEvents++;
+            hc12LogTail++;
+        }
+        else
+        {
+            // still being written
+            break;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12LogFormat( const struct _hc12_log_event *pEvent,
+ *                    char *pBuffer, size_t size )
+ *
+ * write one event as a line of text, without line feed
+ * returns the length of the line as snprintf() does
+ ------------------------------------------------------------------------------
+*/
+int hc12LogFormat( const struct _hc12_log_event *pEvent,
+                   char *pBuffer, size_t size )
+{
+    const struct _hc12_log_format *pFormat;
+    const struct _hc12_cmd_desc *pDesc;
+    int retVal;
+    int len;
+
+    pFormat = &hc12LogFormats[pEvent->id < HC12_EV_COUNT ? pEvent->id : 0];
+
+    retVal = snprintf( pBuffer, size, "%10lu %c %08lx %-7s ",
+                       (unsigned long) pEvent->stamp,
+                       hc12LogLevels[pEvent->level & 3],
+                       (unsigned long) (uintptr_t) pEvent->pSource,
+                       pFormat->pName );
+
+    if( retVal >= 0 && (size_t) retVal < size )
+    {
+        if( pFormat->cmdArg )
+        {
+            pDesc = hc12CommandDesc( pEvent->arg1 );
+            len = snprintf( &pBuffer[retVal], size - retVal, pFormat->pFormat,
+                            pDesc != NULL ? pDesc->prefix : "-",
+                            (long) pEvent->arg2 );
+        }
+        else
+        {
+            len = snprintf( &pBuffer[retVal], size - retVal, pFormat->pFormat,
+                            (long) pEvent->arg1, (long) pEvent->arg2 );
+        }
+
+        if( len > 0 )
+        {
+            retVal += len;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12LogLost( void )
+ *
+ * returns the amount of events overwritten before they were read
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12LogLost( void )
+{
+    return( hc12LogLostEvents );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12LogDump( void )
+ *
+ * format and print all events not read yet
+ ------------------------------------------------------------------------------
+*/
+void hc12LogDump( void )
+{
+    struct _hc12_log_event event;
+    char line[LOG_BUFFER_SIZE];
+
+    while( hc12LogRead( &event ) )
+    {
+        hc12LogFormat( &event, line, sizeof(line) );
+#if defined(ARDUINO)
+        Serial.println( line );
+#else // NOT defined(ARDUINO)
+        fprintf( stderr, "%s\n", line );
+#endif // defined(ARDUINO)
+    }
+
+    if( hc12LogLostEvents > 0 )
+    {
+        snprintf( line, sizeof(line), "%lu events lost",
+                  (unsigned long) hc12LogLostEvents );
+#if defined(ARDUINO)
+        Serial.println( line );
+#else // NOT defined(ARDUINO)
+        fprintf( stderr, "%s\n", line );
+#endif // defined(ARDUINO)
+    }
+}
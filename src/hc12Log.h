@@ -0,0 +1,111 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Log.h - binary event log, formatted on demand
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_LOG_H_
+#define _HC12_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HC12_LOG_LEVEL_OFF          0
+#define HC12_LOG_LEVEL_ERROR        1
+#define HC12_LOG_LEVEL_INFO         2
+#define HC12_LOG_LEVEL_DEBUG        3
+
+//
+// highest level compiled in, e.g. -DHC12_LOG_LEVEL=HC12_LOG_LEVEL_DEBUG.
+// Calls above it are removed by the preprocessor, arguments included.
+//
+#ifndef HC12_LOG_LEVEL
+    #define HC12_LOG_LEVEL          HC12_LOG_LEVEL_ERROR
+#endif
+
+// events, the meaning of arg1/arg2 is in the format table of hc12Log.cpp
+#define HC12_EV_NONE                0
+#define HC12_EV_GPIO                1    // pin, HC12_GPIO_ERR_*
+#define HC12_EV_CMD_SEND            2    // command code, length
+#define HC12_EV_CMD_DONE            3    // command code, result
+#define HC12_EV_CMD_FAILED          4    // command code, status
+#define HC12_EV_RSP_LINE            5    // command code, HC12_RSP_TYPE_*
+#define HC12_EV_RSP_ERROR           6    // command code, -
+#define HC12_EV_RSP_UNKNOWN         7    // command code, -
+#define HC12_EV_MODE_SWITCH         8    // HC12_OP_* mode, settle ms
+#define HC12_EV_APPLY_SEND          9    // fields, length
+#define HC12_EV_DRAIN              10    // bytes dropped, cut
+#define HC12_EV_SETTLE             11    // ms until AT was answered, probes
+#define HC12_EV_FRAME_DROP         12    // HC12_FRAME_ERR_*, bytes
+#define HC12_EV_ARQ_TIMEOUT        13    // segment, new timeout ms
+#define HC12_EV_COUNT              14
+
+// events kept, MUST be a power of two. The oldest ones are overwritten.
+#if defined(ARDUINO)
+    #define HC12_LOG_EVENTS        16
+    #define LOG_BUFFER_SIZE        60
+#else
+    #define HC12_LOG_EVENTS       256
+    #define LOG_BUFFER_SIZE       120
+#endif // defined(ARDUINO)
+
+struct _hc12_log_event {
+    uint32_t    stamp;                    // us, wrapping around
+    const void *pSource;                  // instance that logged it
+    int32_t     arg1;
+    int32_t     arg2;
+    uint8_t     id;
+    uint8_t     level;
+};
+
+#if HC12_LOG_LEVEL >= HC12_LOG_LEVEL_ERROR
+    #define HC12_LOG_ERROR(id,pSrc,a1,a2) \
+                hc12LogRecord( HC12_LOG_LEVEL_ERROR, id, pSrc, a1, a2 )
+#else
+    #define HC12_LOG_ERROR(id,pSrc,a1,a2)     do {} while( 0 )
+#endif
+
+#if HC12_LOG_LEVEL >= HC12_LOG_LEVEL_INFO
+    #define HC12_LOG_INFO(id,pSrc,a1,a2) \
+                hc12LogRecord( HC12_LOG_LEVEL_INFO, id, pSrc, a1, a2 )
+#else
+    #define HC12_LOG_INFO(id,pSrc,a1,a2)      do {} while( 0 )
+#endif
+
+#if HC12_LOG_LEVEL >= HC12_LOG_LEVEL_DEBUG
+    #define HC12_LOG_DEBUG(id,pSrc,a1,a2) \
+                hc12LogRecord( HC12_LOG_LEVEL_DEBUG, id, pSrc, a1, a2 )
+#else
+    #define HC12_LOG_DEBUG(id,pSrc,a1,a2)     do {} while( 0 )
+#endif
+
+//
+// Recording copies five words into the ring and formats nothing, it
+// may be called from any thread. Reading, formatting and dumping are
+// for one consumer, outside of time critical code.
+//
+void     hc12LogRecord( int level, int id, const void *pSource,
+                        int32_t arg1, int32_t arg2 );
+bool     hc12LogRead( struct _hc12_log_event *pEvent );
+int      hc12LogFormat( const struct _hc12_log_event *pEvent,
+                        char *pBuffer, size_t size );
+uint32_t hc12LogLost( void );
+void     hc12LogDump( void );
+
+#endif // _HC12_LOG_H_
@@ -0,0 +1,286 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Pacer.cpp - transparent mode writes paced to the air rate
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Radio.h"
+#include "hc12Pacer.h"
+
+#if !defined(ARDUINO)
+    #include <time.h>
+#endif // !defined(ARDUINO)
+
+#define HC12_PACE_ONE_SECOND      (1000000ULL << HC12_PACE_FRAC_BITS)
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Pacer::hc12Pacer( void )
+ ------------------------------------------------------------------------------
+*/
+hc12Pacer::hc12Pacer( void )
+{
+    _enabled = true;
+    _margin = HC12_PACE_MARGIN;
+    configure( HC12_DEFAULT_TTMODE, HC12_DEFAULT_BAUD, 10 );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Pacer::nowUs( void )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Pacer::nowUs( void )
+{
+#if defined(ARDUINO)
+    return( micros() );
+#else // NOT defined(ARDUINO)
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint32_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000 );
+#endif // defined(ARDUINO)
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Pacer::airBps( int ttMode, uint32_t baud )
+ *
+ * returns the bit rate on the air, 0 for an unknown mode
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Pacer::airBps( int ttMode, uint32_t baud )
+{
+    uint32_t retVal = 0;
+
+    switch( ttMode )
+    {
+        case HC12_TTMODE_FU1:
+            retVal = HC12_AIR_FU1_BPS;
+            break;
+        case HC12_TTMODE_FU2:
+            retVal = HC12_AIR_FU2_BPS;
+            break;
+        case HC12_TTMODE_FU3:
+            if( baud <= HC12_BAUD_2400 )
+            {
+                retVal = 5000;
+            }
+            else if( baud <= HC12_BAUD_9600 )
+            {
+                retVal = 15000;
+            }
+            else if( baud <= HC12_BAUD_38400 )
+            {
+                retVal = 58000;
+            }
+            else
+            {
+                retVal = 236000;
+            }
+            break;
+        case HC12_TTMODE_FU4:
+            retVal = HC12_AIR_FU4_BPS;
+            break;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Pacer::configure( int ttMode, uint32_t baud, int bitsPerChar )
+ *
+ * derive the cost of a byte from the mode and the UART settings,
+ * bitsPerChar counts start, data, parity and stop bits. The bucket
+ * starts full.
+ ------------------------------------------------------------------------------
+*/
+void hc12Pacer::configure( int ttMode, uint32_t baud, int bitsPerChar )
+{
+    uint64_t airCost = 0;
+    uint64_t uartCost = 0;
+
+    _ttMode = ttMode;
+    _baud = baud;
+    _bitsPerChar = bitsPerChar;
+    _airBps = airBps( ttMode, baud );
+
+    if( _airBps > 0 )
+    {
+        // data and the share of the packet overhead per byte
+        airCost = ((uint64_t) (8 * HC12_AIR_PACKET_BYTES +
+                               HC12_AIR_OVERHEAD_BITS) *
+                   HC12_PACE_ONE_SECOND) /
+                  ((uint64_t) HC12_AIR_PACKET_BYTES * _airBps);
+
+        if( ttMode == HC12_TTMODE_FU2 || ttMode == HC12_TTMODE_FU4 )
+        {
+            airCost += ((uint64_t) HC12_AIR_PACKET_GAP_MS * 1000 <<
+                        HC12_PACE_FRAC_BITS) / HC12_AIR_PACKET_BYTES;
+        }
+
+        if( _margin > 0 && _margin < 100 )
+        {
+            airCost = airCost * 100 / _margin;
+        }
+    }
+
+    if( baud > 0 )
+    {
+        uartCost = ((uint64_t) bitsPerChar * HC12_PACE_ONE_SECOND) / baud;
+    }
+
+    _cost = airCost > uartCost ? (uint32_t) airCost : 0;
+    _capacity = (int32_t) (_cost * HC12_AIR_PACKET_BYTES);
+    _credit = _capacity;
+    _last = nowUs();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Pacer::setMargin( uint32_t percent )
+ ------------------------------------------------------------------------------
+*/
+void hc12Pacer::setMargin( uint32_t percent )
+{
+    _margin = percent;
+    configure( _ttMode, _baud, _bitsPerChar );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Pacer::refill( void )
+ ------------------------------------------------------------------------------
+*/
+void hc12Pacer::refill( void )
+{
+    uint32_t now = nowUs();
+    uint32_t elapsed = now - _last;
+
+    _last = now;
+
+    // compared in us first, the shift could overflow after a long pause
+    if( elapsed >= (uint32_t) (_capacity >> HC12_PACE_FRAC_BITS) ||
+        (int64_t) _credit + ((int64_t) elapsed << HC12_PACE_FRAC_BITS) >=
+                                                                 _capacity )
+    {
+        _credit = _capacity;
+    }
+    else
+    {
+        _credit += (int32_t) (elapsed << HC12_PACE_FRAC_BITS);
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12Pacer::allowance( void )
+ ------------------------------------------------------------------------------
+*/
+size_t hc12Pacer::allowance( void )
+{
+    size_t retVal = SIZE_MAX;
+
+    if( paced() )
+    {
+        refill();
+        retVal = _credit > 0 ? (size_t) _credit / _cost : 0;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Pacer::spend( size_t len )
+ *
+ * account for len bytes written. More than allowance() overdraws the
+ * bucket by up to one packet, the writer waits for that afterwards.
+ ------------------------------------------------------------------------------
+*/
+void hc12Pacer::spend( size_t len )
+{
+    int64_t credit;
+
+    if( paced() )
+    {
+        credit = (int64_t) _credit - (int64_t) len * _cost;
+        _credit = credit < -_capacity ? -_capacity : (int32_t) credit;
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Pacer::delayUs( size_t len )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Pacer::delayUs( size_t len )
+{
+    uint32_t retVal = 0;
+    int64_t missing;
+
+    if( paced() )
+    {
+        refill();
+        missing = (int64_t) len * _cost - _credit;
+        if( missing > 0 )
+        {
+            retVal = (uint32_t) ((missing + (1 << HC12_PACE_FRAC_BITS) - 1) >>
+                                 HC12_PACE_FRAC_BITS);
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Pacer::airtimeUs( size_t len )
+ *
+ * the module splits len bytes into packets of HC12_AIR_PACKET_BYTES,
+ * the pauses between packets of FU2 and FU4 are not counted
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Pacer::airtimeUs( size_t len )
+{
+    uint32_t retVal = 0;
+    uint64_t bits;
+    size_t packets;
+
+    if( _airBps > 0 && len > 0 )
+    {
+        packets = (len + HC12_AIR_PACKET_BYTES - 1) / HC12_AIR_PACKET_BYTES;
+        bits = (uint64_t) len * 8 + (uint64_t) packets * HC12_AIR_OVERHEAD_BITS;
+        retVal = (uint32_t) ((bits * 1000000 + _airBps - 1) / _airBps);
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Pacer::rate( void )
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Pacer::rate( void )
+{
+    return( paced() ? (uint32_t) (HC12_PACE_ONE_SECOND / _cost) : 0 );
+}
@@ -0,0 +1,115 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Pacer.h - transparent mode writes paced to the air rate
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_PACER_H_
+#define _HC12_PACER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Rate model of the module, from the data sheet:
+//
+//   FU1  250000 bps on the air, any UART rate
+//   FU2  250000 bps on the air, UART 1200..4800, at most 60 bytes per
+//        packet and about 2 s between packets
+//   FU3  air rate follows the UART rate:  1200/2400 ->   5000 bps
+//                                         4800/9600 ->  15000 bps
+//                                      19200/38400 ->  58000 bps
+//                                    57600/115200 -> 236000 bps
+//   FU4  500 bps on the air, UART 1200, 60 bytes per packet and about
+//        2 s between packets
+//
+// The module sends what it got in packets of up to
+// HC12_AIR_PACKET_BYTES. Each packet costs HC12_AIR_OVERHEAD_BITS on
+// top of the data (preamble, sync word, length and check sum, an
+// estimate, the data sheet has no number for it).
+//
+#define HC12_AIR_PACKET_BYTES      60
+#define HC12_AIR_OVERHEAD_BITS     80
+#define HC12_AIR_PACKET_GAP_MS   2000    // FU2 and FU4 only
+#define HC12_AIR_FU1_BPS       250000
+#define HC12_AIR_FU2_BPS       250000
+#define HC12_AIR_FU4_BPS          500
+
+// share of the modelled capacity used, room for a wrong estimate
+#define HC12_PACE_MARGIN           90    // percent
+
+// internal time unit, 1/16 us
+#define HC12_PACE_FRAC_BITS         4
+
+//
+// Token bucket in front of the UART. Tokens are time: the bucket fills
+// with the time passing and each byte written takes the time the
+// module needs to get rid of it. The bucket holds one air packet, so a
+// packet goes out at the full UART rate and after that the writer
+// follows the air.
+//
+// Where the UART is slower than the air nothing is paced, the UART
+// itself is the limit then (FU1 and FU3 at every rate the data sheet
+// lists). FU2 and FU4 are paced.
+//
+// configure() is called by hc12Radio whenever it goes to transparent
+// mode, with the settings of the module at that time.
+//
+class hc12Pacer {
+
+  protected:
+    bool     _enabled;
+    int      _ttMode;
+    uint32_t _baud;
+    int      _bitsPerChar;
+    uint32_t _margin;
+    uint32_t _airBps;
+    uint32_t _cost;                       // per byte, 1/16 us, 0 unpaced
+    int32_t  _capacity;                   // bucket size, 1/16 us
+    int32_t  _credit;                     // 1/16 us, below 0 if overdrawn
+    uint32_t _last;                       // us
+
+    void refill( void );
+
+  public:
+    hc12Pacer( void );
+
+    static uint32_t airBps( int ttMode, uint32_t baud );
+    static uint32_t nowUs( void );
+
+    void configure( int ttMode, uint32_t baud, int bitsPerChar );
+    void enable( bool on ) { _enabled = on; }
+    bool enabled( void ) { return( _enabled ); }
+    void setMargin( uint32_t percent );
+    bool paced( void ) { return( _enabled && _cost > 0 ); }
+    int ttMode( void ) { return( _ttMode ); }
+
+// bytes that may be written now, SIZE_MAX if nothing is paced
+    size_t allowance( void );
+    void   spend( size_t len );
+// us until len bytes may be written, 0 if they may right now
+    uint32_t delayUs( size_t len );
+
+// time on the air of len bytes written in one go
+    uint32_t airtimeUs( size_t len );
+// bytes per second the writer gets, 0 if it is not paced
+    uint32_t rate( void );
+};
+
+#endif // _HC12_PACER_H_
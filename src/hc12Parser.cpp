@@ -0,0 +1,423 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Parser.cpp - incremental parser for hc-12 command responses
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include <string.h>
+
+#include "hc12Parser.h"
+
+//
+// every response the module sends, upper case
+// OK is a prefix of the OK+ entries, longer matches win
+//
+static const struct _hc12_rsp_pattern hc12RspTable[] = {
+    { "OK",         HC12_RSP_TYPE_OK,        HC12_RSP_ARG_NONE    },
+    { "OK+DEFAULT", HC12_RSP_TYPE_DEFAULT,   HC12_RSP_ARG_NONE    },
+    { "OK+SLEEP",   HC12_RSP_TYPE_SLEEP,     HC12_RSP_ARG_NONE    },
+    { "OK+B",       HC12_RSP_TYPE_BAUD,      HC12_RSP_ARG_NUMBER  },
+    { "OK+C",       HC12_RSP_TYPE_CHANNEL,   HC12_RSP_ARG_NUMBER  },
+    { "OK+RC",      HC12_RSP_TYPE_CHANNEL,   HC12_RSP_ARG_NUMBER  },
+    { "OK+FU",      HC12_RSP_TYPE_TTMODE,    HC12_RSP_ARG_NUMBER  },
+    { "OK+P",       HC12_RSP_TYPE_POWER,     HC12_RSP_ARG_NUMBER  },
+    { "OK+RP:",     HC12_RSP_TYPE_POWER_DBM, HC12_RSP_ARG_NUMBER  },
+    { "OK+U",       HC12_RSP_TYPE_SERIAL,    HC12_RSP_ARG_SERIAL  },
+    { "HC-12_V",    HC12_RSP_TYPE_VERSION,   HC12_RSP_ARG_VERSION },
+    { "ERROR",      HC12_RSP_TYPE_ERROR,     HC12_RSP_ARG_NONE    },
+};
+
+#define HC12_RSP_TABLE_SIZE \
+    (sizeof(hc12RspTable) / sizeof(hc12RspTable[0]))
+#define HC12_RSP_ALL        ((uint16_t) ((1u << HC12_RSP_TABLE_SIZE) - 1))
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Parser::hc12Parser( void )
+ ------------------------------------------------------------------------------
+*/
+hc12Parser::hc12Parser( void )
+{
+    reset();
+    memset( &_last, '\0', sizeof(_last) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Parser::reset( void )
+ *
+ * forget a partial line and start hunting for the next response
+ ------------------------------------------------------------------------------
+*/
+void hc12Parser::reset( void )
+{
+    _candidates = HC12_RSP_ALL;
+    _pos = 0;
+    _entry = -1;
+    _entryLen = 0;
+    _state = HC12_PARSE_STATE_HUNT;
+    _lineLen = 0;
+    _argStep = 0;
+    _digits = 0;
+    _negative = false;
+    _argDone = false;
+
+    memset( &_current, '\0', sizeof(_current) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Parser::fail( void )
+ *
+ * the line does not match any response, ignore the rest of it
+ ------------------------------------------------------------------------------
+*/
+void hc12Parser::fail( void )
+{
+    _current.type = HC12_RSP_TYPE_UNKNOWN;
+    _state = HC12_PARSE_STATE_SKIP;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Parser::hunt( char c )
+ *
+ * narrow down the candidates by one more prefix character. Leading
+ * garbage (e.g. "www.hc01.com  HC-12_V2.4") is skipped by restarting
+ * the search on a mismatch.
+ ------------------------------------------------------------------------------
+*/
+void hc12Parser::hunt( char c )
+{
+    uint16_t mask = 0;
+    unsigned int i;
+
+    for( i = 0; i < HC12_RSP_TABLE_SIZE; i++ )
+    {
+        if( (_candidates & (1u << i)) && hc12RspTable[i].prefix[_pos] == c )
+        {
+            mask |= (1u << i);
+        }
+    }
+
+    if( mask != 0 )
+    {
+        _candidates = mask;
+        _pos++;
+
+        for( i = 0; i < HC12_RSP_TABLE_SIZE; i++ )
+        {
+            if( (mask & (1u << i)) && hc12RspTable[i].prefix[_pos] == '\0' )
+            {
+                _entry = i;
+                _entryLen = _pos;
+            }
+        }
+    }
+    else
+    {
+        if( _entry >= 0 )
+        {
+            startArg( c );
+        }
+        else
+        {
+            if( _pos > 0 )
+            {
+                _candidates = HC12_RSP_ALL;
+                _pos = 0;
+                hunt( c );
+            }
+        }
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Parser::startArg( char c )
+ *
+ * the prefix is complete, c is the first character behind it
+ ------------------------------------------------------------------------------
+*/
+void hc12Parser::startArg( char c )
+{
+    _current.type = hc12RspTable[_entry].type;
+    _state = HC12_PARSE_STATE_ARG;
+    _argStep = 0;
+    _digits = 0;
+    _negative = false;
+    _argDone = false;
+
+    argument( c );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Parser::number( char c, int32_t *pValue )
+ *
+ * accumulate one character of a decimal number with optional sign
+ ------------------------------------------------------------------------------
+*/
+void hc12Parser::number( char c, int32_t *pValue )
+{
+    if( c >= '0' && c <= '9' )
+    {
+        *pValue = *pValue * 10 + (c - '0');
+        _digits++;
+    }
+    else
+    {
+        if( _digits == 0 && !_negative && (c == '+' || c == '-') &&
+            _argStep == 0 )
+        {
+            _negative = (c == '-');
+            _argStep = 1;
+        }
+        else
+        {
+            if( _digits > 0 )
+            {
+                if( _negative )
+                {
+                    *pValue = -*pValue;
+                    _negative = false;
+                }
+                _argDone = true;
+            }
+            else
+            {
+                fail();
+            }
+        }
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Parser::argument( char c )
+ *
+ * decode the argument of the matched response
+ ------------------------------------------------------------------------------
+*/
+void hc12Parser::argument( char c )
+{
+    if( _argDone )
+    {
+        // trailing text like "dBm"
+        _state = HC12_PARSE_STATE_SKIP;
+        return;
+    }
+
+    switch( hc12RspTable[_entry].arg )
+    {
+        case HC12_RSP_ARG_NONE:
+            if( c != ' ' && c != '\t' )
+            {
+                fail();
+            }
+            break;
+        case HC12_RSP_ARG_NUMBER:
+            number( c, &_current.value );
+            break;
+        case HC12_RSP_ARG_SERIAL:
+            switch( _argStep++ )
+            {
+                case 0:
+                    if( c >= '5' && c <= '8' )
+                    {
+                        _current.databits = c - '0';
+                    }
+                    else
+                    {
+                        fail();
+                    }
+                    break;
+                case 1:
+                    c &= ~0x20;
+                    if( c == 'N' || c == 'O' || c == 'E' )
+                    {
+                        _current.parity = c;
+                    }
+                    else
+                    {
+                        fail();
+                    }
+                    break;
+                case 2:
+                    if( c >= '1' && c <= '3' )
+                    {
+                        _current.stopbits = c - '0';
+                        _argDone = true;
+                    }
+                    else
+                    {
+                        fail();
+                    }
+                    break;
+            }
+            break;
+        case HC12_RSP_ARG_VERSION:
+            if( c >= '0' && c <= '9' )
+            {
+                if( _argStep == 0 )
+                {
+                    _current.major = _current.major * 10 + (c - '0');
+                }
+                else
+                {
+                    _current.minor = _current.minor * 10 + (c - '0');
+                }
+                _digits++;
+            }
+            else
+            {
+                if( c == '.' && _argStep == 0 && _digits > 0 )
+                {
+                    _argStep = 1;
+                    _digits = 0;
+                }
+                else
+                {
+                    if( _argStep == 1 && _digits > 0 )
+                    {
+                        _argDone = true;
+                    }
+                    else
+                    {
+                        fail();
+                    }
+                }
+            }
+            break;
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Parser::endLine( void )
+ *
+ * line end seen, decide on the result of the line
+ ------------------------------------------------------------------------------
+*/
+void hc12Parser::endLine( void )
+{
+    switch( _state )
+    {
+        case HC12_PARSE_STATE_HUNT:
+            if( _entry >= 0 && _entryLen == _pos )
+            {
+                _current.type = hc12RspTable[_entry].type;
+                if( hc12RspTable[_entry].arg != HC12_RSP_ARG_NONE )
+                {
+                    // prefix without argument
+                    _current.type = HC12_RSP_TYPE_UNKNOWN;
+                }
+            }
+            else
+            {
+                _current.type = HC12_RSP_TYPE_UNKNOWN;
+            }
+            break;
+        case HC12_PARSE_STATE_ARG:
+            switch( hc12RspTable[_entry].arg )
+            {
+                case HC12_RSP_ARG_NUMBER:
+                    if( !_argDone && _digits > 0 )
+                    {
+                        if( _negative )
+                        {
+                            _current.value = -_current.value;
+                        }
+                        _argDone = true;
+                    }
+                    break;
+                case HC12_RSP_ARG_VERSION:
+                    if( _argStep == 1 && _digits > 0 )
+                    {
+                        _argDone = true;
+                    }
+                    break;
+                case HC12_RSP_ARG_NONE:
+                    _argDone = true;
+                    break;
+            }
+
+            if( !_argDone )
+            {
+                _current.type = HC12_RSP_TYPE_UNKNOWN;
+            }
+            break;
+        case HC12_PARSE_STATE_SKIP:
+        default:
+            break;
+    }
+
+    _last = _current;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Parser::feed( char c )
+ *
+ * process one received character
+ * returns HC12_PARSE_LINE if a response line is complete, the typed
+ * result is available by response() then. Otherwise HC12_PARSE_MORE.
+ ------------------------------------------------------------------------------
+*/
+int hc12Parser::feed( char c )
+{
+    int retVal = HC12_PARSE_MORE;
+
+    if( c == '\r' || c == '\n' )
+    {
+        if( _lineLen > 0 )
+        {
+            endLine();
+            reset();
+            retVal = HC12_PARSE_LINE;
+        }
+    }
+    else
+    {
+        if( _lineLen < 0xff )
+        {
+            _lineLen++;
+        }
+
+        if( c >= 'a' && c <= 'z' )
+        {
+            c -= 'a' - 'A';
+        }
+
+        switch( _state )
+        {
+            case HC12_PARSE_STATE_HUNT:
+                hunt( c );
+                break;
+            case HC12_PARSE_STATE_ARG:
+                argument( c );
+                break;
+            case HC12_PARSE_STATE_SKIP:
+            default:
+                break;
+        }
+    }
+
+    return( retVal );
+}
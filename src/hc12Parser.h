@@ -0,0 +1,112 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Parser.h - incremental parser for hc-12 command responses
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_PARSER_H_
+#define _HC12_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HC12_RSP_TYPE_UNKNOWN       0
+#define HC12_RSP_TYPE_OK            1
+#define HC12_RSP_TYPE_DEFAULT       2
+#define HC12_RSP_TYPE_SLEEP         3
+#define HC12_RSP_TYPE_BAUD          4
+#define HC12_RSP_TYPE_CHANNEL       5
+#define HC12_RSP_TYPE_TTMODE        6
+#define HC12_RSP_TYPE_POWER         7
+#define HC12_RSP_TYPE_POWER_DBM     8
+#define HC12_RSP_TYPE_SERIAL        9
+#define HC12_RSP_TYPE_VERSION      10
+#define HC12_RSP_TYPE_ERROR        11
+
+#define HC12_RSP_ARG_NONE           0
+#define HC12_RSP_ARG_NUMBER         1
+#define HC12_RSP_ARG_SERIAL         2
+#define HC12_RSP_ARG_VERSION        3
+
+#define HC12_PARSE_MORE             0
+#define HC12_PARSE_LINE             1
+
+#define HC12_PARSE_STATE_HUNT       0
+#define HC12_PARSE_STATE_ARG        1
+#define HC12_PARSE_STATE_SKIP       2
+
+struct _hc12_rsp_pattern {
+    const char *prefix;
+    int8_t      type;
+    int8_t      arg;
+};
+
+//
+// typed result of one response line
+//
+struct _hc12_response {
+    int8_t  type;
+    int32_t value;
+    int8_t  databits;
+    char    parity;
+    int8_t  stopbits;
+    int8_t  major;
+    int8_t  minor;
+};
+
+//
+// The parser is fed byte by byte as data arrives and needs neither a
+// line buffer nor sscanf. While hunting it keeps a bit mask of the
+// table entries still matching the prefix seen so far, the longest
+// completed prefix decides how the argument is decoded.
+//
+class hc12Parser {
+
+  protected:
+    uint16_t _candidates;
+    uint8_t  _pos;
+    int8_t   _entry;
+    uint8_t  _entryLen;
+    uint8_t  _state;
+    uint8_t  _lineLen;
+    uint8_t  _argStep;
+    uint8_t  _digits;
+    bool     _negative;
+    bool     _argDone;
+
+    struct _hc12_response _current;
+    struct _hc12_response _last;
+
+    void hunt( char c );
+    void startArg( char c );
+    void argument( char c );
+    void number( char c, int32_t *pValue );
+    void fail( void );
+    void endLine( void );
+
+  public:
+    hc12Parser( void );
+
+    void reset( void );
+    int  feed( char c );
+
+    const struct _hc12_response* response( void ) { return( &_last ); }
+};
+
+#endif // _HC12_PARSER_H_
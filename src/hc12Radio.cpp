@@ -22,32 +22,32 @@
 
 #include "hc12Radio.h"
 
+#if defined(__linux__)
+    #include <errno.h>
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <time.h>
+#endif // defined(__linux__)
 
-#define DEBUG_LEVEL_0         0
-#define DEBUG_LEVEL_1         1
+// cancels a manual mode switch, see hc12AskSetPin()
+#define HC12_KEY_ESC            0x1b
 
-static int hc12DebugLevel = DEBUG_LEVEL_0;
+#if defined(RASPBERRY)
+// pin backend of all radios unless the application sets another one
+static hc12GpioPigpio hc12DefaultGpio;
+#endif // defined(RASPBERRY)
 
-char hc12LogBuffer[LOG_BUFFER_SIZE];
+// set command of each HC12_PARAM_FIELD_*, applyFields() sends all of
+// them in one buffer
+static const int hc12SetCodes[HC12_PARAM_FIELDS] = {
+    HC12_CMD_CODE_SET_CHANNEL, HC12_CMD_CODE_SET_POWER,
+    HC12_CMD_CODE_SET_TTMODE, HC12_CMD_CODE_SET_BAUD };
 
-void doLog(int level)
-{
-    if( level >= hc12DebugLevel )
-    {
-        switch(level)
-        {
-            case DEBUG_LEVEL_0:
-                break;
-            case DEBUG_LEVEL_1:
-#if defined(__linux__)
-                fprintf(stderr, "%s", hc12LogBuffer);
-#else
-                Serial.print(hc12LogBuffer);
-#endif // defined(__linux__)
-                break;
-        }
-    }
-}
+static_assert( hc12CommandMaxLen( HC12_CMD_CODE_SET_CHANNEL ) +
+               hc12CommandMaxLen( HC12_CMD_CODE_SET_POWER ) +
+               hc12CommandMaxLen( HC12_CMD_CODE_SET_TTMODE ) +
+               hc12CommandMaxLen( HC12_CMD_CODE_SET_BAUD ) < IO_BUFFER_SIZE,
+               "set commands do not fit into IO_BUFFER_SIZE" );
 
 #if defined(__linux__)
 
@@ -319,26 +319,30 @@ bool hc12Radio::isValidChannel( int channel )
 
 hc12Radio::hc12Radio(int setPin, HardwareSerial *port)
 {
-    _connection = new serialConnection(port);
+    _pTransport = new hc12SerialTransport(port);
+    _ownTransport = true;
     _moduleParam.setPin = setPin;
 }
 
 hc12Radio::hc12Radio(int setPin, SoftwareSerial *port)
 {
-    _connection = new serialConnection(port);
+    _pTransport = new hc12SerialTransport(port);
+    _ownTransport = true;
     _moduleParam.setPin = setPin;
 }
 
 hc12Radio::hc12Radio(int setPin, int powerPin, HardwareSerial *port)
 {
-    _connection = new serialConnection(port);
+    _pTransport = new hc12SerialTransport(port);
+    _ownTransport = true;
     _moduleParam.setPin = setPin;
     _moduleParam.powerPin = powerPin;
 }
 
 hc12Radio::hc12Radio(int setPin, int powerPin, SoftwareSerial *port)
 {
-    _connection = new serialConnection(port);
+    _pTransport = new hc12SerialTransport(port);
+    _ownTransport = true;
     _moduleParam.setPin = setPin;
     _moduleParam.powerPin = powerPin;
 }
@@ -347,14 +351,50 @@ hc12Radio::hc12Radio(int setPin, int powerPin, SoftwareSerial *port)
 
 hc12Radio::hc12Radio(int setPin, int powerPin) 
 {  
-    _connection = new serialConnection(); 
+    _pTransport = new hc12SerialTransport(); 
+    _ownTransport = true;
     _moduleParam.setPin = setPin;
     _moduleParam.powerPin = powerPin;
+    _moduleParam.serialParam.device = NULL;
     init();
 }
 
 #endif // defined(ARDUINO)
 
+hc12Radio::hc12Radio(hc12Transport *pTransport, int setPin, int powerPin)
+{
+    _pTransport = pTransport;
+    _ownTransport = false;
+    _moduleParam.setPin = setPin;
+    _moduleParam.powerPin = powerPin;
+#if defined(__linux__)
+    _moduleParam.serialParam.device = NULL;
+#endif // defined(__linux__)
+#if !defined(ARDUINO)
+    init();
+#endif // !defined(ARDUINO)
+}
+
+hc12Radio::~hc12Radio( void )
+{
+#if defined(__linux__)
+    // the reader thread works on the rings of this object
+    stopReader();
+#endif // defined(__linux__)
+
+    disconnect();
+
+#if defined(__linux__)
+    free( _moduleParam.serialParam.device );
+    _moduleParam.serialParam.device = NULL;
+#endif // defined(__linux__)
+
+    if( _ownTransport )
+    {
+        delete _pTransport;
+    }
+}
+
 
 
 #if defined(__linux__)
@@ -378,6 +418,30 @@ void hc12Radio::dump( int what )
         case HC12_DUMP_HC12_PARAM:
             dumpHC12Param( &_moduleParam );
             break;
+        case HC12_DUMP_LOG:
+            hc12LogDump();
+            break;
+        case HC12_DUMP_PARAM_STATE:
+            fprintf(stderr, "\ndumpParamState\n");
+            fprintf(stderr, "--------------\n");
+            fprintf(stderr, "comChannel: %d\n", 
+                    _paramState[HC12_PARAM_FIELD_CHANNEL] );
+            fprintf(stderr, "power ....: %d\n", 
+                    _paramState[HC12_PARAM_FIELD_POWER] );
+            fprintf(stderr, "ttMode ...: %d\n", 
+                    _paramState[HC12_PARAM_FIELD_TTMODE] );
+            fprintf(stderr, "baud .....: %d\n", 
+                    _paramState[HC12_PARAM_FIELD_BAUD] );
+            fprintf(stderr, "version ..: %d\n", 
+                    _paramState[HC12_PARAM_FIELD_VERSION] );
+            fprintf(stderr, "serial ...: %d\n", 
+                    _paramState[HC12_PARAM_FIELD_SERIAL] );
+            break;
+#if defined(HC12_WITH_STATS)
+        case HC12_DUMP_STATS:
+            _stats.dump();
+            break;
+#endif // defined(HC12_WITH_STATS)
         default:
             break;
     }
@@ -437,25 +501,19 @@ short hc12Radio::powerMode2DB(int power)
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::getResponse( void )
+ * int hc12Radio::expectedLines( int command )
  *
- * read the response of the attached smart-TFT into _ioBuffer
- * returns the amount if characters read or an error code
+ * returns the amount of response lines that complete the given command
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getResponse( void )
+int hc12Radio::expectedLines( int command )
 {
-    int retVal;
+    const struct _hc12_cmd_desc *pDesc;
+    int retVal = 1;
 
-    if( _connection != NULL )
+    if( (pDesc = hc12CommandDesc( command )) != NULL )
     {
-        memset( _ioBuffer, '\0', IO_BUFFER_SIZE );
-        retVal = _connection->readline( _ioBuffer,
-                                      IO_BUFFER_SIZE-1 );
-    }
-    else
-    {
-        retVal = E_NULL_CONNECTION;
+        retVal = pDesc->rspLines;
     }
 
     return( retVal );
@@ -463,470 +521,97 @@ int hc12Radio::getResponse( void )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::parseResponse( void )
+ * int hc12Radio::idleGap( void )
  *
- * parse the response of the attached board
- * returns parsing result
+ * returns the inter-character gap in ms that ends a reply, scaled to the
+ * baud rate of the serial link
  ------------------------------------------------------------------------------
 */
-#define NO_MORE_DATA    22
-#define TRY_MORE_DATA   33
-
-int hc12Radio::parseResponse( void )
+int hc12Radio::idleGap( void )
 {
-    static uint32_t baud;
-    static int channel;
-    static int powerDB;
-    static int ttMode;
-    static int power;
-    static char parity;
-    static int stopbits;
-    static int databits;
-    static char major;
-    static char minor;
-
-    int retVal = NO_MORE_DATA;
-    char *pResult;
-    int parsedValues = 0;
+    int retVal = HC12_IDLE_GAP_MIN_MS;
+    uint32_t gap;
 
-    if( _connection != NULL )
+    if( _linkBaud > 0 )
     {
-        if( (pResult = strcasestr( _ioBuffer, "OK")) != NULL )
+        // 10 bit per character, rounded up
+        gap = (_idleGapChars * 10 * 1000 + _linkBaud - 1) / _linkBaud;
+        if( gap > (uint32_t) retVal )
         {
-            parsedValues = 0;
+            retVal = gap;
+        }
+    }
 
-            if(pResult[2] == '+' )
-            {
-                switch(pResult[3])
-                {
-                    case 'B':
-sprintf(hc12LogBuffer, "OK+B ...");
-doLog(DEBUG_LEVEL_1);
-                        parsedValues = sscanf(pResult, HC12_RSP_GET_BAUD, 
-                                         &baud);
-                        if( parsedValues == HC12_ARGS_RSP_GET_BAUD )
-                        {
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                        }
-                        else
-                        {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                            _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                        }
-                        break;
-                    case 'R':
-sprintf(hc12LogBuffer, "OK+R ");
-doLog(DEBUG_LEVEL_1);
-                        switch(pResult[4])
-                        {
-                            case 'C':
-sprintf(hc12LogBuffer, " C ...");
-doLog(DEBUG_LEVEL_1);
-                                parsedValues = sscanf(pResult, 
-                                         HC12_RSP_GET_CHANNEL, &channel );
-                                if( parsedValues == HC12_ARGS_RSP_GET_CHANNEL )
-                                {
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                                }
-                                else
-                                {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                                    _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                                }
-                                break;
-                            case 'P':
-sprintf(hc12LogBuffer, " P ...");
-doLog(DEBUG_LEVEL_1);
-                                parsedValues = sscanf(pResult, 
-                                         HC12_RSP_GET_POWER, &powerDB );
-                                if( parsedValues == HC12_ARGS_RSP_GET_POWER )
-                                {
-                                    power = powerDB2Mode(powerDB);
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                                }
-                                else
-                                {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                                    _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                                }
-                                break;
-                            default:
-sprintf(hc12LogBuffer, " ?[=%c] ...", pResult[4]);
-doLog(DEBUG_LEVEL_1);
-                                _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                                break;
-                        }
-                        break;
-                    case 'F':
-sprintf(hc12LogBuffer, "OK+F ...");
-doLog(DEBUG_LEVEL_1);
-                        parsedValues = sscanf(pResult, HC12_RSP_GET_TTMODE, 
-                                         &ttMode );
-                        if( parsedValues == HC12_ARGS_RSP_GET_TTMODE )
-                        {
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                        }
-                        else
-                        {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                            _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                        }
-                        break;
-                    case 'C':
-sprintf(hc12LogBuffer, "OK+C ...");
-doLog(DEBUG_LEVEL_1);
-                        parsedValues = sscanf(pResult, HC12_RSP_SET_CHANNEL, 
-                                         &channel );
-                        if( parsedValues == HC12_ARGS_RSP_SET_CHANNEL )
-                        {
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                        }
-                        else
-                        {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                            _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                        }
-                        break;
-                    case 'D':
-sprintf(hc12LogBuffer, "OK+D ...");
-doLog(DEBUG_LEVEL_1);
-                        parsedValues = strncmp( pResult, HC12_RSP_SET_DEFAULT,
-                               strlen(HC12_RSP_SET_DEFAULT) );
-
-                        if( parsedValues == HC12_ARGS_RSP_SET_DEFAULT )
-                        {
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                        }
-                        else
-                        {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                            _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                        }
-                        break;
-                    case 'S':
-sprintf(hc12LogBuffer, "OK+S ...");
-doLog(DEBUG_LEVEL_1);
-                        parsedValues = strncmp( pResult, HC12_RSP_SLEEP,
-                               strlen(HC12_RSP_SLEEP) );
-                        if( parsedValues == HC12_ARGS_RSP_SLEEP )
-                        {
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                        }
-                        else
-                        {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                            _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                        }
-                        break;
-                    case 'P':
-sprintf(hc12LogBuffer, "OK+P ...");
-doLog(DEBUG_LEVEL_1);
-                        parsedValues = sscanf(pResult, HC12_RSP_SET_POWER, 
-                                         &power );
-                        if( parsedValues == HC12_ARGS_RSP_SET_POWER )
-                        {
-                            powerDB = powerMode2DB(power);
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                        }
-                        else
-                        {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                            _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                        }
-                        break;
-                    case 'U':
-sprintf(hc12LogBuffer, "OK+U ...");
-doLog(DEBUG_LEVEL_1);
-                        parsedValues = sscanf(pResult, HC12_RSP_SET_SERIAL, 
-                                         &databits, &parity, &stopbits );
-                        if( parsedValues == HC12_ARGS_RSP_SET_SERIAL )
-                        {
-sprintf(hc12LogBuffer, "match!\n");
-doLog(DEBUG_LEVEL_1);
-                        }
-                        else
-                        {
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                            _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                        }
-                        break;
-                    default:
-sprintf(hc12LogBuffer, "OK+ ?[=%c] ", pResult[4]);
-doLog(DEBUG_LEVEL_1);
-                        _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-sprintf(hc12LogBuffer, "NO match!\n");
-doLog(DEBUG_LEVEL_1);
-                        break;
+    return( retVal );
+}
 
-                }
-//                retVal = TRY_MORE_DATA;
-                retVal = NO_MORE_DATA;
-            }
-            else
-            {
-                // result of test command
-                if( strncmp(pResult,HC12_RSP_TEST,strlen(HC12_RSP_TEST)) == 0 )
-                {
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                else
-                {
-                    _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
-                }
-            }
-        }
-        else
-        {
-            if( (pResult = strcasestr( _ioBuffer, "HC-12")) != NULL )
-            {
-                parsedValues = sscanf(pResult, HC12_RSP_GET_VERSION, 
-                                         &major, &minor );
-                if( parsedValues == HC12_ARGS_RSP_GET_VERSION )
-                {
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-//                    _currentCommand = HC12_CMD_CODE_NULL;
-                }
-                else
-                {
-                    parsedValues = 0;
-                    _commandStatus = HC12_CMD_STATUS_FAILED;
-                }
-                retVal = NO_MORE_DATA;
-            }
-            else
-            {
-// look here if application hangs
-                while( retVal == E_BUFSPACE || retVal > 0 )
-                {
-                    retVal = _connection->readBuffer( _ioBuffer,
-                          IO_BUFFER_SIZE-1 );
-                };
-    
-                parsedValues = 0;
-                _commandStatus = HC12_CMD_STATUS_FAILED;
-                retVal = NO_MORE_DATA;
-            }
-        }
+/* 
+ ------------------------------------------------------------------------------
+ * static uint32_t hc12NowMs( void )
+ *
+ * returns a monotonic time stamp in milliseconds, wrapping around
+ ------------------------------------------------------------------------------
+*/
+static uint32_t hc12NowMs( void )
+{
+#if defined(ARDUINO)
+    return( millis() );
+#else // NOT defined(ARDUINO)
+    struct timespec ts;
 
-        _responseArgs += parsedValues;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
 
-        switch( _currentCommand )
-        {
-            case HC12_CMD_CODE_NULL:
-                // oops ...
-                break;
-            case HC12_CMD_CODE_TEST:
-                if( _responseArgs == HC12_ARGS_RSP_TEST )
-                {
-// _modulstatus = online/connected
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SET_DEFAULT:
-                if( _responseArgs == HC12_ARGS_RSP_SET_DEFAULT )
-                {
-                    reset();
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SLEEP:
-                if( _responseArgs == HC12_ARGS_RSP_SLEEP )
-                {
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_UPDATE:
-                if( _responseArgs == HC12_ARGS_RSP_UPDATE )
-                {
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SET_BAUD:
-                if( _responseArgs == HC12_ARGS_RSP_SET_BAUD )
-                {
-                    _moduleParam.serialParam.baud = baud;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SET_CHANNEL:
-                if( _responseArgs == HC12_ARGS_RSP_SET_CHANNEL )
-                {
-                    _moduleParam.comChannel = channel;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SET_TTMODE:
-                if( _responseArgs == HC12_ARGS_RSP_SET_TTMODE )
-                {
-                    _moduleParam.ttMode = ttMode;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SET_POWER:
-                if( _responseArgs == HC12_ARGS_RSP_SET_POWER )
-                {
-                    _moduleParam.power = power;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SET_PARAM:
-// not applicable!
-                if( _responseArgs == HC12_ARGS_RSP_SET_PARAM )
-                {
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_SET_SERIAL:
-                if( _responseArgs == HC12_ARGS_RSP_SET_SERIAL )
-                {
-                    _moduleParam.serialParam.databit = databits;
-                    _moduleParam.serialParam.parity = parity;
-                    _moduleParam.serialParam.stopbits = stopbits;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_GET_BAUD:
-                if( _responseArgs == HC12_ARGS_RSP_GET_BAUD )
-                {
-                    _moduleParam.serialParam.baud = baud;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_GET_CHANNEL:
-                if( _responseArgs == HC12_ARGS_RSP_GET_CHANNEL )
-                {
-                    _moduleParam.comChannel = channel;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_GET_TTMODE:
-                if( _responseArgs == HC12_ARGS_RSP_GET_TTMODE )
-                {
-                    _moduleParam.ttMode = ttMode;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_GET_POWER:
-                if( _responseArgs == HC12_ARGS_RSP_GET_POWER )
-                {
-                    _moduleParam.power = power;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_GET_PARAM:
-                if( _responseArgs == HC12_ARGS_RSP_GET_PARAM )
-                {
-                    _moduleParam.serialParam.baud = baud;
-                    _moduleParam.comChannel = channel;
-                    _moduleParam.ttMode = ttMode;
-                    _moduleParam.power = power;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_GET_SERIAL:
-                if( _responseArgs == HC12_ARGS_RSP_GET_SERIAL )
-                {
-                    _moduleParam.serialParam.databit = databits;
-                    _moduleParam.serialParam.parity = parity;
-                    _moduleParam.serialParam.stopbits = stopbits;
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            case HC12_CMD_CODE_GET_VERSION:
-                if( _responseArgs == HC12_ARGS_RSP_GET_VERSION )
-                {
-                    _moduleParam.hwInfo.major = major - '0';
-                    _moduleParam.hwInfo.minor = minor - '0';
-                    _commandStatus = HC12_CMD_STATUS_DONE;
-                    _currentCommand = HC12_CMD_CODE_NULL;
-                    retVal = NO_MORE_DATA;
-                }
-                break;
-            default:
-                _commandStatus = HC12_CMD_STATUS_UNKNOWN;
-//                retVal = NO_MORE_DATA;
-                retVal = TRY_MORE_DATA;
-                break;
-        }
+    return( (uint32_t) ts.tv_sec * 1000u + ts.tv_nsec / 1000000 );
+#endif // defined(ARDUINO)
+}
 
+/* 
+ ------------------------------------------------------------------------------
+ * static void hc12SleepMs( int ms )
+ ------------------------------------------------------------------------------
+*/
+static void hc12SleepMs( int ms )
+{
+    if( ms > 0 )
+    {
+#if defined(ARDUINO)
+        delay( ms );
+#else // NOT defined(ARDUINO)
+        usleep( ms * MILLISECONDS );
+#endif // defined(ARDUINO)
+    }
+}
 
-        if( retVal == NO_MORE_DATA && _commandStatus >= 0 )
-        {
-            _currentCommand = HC12_CMD_CODE_NULL;
-            retVal = NO_MORE_DATA;
-        }
-        else
-        {
-            if( _commandStatus < 0 )
-            {
-// look here if application hangs
-                while( retVal == E_BUFSPACE || retVal > 0 )
-                {
-                    retVal = _connection->readBuffer( _ioBuffer,
-                              IO_BUFFER_SIZE-1 );
-                };
+/* 
+ ------------------------------------------------------------------------------
+ * static int hc12AskSetPin( const char *pWhere )
+ *
+ * manual mode switch: ask the user to move the SET pin and wait for
+ * a line on stdin, ESC anywhere in it cancels
+ * returns HC12_ERR_OK, HC12_ERR_FAIL if cancelled or stdin is closed
+ ------------------------------------------------------------------------------
+*/
+static int hc12AskSetPin( const char *pWhere )
+{
+    int retVal = HC12_ERR_OK;
+    int key;
 
-                _currentCommand = HC12_CMD_CODE_NULL;
-                retVal = NO_MORE_DATA;
-            }
+    fprintf(stdout, "Please switch SET pin %s and press <ENTER> when done.\n",
+            pWhere);
+    fprintf(stdout, "Press <ESC> <ENTER> to cancel operation\n");
+    fflush(stdout);
+
+    while( (key = getchar()) != '\n' && key != EOF )
+    {
+        if( key == HC12_KEY_ESC )
+        {
+            retVal = HC12_ERR_FAIL;
         }
     }
-    else
+
+    if( key == EOF )
     {
-        retVal = E_NULL_CONNECTION;
+        retVal = HC12_ERR_FAIL;
     }
 
     return( retVal );
@@ -934,170 +619,197 @@ doLog(DEBUG_LEVEL_1);
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::sendRequest( void )
+ * int hc12Radio::readChunk( int timeoutMs )
  *
- * send the command buffer to the attached HC-12 board
- * returns the amount if characters written or an error code
+ * read whatever the board has sent into _ioBuffer, waiting up to
+ * timeoutMs for the first byte. With the reader thread running the
+ * bytes come from its ring.
+ * returns the amount of bytes read or an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::sendRequest( void )
+int hc12Radio::readChunk( int timeoutMs )
 {
     int retVal;
-    bool moreData;
-
-printf("command >%s", _ioBuffer);
+    int i;
 
-    if( _connection != NULL )
+#if defined(__linux__)
+    if( readerRunning() )
     {
-//        _connection->flushOutput();
-//        _connection->flushInput();
+        retVal = E_READ_TIMEOUT;
+        if( _rxSpsc.waitData( timeoutMs ) )
+        {
+            retVal = _rxSpsc.read( _ioBuffer, IO_BUFFER_SIZE-1, &_rxStamp );
+        }
+    }
+    else
+#endif // defined(__linux__)
+    {
+        retVal = _pTransport->read( _ioBuffer, IO_BUFFER_SIZE-1, timeoutMs );
+    }
 
-        retVal = _connection->ser_write( _ioBuffer,
-                                          strlen(_ioBuffer) );
-        if( retVal > 0 )
+    // the line end of the previous reply may trickle in late, that
+    // is not the start of a new one
+    for( i = 0; i < retVal && !_rspStarted; i++ )
+    {
+        if( _ioBuffer[i] != '\r' && _ioBuffer[i] != '\n' )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
-            moreData = true;
-            while(moreData)
-            {
-                retVal = getResponse();
+            _tFirst = hc12Stats::now();
+            _rspStarted = true;
+        }
+    }
 
-sprintf(hc12LogBuffer, "RESPONSE: %s\n", _ioBuffer);
-doLog(DEBUG_LEVEL_1);
+    return( retVal );
+}
 
-                if(retVal == E_READ_TIMEOUT )
-                {
-                    moreData = false;
-                }
-                else
-                {
-                    if(retVal != E_BUFSPACE )
-                    {
-                        switch( retVal = parseResponse() )
-                        {
-                            case NO_MORE_DATA:
-                                moreData = false;
-                                break;
-                            case TRY_MORE_DATA:
-                                break;
-                        }
-                    }
-                    else
-                    {
-                        moreData = false;
-                    }
-                }
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::drainInput( void )
+ *
+ * throw away what the board sends until the line goes idle. A talking
+ * peer may keep the line busy forever, so the drain ends after
+ * _drainMaxMs in any case. Once _drainMaxBytes are gone it stops with
+ * the chunk holding the next line feed, the next command starts on a
+ * fresh line then.
+ * returns the amount of bytes dropped
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::drainInput( void )
+{
+    int retVal;
+    uint32_t start = hc12NowMs();
+    uint32_t tStart = hc12Stats::now();
+    uint32_t elapsed;
+    int wait;
+    int received;
+    int i;
+    bool cut = false;
+    bool done = false;
+
+    _rspStarted = true;
+
+    // the rest of the bad reply
+    retVal = _ioLen - _ioPos;
+    _ioPos = _ioLen = 0;
+
+    while( !done )
+    {
+        if( (elapsed = hc12NowMs() - start) >= (uint32_t) _drainMaxMs )
+        {
+            cut = true;
+            done = true;
+        }
+        else
+        {
+            wait = idleGap();
+            if( (uint32_t) wait > _drainMaxMs - elapsed )
+            {
+                wait = _drainMaxMs - elapsed;
             }
 
-            if( (retVal = _commandStatus) == HC12_CMD_STATUS_DONE )
+            if( (received = readChunk( wait )) <= 0 )
             {
-sprintf(hc12LogBuffer, "Command complete ...\n");
-doLog(DEBUG_LEVEL_1);
-                retVal = E_OK;
+                // a timeout cut short by the deadline is caught above
+                done = (wait == idleGap());
+            }
+            else if( retVal + received <= _drainMaxBytes )
+            {
+                retVal += received;
             }
             else
             {
-sprintf(hc12LogBuffer, "Command terminates with error %d\n", retVal);
-doLog(DEBUG_LEVEL_1);
+                // over budget, stop with the next line boundary
+                i = retVal < _drainMaxBytes ? _drainMaxBytes - retVal : 0;
+                while( i < received && _ioBuffer[i] != '\n' )
+                {
+                    i++;
+                }
+
+                retVal += received;
+                if( i < received )
+                {
+                    cut = true;
+                    done = true;
+                }
             }
         }
     }
-    else
-    {
-        retVal = E_NULL_CONNECTION;
-    }
+
+    _parser.reset();
+
+    _droppedBytes += retVal;
+    _stats.drain( retVal, cut, hc12Stats::now() - tStart );
+    HC12_LOG_INFO( HC12_EV_DRAIN, this, retVal, cut );
 
     return( retVal );
 }
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::connect( void )
+ * void hc12Radio::recordCommand( int command, int readResult )
  *
- * connect to an attached smart-TFT using given parameters
- * return E_OK on succes, otherwise an error code
+ * account the command just finished in the statistics, readResult is
+ * the last result of getResponse()
  ------------------------------------------------------------------------------
 */
-int hc12Radio::connect( struct _hc12_serial_param *pParam )
+void hc12Radio::recordCommand( int command, int readResult )
 {
-    int retVal;
+    int result;
+    uint32_t first = 0;
 
-    if( _connection != NULL )
+    if( _commandStatus == HC12_CMD_STATUS_DONE )
     {
-        if( pParam != NULL )
-        {
-#if defined(__linux__)
-            _moduleParam.serialParam.device = strdup( pParam->device );
-#else // NOT defined(__linux__)
-    #if defined(ARDUINO)
-            _moduleParam.serialParam.pHPort = pParam->pHPort;
-            _moduleParam.serialParam.pSPort = pParam->pSPort;
-            _moduleParam.serialParam.isHWPort = pParam->isHWPort;
-    #endif // defined(ARDUINO)
-#endif // defined(__linux__)
-            _moduleParam.serialParam.baud = pParam->baud;
-            _moduleParam.serialParam.databit = pParam->databit;
-            _moduleParam.serialParam.parity = pParam->parity;
-            _moduleParam.serialParam.stopbits = pParam->stopbits;
-#if defined(__linux__)
-            _moduleParam.serialParam.handshake = pParam->handshake;
-#endif // defined(__linux__)
-        }
-
-#if defined(__linux__)
-        retVal = _connection->ser_open( _moduleParam.serialParam.device,
-                                        _moduleParam.serialParam.baud,
-                                        _moduleParam.serialParam.databit,
-                                        _moduleParam.serialParam.parity,
-                                        _moduleParam.serialParam.stopbits,
-                                        _moduleParam.serialParam.handshake );
-#else // NOT defined(__linux__)
-    #if defined(ARDUINO)
-        if( _moduleParam.serialParam.isHWPort )
-        {
-            retVal = _connection->ser_open( _moduleParam.serialParam.pHPort,
-                                            _moduleParam.serialParam.baud,
-                                            _moduleParam.serialParam.databit,
-                                            _moduleParam.serialParam.parity,
-                                            _moduleParam.serialParam.stopbits );
-        }
-        else
-        {
-            retVal = _connection->ser_open( _moduleParam.serialParam.pSPort,
-                                            _moduleParam.serialParam.baud );
-        }
-    #endif // defined(ARDUINO)
-#endif // defined(__linux__)
+        result = HC12_STAT_OK;
+    }
+    else if( _commandStatus == HC12_CMD_RESPONSE_UNKNOWN )
+    {
+        result = HC12_STAT_UNKNOWN;
+    }
+    else if( readResult == E_READ_TIMEOUT )
+    {
+        result = HC12_STAT_TIMEOUT;
     }
     else
     {
-        retVal = E_NULL_CONNECTION;
+        result = HC12_STAT_FAILED;
     }
 
-    return( retVal );
+    if( _rspStarted )
+    {
+        // 0 means no byte at all
+        if( (first = _tFirst - _tWrite) == 0 )
+        {
+            first = 1;
+        }
+    }
+
+    _stats.command( command, result, first, hc12Stats::now() - _tWrite );
 }
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::disconnect( void )
+ * int hc12Radio::getStats( struct _hc12_stats *pStats )
  *
- * close connection to attached smart-TFT
- * return E_OK on succes, otherwise an error code
+ * copy latency histograms and counters gathered since the last
+ * resetStats()
+ * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::disconnect( void )
+int hc12Radio::getStats( struct _hc12_stats *pStats )
 {
-    int retVal;
-
-
+    int retVal = HC12_ERR_OK;
 
-    if( _connection != NULL )
+    if( pStats == NULL )
     {
-        retVal = _connection->ser_close( );
+        retVal = HC12_ERR_NULLP;
     }
     else
     {
-        retVal = E_NULL_CONNECTION;
+#if defined(HC12_WITH_STATS)
+        _stats.snapshot( pStats );
+#else // NOT defined(HC12_WITH_STATS)
+        memset( pStats, '\0', sizeof(struct _hc12_stats) );
+        retVal = HC12_ERR_FAIL;
+#endif // defined(HC12_WITH_STATS)
     }
 
     return( retVal );
@@ -1105,36 +817,64 @@ int hc12Radio::disconnect( void )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::enterCommandMode( void )
- *
- * If using a PC or MCU to dynamically modify the module parameters, after 
- * pulling  pin 5 (“SET”)  low wait at least 40ms before sending any AT 
- * commands to the module.
- * 
- * return HC12_ERR_OK on succes, otherwise an error code
+ * void hc12Radio::resetStats( void )
  ------------------------------------------------------------------------------
 */
-int hc12Radio::enterCommandMode( void )
+void hc12Radio::resetStats( void )
 {
-    int retVal = HC12_ERR_OK;
+    _stats.reset();
+    _droppedBytes = 0;
+}
 
-printf("enter Command mode\n");
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::getResponse( void )
+ *
+ * feed the response of the attached board into the parser until a
+ * complete line has been seen. Data behind that line stays in _ioBuffer
+ * for the next call.
+ * returns the amount if characters consumed or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::getResponse( void )
+{
+    int retVal = 0;
+    int received;
+    int consumed = 0;
 
-    if( (retVal = _status) == HC12_ERR_OK )
+    if( _pTransport != NULL )
     {
-        if( _moduleParam.setPin != HC12_NULLPIN )
+        while( retVal == 0 )
         {
-#if defined(RASPBERRY)
-            gpioWrite(_moduleParam.setPin, HC12_SETPIN_CMD_MODE);
-            usleep(60 * MILLISECONDS);
-#else // NOT defined(RASPBERRY)
-fprintf(stdout, "Please switch SET pin to GND and press <ENTER> when done.\n");
-fprintf(stdout, "Press <ESC> tp cancel operation\n");
-getchar();
-#endif // defined(RASPBERRY)
-        }
+            if( _ioPos >= _ioLen )
+            {
+                _ioPos = _ioLen = 0;
+                received = readChunk( _rspStarted ? idleGap() : _rspTimeout );
+
+                if( received > 0 )
+                {
+                    _ioLen = received;
+                }
+                else
+                {
+                    retVal = received < 0 ? received : E_READ_TIMEOUT;
+                }
+            }
 
-        _currOpMode = HC12_OP_CMD_MODE;
+            while( retVal == 0 && _ioPos < _ioLen )
+            {
+                consumed++;
+                if( _parser.feed( _ioBuffer[_ioPos++] ) == HC12_PARSE_LINE )
+                {
+                    _responseLines++;
+                    retVal = consumed;
+                }
+            }
+        }
+    }
+    else
+    {
+        retVal = E_NULL_CONNECTION;
     }
 
     return( retVal );
@@ -1142,34 +882,194 @@ getchar();
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::leaveCommandMode( void )
+ * int hc12Radio::parseResponse( void )
  *
- * After releasing pin 5 (“SET”), wait at least 80ms for the module to 
- * return to serial port pass-through mode.
- * 
- * return HC12_ERR_OKE_OK on succes, otherwise an error code
+ * evaluate the response line the parser has completed
+ * returns parsing result
  ------------------------------------------------------------------------------
 */
-int hc12Radio::leaveCommandMode( void )
+#define NO_MORE_DATA    22
+#define TRY_MORE_DATA   33
+
+int hc12Radio::parseResponse( void )
 {
-    int retVal = HC12_ERR_OK;
+    int retVal = NO_MORE_DATA;
+    const struct _hc12_response *pRsp;
+    const struct _hc12_cmd_desc *pDesc;
+    int parsedValues = 0;
 
-printf("leave Command mode\n");
-    if( (retVal = _status) == HC12_ERR_OK )
+    if( _pTransport != NULL )
     {
-        if( _moduleParam.setPin != HC12_NULLPIN )
+        pRsp = _parser.response();
+        HC12_LOG_DEBUG( HC12_EV_RSP_LINE, this, _currentCommand, pRsp->type );
+
+        switch( pRsp->type )
         {
-#if defined(RASPBERRY)
-            gpioWrite(_moduleParam.setPin, HC12_SETPIN_TT_MODE);
-            usleep(100 * MILLISECONDS);
-#else // NOT defined(RASPBERRY)
-fprintf(stdout, "Please switch SET pin back to Vcc and press <ENTER> when done.\n");
-fprintf(stdout, "Press <ESC> tp cancel operation\n");
-getchar();
-#endif // defined(RASPBERRY)
+            case HC12_RSP_TYPE_OK:
+                // result of test command
+                _commandStatus = HC12_CMD_STATUS_DONE;
+                _currentCommand = HC12_CMD_CODE_NULL;
+                break;
+            case HC12_RSP_TYPE_BAUD:
+                _rspValues.baud = pRsp->value;
+                parsedValues = 1;
+                _rspValues.seen |= HC12_PARAM_BIT(HC12_PARAM_FIELD_BAUD);
+                break;
+            case HC12_RSP_TYPE_CHANNEL:
+                _rspValues.channel = pRsp->value;
+                parsedValues = 1;
+                _rspValues.seen |= HC12_PARAM_BIT(HC12_PARAM_FIELD_CHANNEL);
+                break;
+            case HC12_RSP_TYPE_POWER_DBM:
+                _rspValues.powerDB = pRsp->value;
+                _rspValues.power = powerDB2Mode(_rspValues.powerDB);
+                parsedValues = 1;
+                _rspValues.seen |= HC12_PARAM_BIT(HC12_PARAM_FIELD_POWER);
+                break;
+            case HC12_RSP_TYPE_TTMODE:
+                _rspValues.ttMode = pRsp->value;
+                parsedValues = 1;
+                _rspValues.seen |= HC12_PARAM_BIT(HC12_PARAM_FIELD_TTMODE);
+                break;
+            case HC12_RSP_TYPE_DEFAULT:
+                parsedValues = 0;
+                break;
+            case HC12_RSP_TYPE_SLEEP:
+                parsedValues = 0;
+                break;
+            case HC12_RSP_TYPE_POWER:
+                _rspValues.power = pRsp->value;
+                _rspValues.powerDB = powerMode2DB(_rspValues.power);
+                parsedValues = 1;
+                break;
+            case HC12_RSP_TYPE_SERIAL:
+                _rspValues.databits = pRsp->databits;
+                _rspValues.parity = pRsp->parity;
+                _rspValues.stopbits = pRsp->stopbits;
+                parsedValues = 3;
+                break;
+            case HC12_RSP_TYPE_VERSION:
+                _rspValues.major = pRsp->major;
+                _rspValues.minor = pRsp->minor;
+                parsedValues = 2;
+                _commandStatus = HC12_CMD_STATUS_DONE;
+                break;
+            case HC12_RSP_TYPE_ERROR:
+                HC12_LOG_INFO( HC12_EV_RSP_ERROR, this, _currentCommand, 0 );
+                _commandStatus = HC12_CMD_STATUS_FAILED;
+                break;
+            case HC12_RSP_TYPE_UNKNOWN:
+            default:
+                HC12_LOG_INFO( HC12_EV_RSP_UNKNOWN, this, _currentCommand, 0 );
+                _commandStatus = HC12_CMD_RESPONSE_UNKNOWN;
+                break;
+        }
+
+        _responseArgs += parsedValues;
+
+        if( _currentCommand == HC12_CMD_CODE_NULL )
+        {
+            // oops ...
+        }
+        else if( (pDesc = hc12CommandDesc( _currentCommand )) == NULL )
+        {
+            _commandStatus = HC12_CMD_STATUS_UNKNOWN;
+            retVal = TRY_MORE_DATA;
+        }
+        else if( _commandStatus >= 0 &&
+                 (pDesc->done == HC12_DONE_SEEN_RX ?
+                  // one line per value, order is up to the module
+                  (_rspValues.seen & HC12_PARAM_SEEN_RX) ==
+                                                      HC12_PARAM_SEEN_RX :
+                  // an ERROR has no args either, it is no completion
+                  _responseArgs == pDesc->rspArgs) )
+        {
+            // AT+DEFAULT: setDefault() resets the cache on OK+DEFAULT
+            switch( _currentCommand )
+            {
+                case HC12_CMD_CODE_SET_BAUD:
+                case HC12_CMD_CODE_GET_BAUD:
+                    _moduleParam.serialParam.baud = _rspValues.baud;
+                    break;
+                case HC12_CMD_CODE_SET_CHANNEL:
+                case HC12_CMD_CODE_GET_CHANNEL:
+                    _moduleParam.comChannel = _rspValues.channel;
+                    break;
+                case HC12_CMD_CODE_SET_TTMODE:
+                case HC12_CMD_CODE_GET_TTMODE:
+                    _moduleParam.ttMode = _rspValues.ttMode;
+                    break;
+                case HC12_CMD_CODE_SET_POWER:
+                case HC12_CMD_CODE_GET_POWER:
+                    _moduleParam.power = _rspValues.power;
+                    break;
+                case HC12_CMD_CODE_SET_SERIAL:
+                case HC12_CMD_CODE_GET_SERIAL:
+                    _moduleParam.serialParam.databit = _rspValues.databits;
+                    _moduleParam.serialParam.parity = _rspValues.parity;
+                    _moduleParam.serialParam.stopbits = _rspValues.stopbits;
+                    break;
+                case HC12_CMD_CODE_GET_PARAM:
+                    // take the values over only if all of them were seen
+                    _moduleParam.serialParam.baud = _rspValues.baud;
+                    _moduleParam.comChannel = _rspValues.channel;
+                    _moduleParam.ttMode = _rspValues.ttMode;
+                    _moduleParam.power = _rspValues.power;
+                    _paramState[HC12_PARAM_FIELD_BAUD] = HC12_PARAM_CONFIRMED;
+                    _paramState[HC12_PARAM_FIELD_CHANNEL] = HC12_PARAM_CONFIRMED;
+                    _paramState[HC12_PARAM_FIELD_TTMODE] = HC12_PARAM_CONFIRMED;
+                    _paramState[HC12_PARAM_FIELD_POWER] = HC12_PARAM_CONFIRMED;
+                    break;
+                case HC12_CMD_CODE_GET_VERSION:
+                    _moduleParam.hwInfo.major = _rspValues.major;
+                    _moduleParam.hwInfo.minor = _rspValues.minor;
+                    break;
+            }
+
+            if( pDesc->field != HC12_PARAM_FIELD_NONE )
+            {
+                _paramState[pDesc->field] = HC12_PARAM_CONFIRMED;
+            }
+
+            _commandStatus = HC12_CMD_STATUS_DONE;
+            _currentCommand = HC12_CMD_CODE_NULL;
+            retVal = NO_MORE_DATA;
+        }
+        else if( pDesc->done == HC12_DONE_SEEN_RX )
+        {
+            retVal = TRY_MORE_DATA;
+        }
+
+
+        if( retVal == NO_MORE_DATA && _commandStatus >= 0 )
+        {
+            _currentCommand = HC12_CMD_CODE_NULL;
+            retVal = NO_MORE_DATA;
         }
+        else
+        {
+            if( _commandStatus < 0 )
+            {
+                // a non-blocking caller must not wait here, the rest
+                // of the reply is dropped as it arrives. Behind a
+                // pipelined command the replies to the next ones wait.
+                if( _nonBlocking || _pipelined )
+                {
+                    _parser.reset();
+                }
+                else
+                {
+                    drainInput();
+                }
 
-        _currOpMode = HC12_OP_TT_MODE;
+                _currentCommand = HC12_CMD_CODE_NULL;
+                retVal = NO_MORE_DATA;
+            }
+        }
+    }
+    else
+    {
+        retVal = E_NULL_CONNECTION;
     }
 
     return( retVal );
@@ -1177,204 +1077,1829 @@ getchar();
 
 /* 
  ------------------------------------------------------------------------------
- * void hc12Radio::init( void )
- *
- * initialize internal structs
+ * int hc12Radio::sendRequest( void )
  *
- * return nothing
+ * send the command buffer to the attached HC-12 board
+ * returns the amount if characters written or an error code
  ------------------------------------------------------------------------------
 */
-void hc12Radio::init( void )
+int hc12Radio::sendRequest( void )
 {
+    int retVal;
+    bool moreData;
+    int expected;
+    int command = _currentCommand;
+    int readResult = 0;
+    int len;
 
-#if defined(RASPBERRY)
-    if( _moduleParam.setPin != HC12_NULLPIN ||
-        _moduleParam.powerPin != HC12_NULLPIN )
+    if( _pTransport != NULL )
     {
-        if (gpioInitialise() < 0)
-        {
-            _status = HC12_ERR_INIT_PIGPIO;
-sprintf(hc12LogBuffer, "ERR init pigpio\n");
-doLog(DEBUG_LEVEL_1);
-        }
-        else
+//        _connection->flushOutput();
+//        _connection->flushInput();
+
+        // whatever is left from a previous command is stale now
+        _ioPos = _ioLen = 0;
+        _parser.reset();
+        memset( &_rspValues, '\0', sizeof(_rspValues) );
+        _responseLines = 0;
+        _rspStarted = false;
+        expected = expectedLines( _currentCommand );
+        len = strlen( _ioBuffer );
+        HC12_LOG_DEBUG( HC12_EV_CMD_SEND, this, command, len );
+
+        _tWrite = hc12Stats::now();
+        retVal = _pTransport->write( _ioBuffer, len );
+        if( retVal > 0 )
         {
-            _status = HC12_ERR_OK;
+            _commandStatus = HC12_CMD_STATUS_ACTIVE;
 
-            if( _moduleParam.setPin != HC12_NULLPIN )
+            if( expected == 0 )
             {
-                gpioSetMode(_moduleParam.setPin, PI_OUTPUT);
-                gpioWrite(_moduleParam.setPin, HC12_SETPIN_TT_MODE);
+                // no reply at all
+                _commandStatus = HC12_CMD_STATUS_DONE;
+                _currentCommand = HC12_CMD_CODE_NULL;
             }
 
-            if( _moduleParam.powerPin != HC12_NULLPIN )
+            moreData = expected > 0;
+            while(moreData)
             {
-                gpioSetMode(_moduleParam.powerPin, PI_OUTPUT);
-                gpioWrite(_moduleParam.powerPin, HC12_POWERPIN_ON);
+                retVal = readResult = getResponse();
+
+                if( retVal < 0 )
+                {
+                    moreData = false;
+                }
+                else
+                {
+                    switch( retVal = parseResponse() )
+                    {
+                        case NO_MORE_DATA:
+                            moreData = false;
+                            break;
+                        case TRY_MORE_DATA:
+                            // all lines are in, waiting is useless
+                            if( _responseLines >= expected )
+                            {
+                                moreData = false;
+                            }
+                            break;
+                    }
+                }
             }
-        }
-    }
-#endif // defined(RASPBERRY)
 
-    _moduleParam.comChannel = HC12_DEFAULT_CHANNEL;
-    _moduleParam.ttMode = HC12_DEFAULT_TTMODE;
-    _moduleParam.power = HC12_DEFAULT_POWER;
- 
-#if defined(__linux__)
-    _moduleParam.serialParam.device = strdup( (char*) HC12_DEFAULT_DEVICE );
+            recordCommand( command, readResult );
 
-    _moduleParam.serialParam.dev_fd = -1;
+            if( (retVal = _commandStatus) == HC12_CMD_STATUS_DONE )
+            {
+                retVal = E_OK;
+                HC12_LOG_DEBUG( HC12_EV_CMD_DONE, this, command, retVal );
+            }
+            else
+            {
+                HC12_LOG_INFO( HC12_EV_CMD_FAILED, this, command, retVal );
+            }
+        }
+    }
+    else
+    {
+        retVal = E_NULL_CONNECTION;
+    }
 
-    memset( &_moduleParam.serialParam.oldtio, '\0', sizeof(struct termios) );
-    memset( &_moduleParam.serialParam.rawtio, '\0', sizeof(struct termios) );
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::startRequest( int command, int arg )
+ *
+ * non-blocking counterpart of the command methods: format command
+ * (one of the HC12_CMD_CODE_* codes) with its argument, if any, and
+ * write it. The caller hands the bytes arriving afterwards to
+ * feedResponse() and calls expireRequest() if nothing arrived within
+ * requestTimeout() ms. AT+U is not supported, neither are SET_PARAM and
+ * GET_SERIAL, both stand-ins for AT+DEFAULT.
+ *
+ * return HC12_ERR_OK if the command is on its way, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::startRequest( int command, int arg )
+{
+    int retVal = HC12_ERR_OK;
+    int len;
+
+    if( _pTransport == NULL )
+    {
+        return( E_NULL_CONNECTION );
+    }
+
+    if( _nonBlocking || _currOpMode != HC12_OP_CMD_MODE )
+    {
+        return( HC12_ERR_OP_MODE );
+    }
+
+    switch( command )
+    {
+        case HC12_CMD_CODE_SET_BAUD:
+            len = isValidBaud( arg ) ? HC12_ERR_OK : HC12_ERR_BAUD;
+            break;
+        case HC12_CMD_CODE_SET_CHANNEL:
+            len = isValidChannel( arg ) ? HC12_ERR_OK : HC12_ERR_CHANNEL;
+            break;
+        case HC12_CMD_CODE_SET_TTMODE:
+            len = isValidTTMode( arg ) ? HC12_ERR_OK : HC12_ERR_TTMODE;
+            break;
+        case HC12_CMD_CODE_SET_POWER:
+            len = isValidPower( arg ) ? HC12_ERR_OK : HC12_ERR_POWER;
+            break;
+        case HC12_CMD_CODE_SET_SERIAL:
+        case HC12_CMD_CODE_SET_PARAM:
+        case HC12_CMD_CODE_GET_SERIAL:
+            len = HC12_ERR_ARGS;
+            break;
+        default:
+            len = HC12_ERR_OK;
+            break;
+    }
+
+    if( len == HC12_ERR_OK &&
+        (len = hc12FormatCommand( command, arg, _ioBuffer )) < 0 )
+    {
+        len = HC12_ERR_ARGS;
+    }
+
+    if( (retVal = len) > 0 )
+    {
+        _currentCommand = command;
+        _commandStatus = HC12_CMD_STATUS_REQUEST;
+        _responseArgs = 0;
+        _requestCommand = command;
+        _requestArg = arg;
+
+        _ioPos = _ioLen = 0;
+        _parser.reset();
+        memset( &_rspValues, '\0', sizeof(_rspValues) );
+        _responseLines = 0;
+        _rspStarted = false;
+        _requestLines = expectedLines( command );
+        HC12_LOG_DEBUG( HC12_EV_CMD_SEND, this, command, len );
+
+        _tWrite = hc12Stats::now();
+        if( _pTransport->write( _ioBuffer, len ) == len )
+        {
+            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            _nonBlocking = true;
+            retVal = HC12_ERR_OK;
+
+            if( _requestLines == 0 )
+            {
+                // no reply at all
+                _commandStatus = HC12_CMD_STATUS_DONE;
+            }
+        }
+        else
+        {
+            _commandStatus = HC12_CMD_STATUS_FAILED;
+            _currentCommand = HC12_CMD_CODE_NULL;
+            retVal = HC12_ERR_FAIL;
+        }
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::feedResponse( const char *pData, int len )
+ *
+ * hand bytes received while a startRequest() command is pending to the
+ * parser. A command without reply completes on the first call, even
+ * with len 0.
+ *
+ * return HC12_CMD_STATUS_ACTIVE while the reply is incomplete, otherwise
+ *        the result of finishRequest()
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::feedResponse( const char *pData, int len )
+{
+    int retVal = HC12_CMD_STATUS_ACTIVE;
+    bool done = _commandStatus != HC12_CMD_STATUS_ACTIVE;
+    int i;
+
+    for( i = 0; i < len && !done; i++ )
+    {
+        if( !_rspStarted && pData[i] != '\r' && pData[i] != '\n' )
+        {
+            _tFirst = hc12Stats::now();
+            _rspStarted = true;
+        }
+
+        if( _parser.feed( pData[i] ) == HC12_PARSE_LINE )
+        {
+            _responseLines++;
+            // all lines are in, waiting is useless
+            done = parseResponse() == NO_MORE_DATA ||
+                   _responseLines >= _requestLines;
+        }
+    }
+
+    if( done && _nonBlocking )
+    {
+        retVal = finishRequest( 1 );
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::expireRequest( void )
+ *
+ * the reply of the pending command did not complete in time
+ *
+ * return the result of finishRequest()
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::expireRequest( void )
+{
+    int retVal = HC12_ERR_FAIL;
+
+    if( _nonBlocking )
+    {
+        retVal = finishRequest( E_READ_TIMEOUT );
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::finishRequest( int readResult )
+ *
+ * conclude the pending command the way the blocking methods do: check
+ * the reply type and, for set commands, the echoed value. The parsed
+ * values are in the parameter cache resp. lastResponse() afterwards.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::finishRequest( int readResult )
+{
+    int retVal = HC12_ERR_OK;
+    const struct _hc12_response *pRsp = _parser.response();
+    const struct _hc12_cmd_desc *pDesc;
+    int command = _requestCommand;
+    int rspType = HC12_RSP_TYPE_UNKNOWN;
+    int field = HC12_PARAM_FIELD_NONE;
+
+    recordCommand( command, readResult );
+
+    if( (pDesc = hc12CommandDesc( command )) != NULL )
+    {
+        rspType = pDesc->rspType;
+        if( pDesc->echo )
+        {
+            field = pDesc->field;
+        }
+    }
+
+    if( _commandStatus != HC12_CMD_STATUS_DONE )
+    {
+        retVal = readResult == E_READ_TIMEOUT ? 
+                                 HC12_ERR_TIMEOUT : HC12_ERR_RESPONSE;
+    }
+    else if( _requestLines > 0 && rspType != HC12_RSP_TYPE_UNKNOWN &&
+             pRsp->type != rspType )
+    {
+        retVal = HC12_ERR_RESPONSE;
+    }
+    else if( field >= 0 && pRsp->value != _requestArg )
+    {
+        retVal = HC12_ERR_FAIL;
+    }
+
+    if( retVal != HC12_ERR_OK )
+    {
+        HC12_LOG_INFO( HC12_EV_CMD_FAILED, this, command, retVal );
+        _commandStatus = HC12_CMD_STATUS_FAILED;
+        if( field >= 0 )
+        {
+            _paramState[field] = HC12_PARAM_UNKNOWN;
+        }
+    }
+    else
+    {
+        HC12_LOG_DEBUG( HC12_EV_CMD_DONE, this, command, retVal );
+    }
+
+    _currentCommand = HC12_CMD_CODE_NULL;
+    _nonBlocking = false;
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::connect( void )
+ *
+ * connect to an attached smart-TFT using given parameters
+ * return E_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::connect( struct _hc12_serial_param *pParam )
+{
+    int retVal;
+
+    if( _pTransport != NULL )
+    {
+        if( pParam != NULL )
+        {
+#if defined(__linux__)
+            free( _moduleParam.serialParam.device );
+            _moduleParam.serialParam.device = strdup( pParam->device );
 #else // NOT defined(__linux__)
     #if defined(ARDUINO)
-    _moduleParam.serialParam.pHPort = NULL;
-    _moduleParam.serialParam.pSPort = NULL;
-    _moduleParam.serialParam.isHWPort = false;
+            _moduleParam.serialParam.pHPort = pParam->pHPort;
+            _moduleParam.serialParam.pSPort = pParam->pSPort;
+            _moduleParam.serialParam.isHWPort = pParam->isHWPort;
     #endif // defined(ARDUINO)
 #endif // defined(__linux__)
+            _moduleParam.serialParam.baud = pParam->baud;
+            _moduleParam.serialParam.databit = pParam->databit;
+            _moduleParam.serialParam.parity = pParam->parity;
+            _moduleParam.serialParam.stopbits = pParam->stopbits;
+#if defined(__linux__)
+            _moduleParam.serialParam.handshake = pParam->handshake;
+#endif // defined(__linux__)
+            // the module has to use the same settings to be reachable
+            _paramState[HC12_PARAM_FIELD_BAUD] = HC12_PARAM_KNOWN;
+            _paramState[HC12_PARAM_FIELD_SERIAL] = HC12_PARAM_KNOWN;
+        }
 
-    _moduleParam.serialParam.baud = HC12_DEFAULT_BAUD;
-    _moduleParam.serialParam.databit = HC12_DEFAULT_DATABIT;
-    _moduleParam.serialParam.parity = HC12_DEFAULT_PARITY;
-    _moduleParam.serialParam.stopbits = HC12_DEFAULT_STOPBITS;
-//    _moduleParam.serialParam.handshake = HC12_DEFAULT_HANDSHAKE;
+        // power on the module before talking to it, a failure shows
+        // up again with the first mode switch
+        requestPins();
 
-    _moduleParam.hwInfo.major = HC12_DEFAULT_V_MAJOR;
-    _moduleParam.hwInfo.minor = HC12_DEFAULT_V_MINOR;
-    _moduleParam.hwInfo.patch  = HC12_DEFAULT_V_PATCH;
+        retVal = _pTransport->open( &_moduleParam.serialParam );
 
-    _interfaceType = HC12_DEFAULT_INTERFACE;
-    _currOpMode = HC12_DEFAULT_OPMODE;
+        if( retVal == E_OK )
+        {
+            _linkBaud = _moduleParam.serialParam.baud;
+            configurePacer();
+#if defined(__linux__)
+            _moduleParam.serialParam.dev_fd = _pTransport->fd();
+#endif // defined(__linux__)
+        }
+    }
+    else
+    {
+        retVal = E_NULL_CONNECTION;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::disconnect( void )
+ *
+ * close connection to attached smart-TFT
+ * return E_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::disconnect( void )
+{
+    int retVal;
+
+
+
+    if( _pTransport != NULL )
+    {
+#if defined(__linux__)
+        stopReader();
+#endif // defined(__linux__)
+        retVal = _pTransport->close();
+#if defined(__linux__)
+        _moduleParam.serialParam.dev_fd = -1;
+#endif // defined(__linux__)
+    }
+    else
+    {
+        retVal = E_NULL_CONNECTION;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::enterCommandMode( void )
+ *
+ * If using a PC or MCU to dynamically modify the module parameters, after 
+ * pulling  pin 5 (“SET”)  low wait at least 40ms before sending any AT 
+ * commands to the module.
+ *
+ * The datasheet figure is an upper bound. With the fast mode switch
+ * (the default) the module is probed with AT instead, see
+ * probeCommandMode(). Without an answer SET is released again and the
+ * radio stays in the mode it was in.
+ * A SET pin without GPIO backend is refused with HC12_ERR_GPIO unless
+ * the manual mode switch is on, see setManualModeSwitch(). Then the
+ * user is asked to move the pin.
+ * 
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::enterCommandMode( void )
+{
+    int retVal;
+    int settle;
+    int prevMode = _currOpMode;
+
+    if( (retVal = settle = beginModeSwitch( HC12_OP_CMD_MODE )) >= 0 )
+    {
+        retVal = HC12_ERR_OK;
+
+        if( _moduleParam.setPin != HC12_NULLPIN )
+        {
+            if( !pinAutomated() )
+            {
+                retVal = hc12AskSetPin( "to GND" );
+            }
+            else if( _fastModeSwitch )
+            {
+                retVal = probeCommandMode();
+            }
+            else
+            {
+                hc12SleepMs( settle );
+            }
+        }
+
+        if( retVal == HC12_ERR_OK )
+        {
+            endModeSwitch( HC12_OP_CMD_MODE );
+        }
+        else
+        {
+            // the module did not answer, back to where it was
+            _currOpMode = prevMode;
+            if( writePin( _moduleParam.setPin,
+                          HC12_SETPIN_TT_MODE ) == HC12_ERR_OK )
+            {
+                hc12SleepMs( HC12_SETTLE_TT_MS );
+            }
+        }
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::leaveCommandMode( void )
+ *
+ * After releasing pin 5 (“SET”), wait at least 80ms for the module to 
+ * return to serial port pass-through mode.
+ *
+ * There is no probing here, an AT the module takes as data is sent.
+ * Without GPIO backend for the SET pin see enterCommandMode().
+ * 
+ * return HC12_ERR_OKE_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::leaveCommandMode( void )
+{
+    int retVal;
+    int settle;
+
+    if( (retVal = settle = beginModeSwitch( HC12_OP_TT_MODE )) >= 0 )
+    {
+        retVal = HC12_ERR_OK;
+
+        if( _moduleParam.setPin != HC12_NULLPIN )
+        {
+            if( !pinAutomated() )
+            {
+                retVal = hc12AskSetPin( "back to Vcc" );
+            }
+            else
+            {
+                hc12SleepMs( settle );
+            }
+        }
+
+        if( retVal == HC12_ERR_OK )
+        {
+            retVal = endModeSwitch( HC12_OP_TT_MODE );
+        }
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::relinkBaud( void )
+ *
+ * bring the line to the baud rate the module got in command mode, the
+ * module takes it when it leaves command mode. A transport that opens
+ * the line again may change deviceFd(), the background reader follows,
+ * a reactor the radio is added to reports the line as lost.
+ *
+ * return HC12_ERR_OK on succes, HC12_ERR_FAIL if the line is lost
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::relinkBaud( void )
+{
+    int retVal = HC12_ERR_OK;
+#if defined(__linux__)
+    bool reader = readerRunning();
+#endif // defined(__linux__)
+
+    if( _pTransport != NULL &&
+        _paramState[HC12_PARAM_FIELD_BAUD] != HC12_PARAM_UNKNOWN &&
+        _moduleParam.serialParam.baud != _linkBaud )
+    {
+#if defined(__linux__)
+        stopReader();
+#endif // defined(__linux__)
+
+        if( _pTransport->setBaud( &_moduleParam.serialParam ) == E_OK )
+        {
+            _linkBaud = _moduleParam.serialParam.baud;
+        }
+        else
+        {
+            retVal = HC12_ERR_FAIL;
+        }
+
+#if defined(__linux__)
+        _moduleParam.serialParam.dev_fd = _pTransport->fd();
+        if( reader && retVal == HC12_ERR_OK )
+        {
+            retVal = startReader();
+        }
+#endif // defined(__linux__)
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::probeCommandMode( void )
+ *
+ * wait for the module to answer AT after the SET pin went low. The
+ * first probe goes out after the settle time learned so far, further
+ * ones back to back until HC12_SETTLE_PROBE_MAX_MS. If the first one
+ * is answered, the next switch probes earlier, but not as early as a
+ * probe that went unanswered. The probes are counted in the statistics
+ * of AT.
+ *
+ * return HC12_ERR_OK on succes, HC12_ERR_TIMEOUT if there was no answer
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::probeCommandMode( void )
+{
+    int retVal = HC12_ERR_TIMEOUT;
+    uint32_t start = hc12NowMs();
+    uint32_t elapsed;
+    uint32_t sent;
+    int rspTimeout = _rspTimeout;
+    int probes = 0;
+
+    hc12SleepMs( _settleLearned );
+
+    // long enough for AT and its OK at the current baud rate
+    _rspTimeout = (HC12_SETTLE_PROBE_CHARS * 10 * 1000 + _linkBaud - 1) /
+                                     _linkBaud + HC12_SETTLE_PROBE_SLACK_MS;
+    // test() refuses to run otherwise
+    _currOpMode = HC12_OP_CMD_MODE;
+
+    do
+    {
+        probes++;
+        sent = hc12NowMs() - start;
+        if( test() == HC12_ERR_OK )
+        {
+            retVal = HC12_ERR_OK;
+        }
+        elapsed = hc12NowMs() - start;
+    } while( retVal != HC12_ERR_OK && elapsed < HC12_SETTLE_PROBE_MAX_MS );
+
+    _rspTimeout = rspTimeout;
+
+    if( retVal == HC12_ERR_OK )
+    {
+        if( probes == 1 )
+        {
+            // halfway down to the latest time that went unanswered
+            _settleLearned -= (_settleLearned - _settleFloor) / 2;
+        }
+        else
+        {
+            _settleFloor = _settleLearned;
+            _settleLearned = sent;
+        }
+
+        if( _settleLearned < HC12_SETTLE_PROBE_MIN_MS )
+        {
+            _settleLearned = HC12_SETTLE_PROBE_MIN_MS;
+        }
+        else if( _settleLearned > HC12_SETTLE_PROBE_MAX_MS )
+        {
+            _settleLearned = HC12_SETTLE_PROBE_MAX_MS;
+        }
+    }
+
+    HC12_LOG_DEBUG( HC12_EV_SETTLE, this, elapsed, probes );
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::setGpio( hc12Gpio *pGpio )
+ *
+ * drive the SET and power pin through pGpio from now on, the pins are
+ * requested right away. With NULL the SET pin is switched by hand.
+ * Several radios may share a backend.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::setGpio( hc12Gpio *pGpio )
+{
+    _pGpio = pGpio;
+    _pinsRequested = false;
+
+    return( requestPins() );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::requestPins( void )
+ *
+ * claim the pins of the module from the backend, the SET pin released
+ * and the power on. Done by connect() and the first mode switch if the
+ * application did not.
+ *
+ * return HC12_ERR_OK on succes, otherwise HC12_ERR_GPIO
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::requestPins( void )
+{
+    int retVal = HC12_ERR_OK;
+    int result = HC12_GPIO_OK;
+
+    if( _pGpio != NULL && !_pinsRequested )
+    {
+        if( _moduleParam.setPin != HC12_NULLPIN &&
+            (result = _pGpio->request( _moduleParam.setPin,
+                                       HC12_SETPIN_TT_MODE )) != HC12_GPIO_OK )
+        {
+            HC12_LOG_ERROR( HC12_EV_GPIO, this, _moduleParam.setPin, result );
+        }
+        else if( _moduleParam.powerPin != HC12_NULLPIN &&
+                 (result = _pGpio->request( _moduleParam.powerPin,
+                                       HC12_POWERPIN_ON )) != HC12_GPIO_OK )
+        {
+            HC12_LOG_ERROR( HC12_EV_GPIO, this, _moduleParam.powerPin,
+                            result );
+        }
+
+        if( result == HC12_GPIO_OK )
+        {
+            _pinsRequested = true;
+        }
+        else
+        {
+            retVal = HC12_ERR_GPIO;
+        }
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::writePin( int pin, int level )
+ *
+ * drive pin through the backend set by setGpio()
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::writePin( int pin, int level )
+{
+    int retVal;
+    int result;
+
+    if( _pGpio == NULL )
+    {
+        retVal = HC12_ERR_NULLP;
+    }
+    else if( (retVal = requestPins()) == HC12_ERR_OK &&
+             (result = _pGpio->write( pin, level )) != HC12_GPIO_OK )
+    {
+        HC12_LOG_ERROR( HC12_EV_GPIO, this, pin, result );
+        retVal = HC12_ERR_GPIO;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::switchPower( bool on )
+ *
+ * switch the supply of the module through its power pin. After power
+ * on the module needs the settle time of the mode the SET pin selects.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::switchPower( bool on )
+{
+    int retVal;
+
+    if( _moduleParam.powerPin == HC12_NULLPIN )
+    {
+        retVal = HC12_ERR_ARGS;
+    }
+    else
+    {
+        retVal = writePin( _moduleParam.powerPin,
+                           on ? HC12_POWERPIN_ON : HC12_POWERPIN_OFF );
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::beginModeSwitch( int mode )
+ *
+ * first half of a switch to HC12_OP_CMD_MODE or HC12_OP_TT_MODE: drive
+ * the SET pin. The caller has to let the module settle for the time
+ * returned before calling endModeSwitch(). Without SET pin there is
+ * nothing to wait for.
+ * Data still queued in transparent mode is written out before the
+ * switch to command mode, see drainTx(). If that fails, the switch is
+ * refused and the data stays queued.
+ * A SET pin without GPIO backend is refused with HC12_ERR_GPIO unless
+ * the manual mode switch is on.
+ *
+ * return the settle time in ms, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::beginModeSwitch( int mode )
+{
+    int retVal;
+
+    _tModeSwitch = hc12Stats::now();
+
+    if( mode != HC12_OP_CMD_MODE && mode != HC12_OP_TT_MODE )
+    {
+        retVal = HC12_ERR_ARGS;
+    }
+    else if( _moduleParam.setPin != HC12_NULLPIN && !pinAutomated() &&
+             !_manualModeSwitch )
+    {
+        // nobody to move the SET pin
+        retVal = HC12_ERR_GPIO;
+    }
+    else if( (retVal = _status) == HC12_ERR_OK )
+    {
+        // anything still queued would be taken as AT command
+        if( mode == HC12_OP_CMD_MODE && _currOpMode == HC12_OP_TT_MODE )
+        {
+            retVal = drainTx();
+        }
+
+        if( retVal == HC12_ERR_OK && _moduleParam.setPin != HC12_NULLPIN )
+        {
+            if( !pinAutomated() ||
+                (retVal = writePin( _moduleParam.setPin,
+                                    mode == HC12_OP_CMD_MODE ?
+                                       HC12_SETPIN_CMD_MODE :
+                                       HC12_SETPIN_TT_MODE )) == HC12_ERR_OK )
+            {
+                retVal = mode == HC12_OP_CMD_MODE ? 
+                                   HC12_SETTLE_CMD_MS : HC12_SETTLE_TT_MS;
+            }
+        }
+
+        HC12_LOG_DEBUG( HC12_EV_MODE_SWITCH, this, mode, retVal );
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::endModeSwitch( int mode )
+ *
+ * second half of a mode switch, the module is in the new mode now.
+ * Back in transparent mode a new baud rate of the module is in effect,
+ * the line follows, see relinkBaud().
+ *
+ * return HC12_ERR_OK on succes, HC12_ERR_FAIL if the line is lost
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::endModeSwitch( int mode )
+{
+    int retVal = HC12_ERR_OK;
+
+    _currOpMode = mode;
+    if( mode == HC12_OP_TT_MODE )
+    {
+        retVal = relinkBaud();
+        // FU mode and baud rate may have changed in command mode
+        configurePacer();
+    }
+    _stats.modeSwitch( mode == HC12_OP_CMD_MODE ? 
+                           HC12_STAT_ENTER_CMD : HC12_STAT_LEAVE_CMD,
+                       hc12Stats::now() - _tModeSwitch );
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * void hc12Radio::init( void )
+ *
+ * initialize internal structs
+ *
+ * return nothing
+ ------------------------------------------------------------------------------
+*/
+void hc12Radio::init( void )
+{
+
+#if defined(RASPBERRY)
+    // pigpio is set up with the first request, not here
+    _pGpio = &hc12DefaultGpio;
+#endif // defined(RASPBERRY)
+
+    _moduleParam.comChannel = HC12_DEFAULT_CHANNEL;
+    _moduleParam.ttMode = HC12_DEFAULT_TTMODE;
+    _moduleParam.power = HC12_DEFAULT_POWER;
+ 
+#if defined(__linux__)
+    free( _moduleParam.serialParam.device );
+    _moduleParam.serialParam.device = strdup( (char*) HC12_DEFAULT_DEVICE );
+
+    _moduleParam.serialParam.dev_fd = -1;
+
+    memset( &_moduleParam.serialParam.oldtio, '\0', sizeof(struct termios) );
+    memset( &_moduleParam.serialParam.rawtio, '\0', sizeof(struct termios) );
+#else // NOT defined(__linux__)
+    #if defined(ARDUINO)
+    _moduleParam.serialParam.pHPort = NULL;
+    _moduleParam.serialParam.pSPort = NULL;
+    _moduleParam.serialParam.isHWPort = false;
+    #endif // defined(ARDUINO)
+#endif // defined(__linux__)
+
+    _moduleParam.serialParam.baud = HC12_DEFAULT_BAUD;
+    _moduleParam.serialParam.databit = HC12_DEFAULT_DATABIT;
+    _moduleParam.serialParam.parity = HC12_DEFAULT_PARITY;
+    _moduleParam.serialParam.stopbits = HC12_DEFAULT_STOPBITS;
+//    _moduleParam.serialParam.handshake = HC12_DEFAULT_HANDSHAKE;
+
+    _moduleParam.hwInfo.major = HC12_DEFAULT_V_MAJOR;
+    _moduleParam.hwInfo.minor = HC12_DEFAULT_V_MINOR;
+    _moduleParam.hwInfo.patch  = HC12_DEFAULT_V_PATCH;
+
+    _interfaceType = HC12_DEFAULT_INTERFACE;
+    _currOpMode = HC12_DEFAULT_OPMODE;
+
+    memset( _ioBuffer, '\0', IO_BUFFER_SIZE );
+
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::test( void )
+ *
+ * AT
+ * Test command. Send command “AT” to the module, and the module returns “OK”.
+ *
+ * return HC12_ERR_OKE_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::test( void )
+{
+    int retVal = HC12_ERR_OK;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        hc12FormatCommand( HC12_CMD_CODE_TEST, 0, _ioBuffer );
+        _currentCommand = HC12_CMD_CODE_TEST;
+        _commandStatus = HC12_CMD_STATUS_REQUEST;
+        _responseArgs = 0;
+
+        if( (retVal = sendRequest()) == E_OK )
+        {
+            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            if( _parser.response()->type == HC12_RSP_TYPE_OK )
+            {
+                retVal = HC12_ERR_OK;
+            }
+            else
+            {
+                retVal = HC12_ERR_RESPONSE;
+            }
+        }
+        else
+        {
+            _commandStatus = HC12_CMD_STATUS_FAILED;
+        }
+
+    }
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * void hc12Radio::reset( void )
+ *
+ * reset internal vars to their defaults
+ *
+ * return nothing
+ ------------------------------------------------------------------------------
+*/
+void hc12Radio::reset( void )
+{
+    _moduleParam.comChannel = HC12_DEFAULT_CHANNEL;
+    _moduleParam.ttMode = HC12_DEFAULT_TTMODE;
+    _moduleParam.power = HC12_DEFAULT_POWER;
+ 
+    _moduleParam.serialParam.baud = HC12_DEFAULT_BAUD;
+    _moduleParam.serialParam.databit = HC12_DEFAULT_DATABIT;
+    _moduleParam.serialParam.parity = HC12_DEFAULT_PARITY;
+    _moduleParam.serialParam.stopbits = HC12_DEFAULT_STOPBITS;
+//    _moduleParam.serialParam.handshake = HC12_DEFAULT_HANDSHAKE;
+
+    // factory defaults are assumed, not reported
+    for( int i = 0; i < HC12_PARAM_CACHED_FIELDS; i++ )
+    {
+        if( i != HC12_PARAM_FIELD_VERSION )
+        {
+            _paramState[i] = HC12_PARAM_KNOWN;
+        }
+    }
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * bool hc12Radio::isCached( int field, int how )
+ *
+ * check whether a getter may serve field from _moduleParam
+ * return true if the cached value satisfies how
+ ------------------------------------------------------------------------------
+*/
+bool hc12Radio::isCached( int field, int how )
+{
+    bool retVal = false;
+
+    if( field >= 0 && field < HC12_PARAM_CACHED_FIELDS )
+    {
+        switch( how )
+        {
+            case HC12_READ_CACHED:
+                retVal = _paramState[field] >= HC12_PARAM_KNOWN;
+                break;
+            case HC12_READ_CONFIRMED:
+                retVal = _paramState[field] == HC12_PARAM_CONFIRMED;
+                break;
+            case HC12_READ_REFRESH:
+            default:
+                retVal = false;
+                break;
+        }
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::getParamState( int field )
+ *
+ * return the cache state (HC12_PARAM_UNKNOWN, HC12_PARAM_KNOWN or
+ * HC12_PARAM_CONFIRMED) of field or HC12_ERR_ARGS
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::getParamState( int field )
+{
+    int retVal = HC12_ERR_ARGS;
+
+    if( field >= 0 && field < HC12_PARAM_CACHED_FIELDS )
+    {
+        retVal = _paramState[field];
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::getCachedParam( struct _hc12_param* pParam )
+ *
+ * copy the local view of the module parameters to pParam, no 
+ * communication takes place. Use getParamState() to find out how 
+ * reliable a value is.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::getCachedParam( struct _hc12_param* pParam )
+{
+    int retVal = HC12_ERR_OK;
+
+    if( pParam != NULL )
+    {
+        *pParam = _moduleParam;
+    }
+    else
+    {
+        retVal = HC12_ERR_NULLP;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int setDefault( void )
+ *
+ * AT+DEFAULT
+ * Set serial port baud rate and configuration, communication channel, power,
+ * and serial port transparent transmission mode back to the factory default 
+ * values.
+ * e.g: Send command “AT+DEFAULT” to the module, and the module returns
+ * “OK+DEFAULT”, with the factory default values restored. The factory default
+ * serial port baud rate is 9600bps, 8 data bits, no parity, 1 stop bit,
+ * communication channel is 001, transmitting power is 20dBm, and serial port
+ * transparent transmission mode is FU3.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::setDefault( void )
+{
+    int retVal = HC12_ERR_OK;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        hc12FormatCommand( HC12_CMD_CODE_SET_DEFAULT, 0, _ioBuffer );
+        _currentCommand = HC12_CMD_CODE_SET_DEFAULT;
+        _commandStatus = HC12_CMD_STATUS_REQUEST;
+        _responseArgs = 0;
+
+        if( (retVal = sendRequest()) == E_OK )
+        {
+            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            if( _parser.response()->type == HC12_RSP_TYPE_DEFAULT )
+            {
+                reset();
+                retVal = HC12_ERR_OK;
+            }
+            else
+            {
+                retVal = HC12_ERR_RESPONSE;
+            }
+        }
+        else
+        {
+            _commandStatus = HC12_CMD_STATUS_FAILED;
+        }
+    }
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::goSleepMode( void )
+ *
+ * AT+SLEEP
+ * After receiving this command, the module will enter sleep mode upon 
+ * exiting from command mode, with a working current of about 22uA. 
+ * This mode doesn’t allow serial port data transmission. Upon entering 
+ * command mode again the module will exit from sleep mode automatically.
+ * e.g: When wireless data transmission is not needed, to save power send 
+ * command “AT+SLEEP” to the module, and the module will return “OK+SLEEP”. 
+ * Upon exit from command mode the working current will drop to about 22uA.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::goSleepMode( void )
+{
+    int retVal = HC12_ERR_OK;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        hc12FormatCommand( HC12_CMD_CODE_SLEEP, 0, _ioBuffer );
+        _currentCommand = HC12_CMD_CODE_SLEEP;
+        _commandStatus = HC12_CMD_STATUS_REQUEST;
+        _responseArgs = 0;
+
+
+        if( (retVal = sendRequest()) == E_OK )
+        {
+            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            if( _parser.response()->type == HC12_RSP_TYPE_SLEEP )
+            {
+                retVal = HC12_ERR_OK;
+            }
+            else
+            {
+                retVal = HC12_ERR_RESPONSE;
+            }
+        }
+        else
+        {
+            _commandStatus = HC12_CMD_STATUS_FAILED;
+        }
+    }
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::goUpdateMode( void )
+ *
+ * AT+UPDATE
+ * Puts the module in the state of waiting for a software update. 
+ * After receiving this command the module will not respond to any further 
+ * AT commands until power has been cycled.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::goUpdateMode( void )
+{
+    int retVal = HC12_ERR_OK;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        hc12FormatCommand( HC12_CMD_CODE_UPDATE, 0, _ioBuffer );
+        _currentCommand = HC12_CMD_CODE_UPDATE;
+        _commandStatus = HC12_CMD_STATUS_REQUEST;
+        _responseArgs = 0;
+        sendRequest();
+    }
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::setBaud( uint32_t baud )
+ *
+ * AT+Bxxxx
+ * Change the serial port baud rate. The baud rate can be set to 1200bps, 
+ * 2400bps, 4800bps, 9600bps, 19,200bps, 38,400bps, 57,600bps, or 115,200bps. 
+ * The default value is 9600bps.
+ * e.g: To set the serial port baud rate of the module to 19,200bps, send 
+ * command “AT+B19200” to the module, and the module will return “OK+B19200”. 
+ * After exiting from command mode, the module will begin to communicate at 
+ * 19,200bps. leaveCommandMode() switches the line to the new rate.
+ *
+ * return HC12_ERR_OKE_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::setBaud( uint32_t baud )
+{
+    int retVal = HC12_ERR_OK;
+    const struct _hc12_response *pRsp;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        if( isValidBaud( baud ) )
+        {
+            hc12FormatCommand( HC12_CMD_CODE_SET_BAUD, baud, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_SET_BAUD;
+            _commandStatus = HC12_CMD_STATUS_REQUEST;
+            _responseArgs = 0;
+
+            if( (retVal = sendRequest()) == E_OK )
+            {
+                _commandStatus = HC12_CMD_STATUS_ACTIVE;
+                pRsp = _parser.response();
+                if( pRsp->type == HC12_RSP_TYPE_BAUD )
+                {
+                    if( baud == (uint32_t) pRsp->value )
+                    {    
+                        _moduleParam.serialParam.baud = baud;
+                        retVal = HC12_ERR_OK;
+                    }
+                    else
+                    {
+                        retVal = HC12_ERR_FAIL;
+                    }
+                }
+                else
+                {
+                    retVal = HC12_ERR_ARGS;
+                }
+            }
+            else
+            {
+                _commandStatus = HC12_CMD_STATUS_FAILED;
+                _paramState[HC12_PARAM_FIELD_BAUD] = HC12_PARAM_UNKNOWN;
+            }
+        }
+        else
+        {
+            retVal = HC12_ERR_BAUD;
+        }
+    }
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::setComChannel( int chan )
+ *
+ * AT+Cxxx
+ * Change wireless communication channel, selectable from 001 to 127 
+ * (for wireless channels exceeding 100, the communication distance cannot 
+ * be guaranteed). The default value for the wireless channel is 001, with 
+ * a working frequency of 433.4MHz. The channel stepping is 400KHz, and 
+ * the working frequency of channel100 is 473.0MHz.
+ * e.g: To set the module to work on channel 21, send command “AT+C021” to the
+ * module, and the module will return “OK+C021”. After exiting from command 
+ * mode, the module will work on channel 21, with a working frequency of 
+ * 441.4MHz.
+ * Note: As the wireless receiving sensitivity of the HC-12 module is 
+ * relatively high, when the serial port baud rate  greater than 9600bps 
+ * five adjacent channels should be staggered for use. Even when the serial 
+ * port baud rate is not greater than 9600bps, over short distances 
+ * (less than 10m) also five adjacent channels should be staggered for use.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::setComChannel( int chan )
+{
+    int retVal = HC12_ERR_OK;
+    const struct _hc12_response *pRsp;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        if( isValidChannel( chan ) )
+        {
+            hc12FormatCommand( HC12_CMD_CODE_SET_CHANNEL, chan, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_SET_CHANNEL;
+            _commandStatus = HC12_CMD_STATUS_REQUEST;
+            _responseArgs = 0;
+
+            if( (retVal = sendRequest()) == E_OK )
+            {
+                _commandStatus = HC12_CMD_STATUS_ACTIVE;
+                pRsp = _parser.response();
+                if( pRsp->type == HC12_RSP_TYPE_CHANNEL )
+                {
+                    if( chan == pRsp->value )
+                    {    
+                        _moduleParam.comChannel = chan;
+                        retVal = HC12_ERR_OK;
+                    }
+                    else
+                    {
+                        retVal = HC12_ERR_FAIL;
+                    }
+                }
+                else
+                {
+                    retVal = HC12_ERR_ARGS;
+                }
+            }
+            else
+            {
+                _commandStatus = HC12_CMD_STATUS_FAILED;
+                _paramState[HC12_PARAM_FIELD_CHANNEL] = HC12_PARAM_UNKNOWN;
+            }
+        }
+        else
+        {
+            retVal = HC12_ERR_CHANNEL;
+        }
+}
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::setTTMode( int mode )
+ *
+ * AT+FUx
+ * Change the serial port transparent transmission mode of the module. 
+ * Four modes are available, namely FU1, FU2, FU3, and FU4. Only when the 
+ * serial port speed, channel, and transparent transmission mode of two 
+ * modules is set to be the same, can normal wireless communications occur. 
+ * e.g: Send command “AT+FU1” to the module, and the module returns “OK+FU1”.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::setTTMode( int mode )
+{
+    int retVal = HC12_ERR_OK;
+    const struct _hc12_response *pRsp;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        if( isValidTTMode( mode ) )
+        {
+            hc12FormatCommand( HC12_CMD_CODE_SET_TTMODE, mode, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_SET_TTMODE;
+            _commandStatus = HC12_CMD_STATUS_REQUEST;
+            _responseArgs = 0;
+
+
+            if( (retVal = sendRequest()) == E_OK )
+            {
+                _commandStatus = HC12_CMD_STATUS_ACTIVE;
+                pRsp = _parser.response();
+                if( pRsp->type == HC12_RSP_TYPE_TTMODE )
+                {
+                    if( mode == pRsp->value )
+                    {    
+                        _moduleParam.ttMode = mode;
+                        retVal = HC12_ERR_OK;
+                    }
+                    else
+                    {
+                        retVal = HC12_ERR_FAIL;
+                    }
+                }
+                else
+                {
+                    retVal = HC12_ERR_ARGS;
+                }
+            }
+            else
+            {
+                _commandStatus = HC12_CMD_STATUS_FAILED;
+                _paramState[HC12_PARAM_FIELD_TTMODE] = HC12_PARAM_UNKNOWN;
+            }
+        }
+        else
+        {
+            retVal = HC12_ERR_TTMODE;
+        }
+}
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::setTPower( int power )
+ *
+ * AT+Px
+ * Set the transmitting power of the module, with x selectable from 1 to 8. 
+ * The corresponding transmitting power of the module is as shown below:
+ *
+ *  +---------------+------+-----+-----+-----+------+------+------+------+
+ *  |   x value     |  1   |  2  |  3  |  4  |   5  |   6  |   7  |  8   |
+ *  +---------------+------+-----+-----+-----+------+------+------+------+
+ *  |Transmitting   |-1 dBm|2 dBm|5 dBm|8 dBm|11 dBm|14 dBm|17 dBm|20 dBm|
+ *  |power of module| 0.8mW|1.6mW|3.2mW|6.3mW| 12mW | 25mW | 50mW | 100mW|
+ *  +---------------+------+-----+-----+-----+------+------+------+------+
+ *
+ * The default value is 8, and the higher the transmitting power, the farther
+ * the possible wireless communication distance. When the transmitting power 
+ * level is set to 1, the transmitting power is at the minimum. Generally 
+ * speaking, every time the transmitting power is reduced by 6dB, the 
+ * communication distance will be reduced by half.
+ * e.g: Send command “AT+P5” to the module, and the module returns “OK+P5”.
+ * After exiting from command mode, the transmitting power of the module 
+ * will be set to 11dBm.
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::setTPower( int power )
+{
+    int retVal = HC12_ERR_OK;
+    const struct _hc12_response *pRsp;
+
+    if( _currOpMode == HC12_OP_CMD_MODE )
+    {
+        if( isValidPower( power ) )
+        {
+            hc12FormatCommand( HC12_CMD_CODE_SET_POWER, power, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_SET_POWER;
+            _commandStatus = HC12_CMD_STATUS_REQUEST;
+            _responseArgs = 0;
+
+            if( (retVal = sendRequest()) == E_OK )
+            {
+                _commandStatus = HC12_CMD_STATUS_ACTIVE;
+                pRsp = _parser.response();
+                if( pRsp->type == HC12_RSP_TYPE_POWER )
+                {
+                    if( power == pRsp->value )
+                    {    
+                        _moduleParam.power = power;
+                        retVal = HC12_ERR_OK;
+                    }
+                    else
+                    {
+                        retVal = HC12_ERR_FAIL;
+                    }
+                }
+                else
+                {
+                    retVal = HC12_ERR_ARGS;
+                }
+            }
+            else
+            {
+                _commandStatus = HC12_CMD_STATUS_FAILED;
+                _paramState[HC12_PARAM_FIELD_POWER] = HC12_PARAM_UNKNOWN;
+            }
+        }
+        else
+        {
+            retVal = HC12_ERR_POWER;
+        }
+}
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::setParam( struct _hc12_param* pParam )
+ *
+ * there is no single AT command for this, the changed values are
+ * applied as one transaction. See applyParam()
+ *
+ * return HC12_ERR_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::setParam( struct _hc12_param* pParam )
+{
+    return( applyParam( pParam, NULL ) );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::formatSetCommand( int field, int value, char *pBuffer )
+ *
+ * write the AT command setting one field of _hc12_param to pBuffer
+ * returns the length of the command or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::formatSetCommand( int field, int value, char *pBuffer )
+{
+    int retVal = HC12_ERR_ARGS;
 
-    memset( _ioBuffer, '\0', IO_BUFFER_SIZE );
+    if( field >= 0 && field < HC12_PARAM_FIELDS )
+    {
+        retVal = hc12FormatCommand( hc12SetCodes[field], value, pBuffer );
+    }
 
+    return( retVal );
 }
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::test( void )
+ * int hc12Radio::applyFields( const int *pFields, const int *pValues, 
+ *                             int count, int *pResults )
  *
- * AT
- * Test command. Send command “AT” to the module, and the module returns “OK”.
+ * send the set commands for count fields in a single write and collect
+ * the replies afterwards. Each reply has to echo the requested value.
+ * pResults receives HC12_ERR_OK or an error code per field.
  *
- * return HC12_ERR_OKE_OK on succes, otherwise an error code
+ * return HC12_ERR_OK if all fields were set, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::test( void )
+int hc12Radio::applyFields( const int *pFields, const int *pValues, 
+                            int count, int *pResults )
 {
     int retVal = HC12_ERR_OK;
+    const struct _hc12_response *pRsp;
+    int readResult;
+    int len = 0;
+    int i;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( _pTransport == NULL )
     {
-        sprintf( _ioBuffer, HC12_CMD_TEST );
-        _currentCommand = HC12_CMD_CODE_TEST;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
+        return( E_NULL_CONNECTION );
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        len += formatSetCommand( pFields[i], pValues[i], &_ioBuffer[len] );
+        pResults[i] = HC12_ERR_RESPONSE;
+    }
+
+    HC12_LOG_DEBUG( HC12_EV_APPLY_SEND, this, count, len );
+
+    _ioPos = _ioLen = 0;
+    _parser.reset();
+    memset( &_rspValues, '\0', sizeof(_rspValues) );
+    _responseLines = 0;
+    _rspStarted = false;
+
+    _tWrite = hc12Stats::now();
+    if( _pTransport->write( _ioBuffer, len ) != len )
+    {
+        return( HC12_ERR_FAIL );
+    }
+
+    // the module answers in order, one line per command. A bad echo
+    // does not stop the loop, the replies to the rest are read as well.
+    _pipelined = true;
+    for( i = 0; i < count && retVal != HC12_ERR_RESPONSE; i++ )
+    {
+        _currentCommand = hc12SetCodes[pFields[i]];
+        _commandStatus = HC12_CMD_STATUS_ACTIVE;
         _responseArgs = 0;
+        // each echo is a reply of its own
+        _rspStarted = false;
 
-        if( (retVal = sendRequest()) == E_OK )
+        if( (readResult = getResponse()) > 0 )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
-            if( (retVal = strncmp( _ioBuffer, HC12_RSP_TEST, 
-                               strlen(HC12_RSP_TEST))) == 0 )
+            parseResponse();
+            pRsp = _parser.response();
+
+            if( _commandStatus == HC12_CMD_STATUS_DONE &&
+                pRsp->type == hc12CommandDesc(
+                               hc12SetCodes[pFields[i]] )->rspType &&
+                pRsp->value == pValues[i] )
             {
-                retVal = HC12_ERR_OK;
+                pResults[i] = HC12_ERR_OK;
             }
             else
             {
-                retVal = HC12_ERR_RESPONSE;
+                if( _commandStatus == HC12_CMD_STATUS_DONE )
+                {
+                    _commandStatus = HC12_CMD_STATUS_FAILED;
+                }
+                pResults[i] = HC12_ERR_FAIL;
+                retVal = HC12_ERR_FAIL;
             }
         }
         else
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
-//sprintf(hc12LogBuffer, "ERR send request failed [%d]\n", retVal);
-// doLog(DEBUG_LEVEL_1);
+            retVal = HC12_ERR_RESPONSE;
         }
 
+        // latencies of pipelined commands count from the common write
+        recordCommand( hc12SetCodes[pFields[i]], readResult );
     }
-    else
+    _pipelined = false;
+
+    // late replies to the commands not answered in time must not be
+    // taken for the replies to the next ones
+    if( retVal == HC12_ERR_RESPONSE )
     {
-        retVal = HC12_ERR_OP_MODE;
+        drainInput();
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( pResults[i] != HC12_ERR_OK )
+        {
+            _paramState[pFields[i]] = HC12_PARAM_UNKNOWN;
+        }
     }
 
+    _currentCommand = HC12_CMD_CODE_NULL;
+
     return( retVal );
 }
 
 /* 
  ------------------------------------------------------------------------------
- * void hc12Radio::reset( void )
- *
- * reset internal vars to their defaults
+ * int hc12Radio::getParamField( int field )
  *
- * return nothing
+ * return the local value of one of the HC12_PARAM_FIELDS fields
  ------------------------------------------------------------------------------
 */
-void hc12Radio::reset( void )
+int hc12Radio::getParamField( int field )
 {
-    _moduleParam.comChannel = HC12_DEFAULT_CHANNEL;
-    _moduleParam.ttMode = HC12_DEFAULT_TTMODE;
-    _moduleParam.power = HC12_DEFAULT_POWER;
- 
-    _moduleParam.serialParam.baud = HC12_DEFAULT_BAUD;
-    _moduleParam.serialParam.databit = HC12_DEFAULT_DATABIT;
-    _moduleParam.serialParam.parity = HC12_DEFAULT_PARITY;
-    _moduleParam.serialParam.stopbits = HC12_DEFAULT_STOPBITS;
-//    _moduleParam.serialParam.handshake = HC12_DEFAULT_HANDSHAKE;
+    int retVal = HC12_ERR_ARGS;
+
+    switch( field )
+    {
+        case HC12_PARAM_FIELD_CHANNEL:
+            retVal = _moduleParam.comChannel;
+            break;
+        case HC12_PARAM_FIELD_POWER:
+            retVal = _moduleParam.power;
+            break;
+        case HC12_PARAM_FIELD_TTMODE:
+            retVal = _moduleParam.ttMode;
+            break;
+        case HC12_PARAM_FIELD_BAUD:
+            retVal = _moduleParam.serialParam.baud;
+            break;
+    }
 
+    return( retVal );
 }
 
 /* 
  ------------------------------------------------------------------------------
- * int setDefault( void )
+ * int hc12Radio::applyParam( struct _hc12_param* pParam,
+ *                            struct _hc12_param_result *pResult )
  *
- * AT+DEFAULT
- * Set serial port baud rate and configuration, communication channel, power,
- * and serial port transparent transmission mode back to the factory default 
- * values.
- * e.g: Send command “AT+DEFAULT” to the module, and the module returns
- * “OK+DEFAULT”, with the factory default values restored. The factory default
- * serial port baud rate is 9600bps, 8 data bits, no parity, 1 stop bit,
- * communication channel is 001, transmitting power is 20dBm, and serial port
- * transparent transmission mode is FU3.
+ * bring channel, power, transparent mode and baud rate of the module to
+ * the values given in pParam within one command mode session.
+ * Only values differing from the known module state (or not known at 
+ * all) are sent, all of them pipelined in a single write. The echo of every
+ * command is checked and all values are read back with one AT+RX
+ * afterwards. If any field fails, the fields already changed are set back
+ * to their previous values, as far as these were known.
+ * Command mode is entered and left again if the module is not in
+ * command mode already. A new baud rate is taken by the line when
+ * command mode is left, see relinkBaud().
+ * pResult (may be NULL) receives per field HC12_ERR_OK,
+ * HC12_PARAM_UNCHANGED, HC12_PARAM_ROLLED_BACK or an error code.
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::setDefault( void )
+int hc12Radio::applyParam( struct _hc12_param* pParam,
+                           struct _hc12_param_result *pResult )
 {
     int retVal = HC12_ERR_OK;
+    struct _hc12_param_result result;
+    int wanted[HC12_PARAM_FIELDS];
+    int previous[HC12_PARAM_FIELDS];
+    int fields[HC12_PARAM_FIELDS];
+    int values[HC12_PARAM_FIELDS];
+    int results[HC12_PARAM_FIELDS];
+    bool known[HC12_PARAM_FIELDS];
+    int count = 0;
+    int back;
+    bool leaveAfter = false;
+    int i;
+
+    if( pParam == NULL )
+    {
+        return( HC12_ERR_NULLP );
+    }
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( !isValidChannel( pParam->comChannel ) )
     {
-        sprintf( _ioBuffer, HC12_CMD_SET_DEFAULT );
-        _currentCommand = HC12_CMD_CODE_SET_DEFAULT;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
+        return( HC12_ERR_CHANNEL );
+    }
 
-        if( (retVal = sendRequest()) == E_OK )
+    if( !isValidPower( pParam->power ) )
+    {
+        return( HC12_ERR_POWER );
+    }
+
+    if( !isValidTTMode( pParam->ttMode ) )
+    {
+        return( HC12_ERR_TTMODE );
+    }
+
+    if( !isValidBaud( pParam->serialParam.baud ) )
+    {
+        return( HC12_ERR_BAUD );
+    }
+
+    wanted[HC12_PARAM_FIELD_CHANNEL] = pParam->comChannel;
+    wanted[HC12_PARAM_FIELD_POWER] = pParam->power;
+    wanted[HC12_PARAM_FIELD_TTMODE] = pParam->ttMode;
+    wanted[HC12_PARAM_FIELD_BAUD] = pParam->serialParam.baud;
+
+    for( i = 0; i < HC12_PARAM_FIELDS; i++ )
+    {
+        previous[i] = getParamField( i );
+        known[i] = _paramState[i] != HC12_PARAM_UNKNOWN;
+        if( wanted[i] != previous[i] || 
+            _paramState[i] == HC12_PARAM_UNKNOWN )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
-            if( (retVal = strncmp( _ioBuffer, HC12_RSP_SET_DEFAULT, 
-                               strlen(HC12_RSP_SET_DEFAULT))) == 0 )
+            fields[count] = i;
+            values[count++] = wanted[i];
+        }
+        result.field[i] = HC12_PARAM_UNCHANGED;
+    }
+
+    if( count > 0 )
+    {
+        if( _currOpMode != HC12_OP_CMD_MODE )
+        {
+            if( (retVal = enterCommandMode()) == HC12_ERR_OK )
             {
-                reset();
-                retVal = HC12_ERR_OK;
+                leaveAfter = true;
             }
-            else
+        }
+
+        if( retVal == HC12_ERR_OK )
+        {
+            retVal = applyFields( fields, values, count, results );
+
+            for( i = 0; i < count; i++ )
             {
-                retVal = HC12_ERR_RESPONSE;
+                result.field[fields[i]] = results[i];
+            }
+
+            // read everything back with a single AT+RX
+            if( retVal == HC12_ERR_OK &&
+                (retVal = getParam( HC12_READ_REFRESH )) == HC12_ERR_OK )
+            {
+                for( i = 0; i < count; i++ )
+                {
+                    if( getParamField( fields[i] ) != values[i] )
+                    {
+                        result.field[fields[i]] = HC12_ERR_FAIL;
+                        retVal = HC12_ERR_FAIL;
+                    }
+                }
+            }
+
+            if( retVal != HC12_ERR_OK )
+            {
+                // roll back every field sent, a missing reply does not
+                // mean the module did not take the value. A previous
+                // value that was never known is nothing to go back to.
+                for( i = back = 0; i < count; i++ )
+                {
+                    if( known[fields[i]] )
+                    {
+                        fields[back] = fields[i];
+                        values[back++] = previous[fields[i]];
+                    }
+                }
+
+                if( back > 0 )
+                {
+                    applyFields( fields, values, back, results );
+
+                    for( i = 0; i < back; i++ )
+                    {
+                        if( results[i] == HC12_ERR_OK &&
+                            result.field[fields[i]] == HC12_ERR_OK )
+                        {
+                            result.field[fields[i]] = HC12_PARAM_ROLLED_BACK;
+                        }
+                    }
+                }
             }
         }
-        else
+
+        if( leaveAfter )
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
+            leaveCommandMode();
         }
     }
-    else
+
+    if( pResult != NULL )
     {
-        retVal = HC12_ERR_OP_MODE;
+        *pResult = result;
     }
 
     return( retVal );
@@ -1382,48 +2907,86 @@ int hc12Radio::setDefault( void )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::goSleepMode( void )
+ * int hc12Radio::setSerialParam( int databits, char parity, int stopbits )
  *
- * AT+SLEEP
- * After receiving this command, the module will enter sleep mode upon 
- * exiting from command mode, with a working current of about 22uA. 
- * This mode doesn’t allow serial port data transmission. Upon entering 
- * command mode again the module will exit from sleep mode automatically.
- * e.g: When wireless data transmission is not needed, to save power send 
- * command “AT+SLEEP” to the module, and the module will return “OK+SLEEP”. 
- * Upon exit from command mode the working current will drop to about 22uA.
+ * AT+Udps
+ * Set data bits (d), parity (p), and stop bits (s) for serial port 
+ * communication. For parity, N means none, O means odd check, and E means 
+ * even check. For stop bits, 1 means one stop bit, 2 means two stop bits, 
+ * and 3 means 1.5 stop bits.
+ * e.g: To set the serial port format to eight data bits, odd parity, and 
+ * one stop bit, send command “AT+U8O1” to the module. 
+ * The module will return “OK+U8O1”.
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::goSleepMode( void )
+int hc12Radio::setSerialParam( int databits, char parity, int stopbits )
 {
     int retVal = HC12_ERR_OK;
+    const struct _hc12_response *pRsp;
 
     if( _currOpMode == HC12_OP_CMD_MODE )
     {
-        sprintf( _ioBuffer, HC12_CMD_SLEEP );
-        _currentCommand = HC12_CMD_CODE_SLEEP;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
-
-
-        if( (retVal = sendRequest()) == E_OK )
+        if( isValidDatabits( databits ) )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
-            if( (retVal = strncmp( _ioBuffer, HC12_RSP_SLEEP, 
-                               strlen(HC12_RSP_SLEEP))) == 0 )
+            if( isValidParity( parity ) )
             {
-                retVal = HC12_ERR_OK;
+                if( isValidStopbits( stopbits ) )
+                {
+                    hc12FormatCommand( HC12_CMD_CODE_SET_SERIAL,
+                           HC12_SERIAL_ARG( databits, parity, stopbits ),
+                           _ioBuffer );
+
+                    _currentCommand = HC12_CMD_CODE_SET_SERIAL;
+                    _commandStatus = HC12_CMD_STATUS_REQUEST;
+                    _responseArgs = 0;
+
+                    if( (retVal = sendRequest()) == E_OK )
+                    {
+                        _commandStatus = HC12_CMD_STATUS_ACTIVE;
+
+                        pRsp = _parser.response();
+                        if( pRsp->type == HC12_RSP_TYPE_SERIAL )
+                        {
+                            if( ( databits == pRsp->databits ) &&
+                                ( parity == pRsp->parity ) &&
+                                ( stopbits == pRsp->stopbits ) )
+                            {    
+                                _moduleParam.serialParam.databit = databits;
+                                _moduleParam.serialParam.parity = parity;
+                                _moduleParam.serialParam.stopbits = stopbits;
+                                retVal = HC12_ERR_OK;
+                            }
+                            else
+                            {
+                                retVal = HC12_ERR_FAIL;
+                            }
+                        }
+                        else
+                        {
+                            retVal = HC12_ERR_ARGS;
+                        }
+                    }
+                    else
+                    {
+                        _commandStatus = HC12_CMD_STATUS_FAILED;
+                        _paramState[HC12_PARAM_FIELD_SERIAL] = HC12_PARAM_UNKNOWN;
+                    }
+                }
+                else
+                {
+                    retVal = HC12_ERR_STOPBITS;
+                }
             }
             else
             {
-                retVal = HC12_ERR_RESPONSE;
+                retVal = HC12_ERR_PARITY;
             }
         }
         else
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
+            retVal = HC12_ERR_DATABITS;
         }
     }
     else
@@ -1434,33 +2997,61 @@ int hc12Radio::goSleepMode( void )
     return( retVal );
 }
 
+
+/* ****************************************************************************
+ *
+ * AT+Ry
+ * Obtain a single parameter from the module, where y is any letter among B, 
+ * C, F, and P, respectively representing: baud rate, communication channel, 
+ * serial port transparent transmission mode, and transmitting power.
+ *
+ * The getters serve the value from the local copy in _moduleParam if its
+ * state satisfies how:
+ *   HC12_READ_CACHED    value known (assumed or reported by the module)
+ *   HC12_READ_CONFIRMED value reported by the module
+ *   HC12_READ_REFRESH   always ask the module
+ * Values are read by getCachedParam() afterwards.
+ *
+ * ****************************************************************************
+*/
+
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::goUpdateMode( void )
+ * int hc12Radio::getBaud( int how )
  *
- * AT+UPDATE
- * Puts the module in the state of waiting for a software update. 
- * After receiving this command the module will not respond to any further 
- * AT commands until power has been cycled.
+ * Example 1:
+ * Send command “AT+RB” to the module, and if the module returns “OK+B9600” 
+ * it is confirmed that the serial port baud rate of the module is 9600bps.
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::goUpdateMode( void )
+int hc12Radio::getBaud( int how )
 {
     int retVal = HC12_ERR_OK;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
-    {
-        sprintf( _ioBuffer, HC12_CMD_UPDATE );
-        _currentCommand = HC12_CMD_CODE_UPDATE;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
-        sendRequest();
-    }
-    else
+    if( !isCached( HC12_PARAM_FIELD_BAUD, how ) )
     {
-        retVal = HC12_ERR_OP_MODE;
+        if( _currOpMode == HC12_OP_CMD_MODE )
+        {
+            hc12FormatCommand( HC12_CMD_CODE_GET_BAUD, 0, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_GET_BAUD;
+            _commandStatus = HC12_CMD_STATUS_REQUEST;
+            _responseArgs = 0;
+
+            if( (retVal = sendRequest()) == E_OK )
+            {
+                _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            }
+            else
+            {
+                _commandStatus = HC12_CMD_STATUS_FAILED;
+            }
+        }
+        else
+        {
+            retVal = HC12_ERR_OP_MODE;
+        }
     }
 
     return( retVal );
@@ -1468,54 +3059,31 @@ int hc12Radio::goUpdateMode( void )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::setBaud( uint32_t baud )
+ * int hc12Radio::getComChannel( int how )
  *
- * AT+Bxxxx
- * Change the serial port baud rate. The baud rate can be set to 1200bps, 
- * 2400bps, 4800bps, 9600bps, 19,200bps, 38,400bps, 57,600bps, or 115,200bps. 
- * The default value is 9600bps.
- * e.g: To set the serial port baud rate of the module to 19,200bps, send 
- * command “AT+B19200” to the module, and the module will return “OK+B19200”. 
- * After exiting from command mode, the module will begin to communicate at 
- * 19,200bps.
+ * Example 2:
+ * Send command “AT+RC” to the module, and if the module returns “OK+RC001” 
+ * it is confirmed that the communication channel of the module is 001.
  *
- * return HC12_ERR_OKE_OK on succes, otherwise an error code
+ * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::setBaud( uint32_t baud )
+int hc12Radio::getComChannel( int how )
 {
     int retVal = HC12_ERR_OK;
-    uint32_t newBaud;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( !isCached( HC12_PARAM_FIELD_CHANNEL, how ) )
     {
-        if( isValidBaud( baud ) )
+        if( _currOpMode == HC12_OP_CMD_MODE )
         {
-            sprintf( _ioBuffer, HC12_CMD_SET_BAUD, baud );
-            _currentCommand = HC12_CMD_CODE_SET_BAUD;
+            hc12FormatCommand( HC12_CMD_CODE_GET_CHANNEL, 0, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_GET_CHANNEL;
             _commandStatus = HC12_CMD_STATUS_REQUEST;
             _responseArgs = 0;
 
             if( (retVal = sendRequest()) == E_OK )
             {
                 _commandStatus = HC12_CMD_STATUS_ACTIVE;
-                if( sscanf( _ioBuffer, HC12_RSP_SET_BAUD, 
-                             &newBaud ) == HC12_ARGS_RSP_SET_BAUD )
-                {
-                    if( baud == newBaud )
-                    {    
-                        _moduleParam.serialParam.baud = baud;
-                        retVal = HC12_ERR_OK;
-                    }
-                    else
-                    {
-                        retVal = HC12_ERR_FAIL;
-                    }
-                }
-                else
-                {
-                    retVal = HC12_ERR_ARGS;
-                }
             }
             else
             {
@@ -1524,75 +3092,41 @@ int hc12Radio::setBaud( uint32_t baud )
         }
         else
         {
-            retVal = HC12_ERR_BAUD;
+            retVal = HC12_ERR_OP_MODE;
         }
     }
-    else
-    {
-        retVal = HC12_ERR_OP_MODE;
-    }
 
     return( retVal );
 }
 
-
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::setComChannel( int chan )
+ * int hc12Radio::getTTMode( int how )
  *
- * AT+Cxxx
- * Change wireless communication channel, selectable from 001 to 127 
- * (for wireless channels exceeding 100, the communication distance cannot 
- * be guaranteed). The default value for the wireless channel is 001, with 
- * a working frequency of 433.4MHz. The channel stepping is 400KHz, and 
- * the working frequency of channel100 is 473.0MHz.
- * e.g: To set the module to work on channel 21, send command “AT+C021” to the
- * module, and the module will return “OK+C021”. After exiting from command 
- * mode, the module will work on channel 21, with a working frequency of 
- * 441.4MHz.
- * Note: As the wireless receiving sensitivity of the HC-12 module is 
- * relatively high, when the serial port baud rate  greater than 9600bps 
- * five adjacent channels should be staggered for use. Even when the serial 
- * port baud rate is not greater than 9600bps, over short distances 
- * (less than 10m) also five adjacent channels should be staggered for use.
+ * Example 3:
+ * Send command “AT+RF” to the module, and if the module returns “OK+FU3” 
+ * it is confirmed that the module is working in serial port transparent 
+ * transmission mode FU3.
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::setComChannel( int chan )
+int hc12Radio::getTTMode( int how )
 {
     int retVal = HC12_ERR_OK;
-    int newChan;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( !isCached( HC12_PARAM_FIELD_TTMODE, how ) )
     {
-        if( isValidChannel( chan ) )
+        if( _currOpMode == HC12_OP_CMD_MODE )
         {
-            sprintf( _ioBuffer, HC12_CMD_SET_CHANNEL, chan );
-            _currentCommand = HC12_CMD_CODE_SET_CHANNEL;
+            hc12FormatCommand( HC12_CMD_CODE_GET_TTMODE, 0, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_GET_TTMODE;
             _commandStatus = HC12_CMD_STATUS_REQUEST;
             _responseArgs = 0;
 
             if( (retVal = sendRequest()) == E_OK )
             {
                 _commandStatus = HC12_CMD_STATUS_ACTIVE;
-                if( sscanf( _ioBuffer, HC12_RSP_SET_CHANNEL, 
-                             &newChan ) == HC12_ARGS_RSP_SET_CHANNEL )
-                {
-                    if( chan == newChan )
-                    {    
-                        _moduleParam.comChannel = chan;
-                        retVal = HC12_ERR_OK;
-                    }
-                    else
-                    {
-                        retVal = HC12_ERR_FAIL;
-                    }
-                }
-                else
-                {
-                    retVal = HC12_ERR_ARGS;
-                }
             }
             else
             {
@@ -1601,67 +3135,41 @@ int hc12Radio::setComChannel( int chan )
         }
         else
         {
-            retVal = HC12_ERR_CHANNEL;
+            retVal = HC12_ERR_OP_MODE;
         }
-}
-    else
-    {
-        retVal = HC12_ERR_OP_MODE;
     }
 
     return( retVal );
 }
 
-
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::setTTMode( int mode )
+ * int hc12Radio::getTPower( int how )
  *
- * AT+FUx
- * Change the serial port transparent transmission mode of the module. 
- * Four modes are available, namely FU1, FU2, FU3, and FU4. Only when the 
- * serial port speed, channel, and transparent transmission mode of two 
- * modules is set to be the same, can normal wireless communications occur. 
- * e.g: Send command “AT+FU1” to the module, and the module returns “OK+FU1”.
+ * Example 4:
+ * Send command “AT+RP” to the module, and if the module returns “OK+RP:+20dBm”
+ * it is confirmed that the transmitting power of module is set to 
+ * 20dBm (100mW).
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::setTTMode( int mode )
+int hc12Radio::getTPower( int how )
 {
     int retVal = HC12_ERR_OK;
-    int newTTMode;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( !isCached( HC12_PARAM_FIELD_POWER, how ) )
     {
-        if( isValidTTMode( mode ) )
+        if( _currOpMode == HC12_OP_CMD_MODE )
         {
-            sprintf( _ioBuffer, HC12_CMD_SET_TTMODE, mode );
-            _currentCommand = HC12_CMD_CODE_SET_TTMODE;
+            hc12FormatCommand( HC12_CMD_CODE_GET_POWER, 0, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_GET_POWER;
             _commandStatus = HC12_CMD_STATUS_REQUEST;
             _responseArgs = 0;
 
-
             if( (retVal = sendRequest()) == E_OK )
             {
                 _commandStatus = HC12_CMD_STATUS_ACTIVE;
-                if( sscanf( _ioBuffer, HC12_RSP_SET_TTMODE, 
-                             &newTTMode ) == HC12_ARGS_RSP_SET_TTMODE )
-                {
-                    if( mode == newTTMode )
-                    {    
-                        _moduleParam.ttMode = mode;
-                        retVal = HC12_ERR_OK;
-                    }
-                    else
-                    {
-                        retVal = HC12_ERR_FAIL;
-                    }
-                }
-                else
-                {
-                    retVal = HC12_ERR_ARGS;
-                }
             }
             else
             {
@@ -1670,12 +3178,8 @@ int hc12Radio::setTTMode( int mode )
         }
         else
         {
-            retVal = HC12_ERR_TTMODE;
+            retVal = HC12_ERR_OP_MODE;
         }
-}
-    else
-    {
-        retVal = HC12_ERR_OP_MODE;
     }
 
     return( retVal );
@@ -1683,65 +3187,38 @@ int hc12Radio::setTTMode( int mode )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::setTPower( int power )
- *
- * AT+Px
- * Set the transmitting power of the module, with x selectable from 1 to 8. 
- * The corresponding transmitting power of the module is as shown below:
- *
- *  +---------------+------+-----+-----+-----+------+------+------+------+
- *  |   x value     |  1   |  2  |  3  |  4  |   5  |   6  |   7  |  8   |
- *  +---------------+------+-----+-----+-----+------+------+------+------+
- *  |Transmitting   |-1 dBm|2 dBm|5 dBm|8 dBm|11 dBm|14 dBm|17 dBm|20 dBm|
- *  |power of module| 0.8mW|1.6mW|3.2mW|6.3mW| 12mW | 25mW | 50mW | 100mW|
- *  +---------------+------+-----+-----+-----+------+------+------+------+
+ * int hc12Radio::getParam( int how )
  *
- * The default value is 8, and the higher the transmitting power, the farther
- * the possible wireless communication distance. When the transmitting power 
- * level is set to 1, the transmitting power is at the minimum. Generally 
- * speaking, every time the transmitting power is reduced by 6dB, the 
- * communication distance will be reduced by half.
- * e.g: Send command “AT+P5” to the module, and the module returns “OK+P5”.
- * After exiting from command mode, the transmitting power of the module 
- * will be set to 11dBm.
+ * AT+RX
+ * Obtain all parameters from the module. Returns serial port transparent
+ * transmission mode, serial port baud rate, communication channel, and
+ * transmitting power in that order.
+ * e.g: Send command “AT+RX” to the module, and the module returns 
+ * “OK+FU3\r\nOK+B9600\r\n OK+C001\r\n OK+RP:+20dBm\r\n”. 
+ * (“\r\n” means return\newline)
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::setTPower( int power )
+int hc12Radio::getParam( int how )
 {
     int retVal = HC12_ERR_OK;
-    int newPower;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( !( isCached( HC12_PARAM_FIELD_BAUD, how ) &&
+           isCached( HC12_PARAM_FIELD_CHANNEL, how ) &&
+           isCached( HC12_PARAM_FIELD_TTMODE, how ) &&
+           isCached( HC12_PARAM_FIELD_POWER, how ) ) )
     {
-        if( isValidPower( power ) )
+        if( _currOpMode == HC12_OP_CMD_MODE )
         {
-            sprintf( _ioBuffer, HC12_CMD_SET_POWER, power );
-            _currentCommand = HC12_CMD_CODE_SET_POWER;
+            hc12FormatCommand( HC12_CMD_CODE_GET_PARAM, 0, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_GET_PARAM;
             _commandStatus = HC12_CMD_STATUS_REQUEST;
             _responseArgs = 0;
 
             if( (retVal = sendRequest()) == E_OK )
             {
                 _commandStatus = HC12_CMD_STATUS_ACTIVE;
-                if( sscanf( _ioBuffer, HC12_RSP_SET_POWER, 
-                             &newPower ) == HC12_ARGS_RSP_SET_POWER )
-                {
-                    if( power == newPower )
-                    {    
-                        _moduleParam.power = power;
-                        retVal = HC12_ERR_OK;
-                    }
-                    else
-                    {
-                        retVal = HC12_ERR_FAIL;
-                    }
-                }
-                else
-                {
-                    retVal = HC12_ERR_ARGS;
-                }
             }
             else
             {
@@ -1750,12 +3227,8 @@ int hc12Radio::setTPower( int power )
         }
         else
         {
-            retVal = HC12_ERR_POWER;
+            retVal = HC12_ERR_OP_MODE;
         }
-}
-    else
-    {
-        retVal = HC12_ERR_OP_MODE;
     }
 
     return( retVal );
@@ -1763,115 +3236,76 @@ int hc12Radio::setTPower( int power )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::setParam( struct _hc12_param* pParam )
+ * int hc12Radio::getSerialParam( int *databits, char *parity, int *stopbits );
  *
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::setParam( struct _hc12_param* pParam )
+int hc12Radio::getSerialParam( int *databits, char *parity, int *stopbits )
 {
     int retVal = HC12_ERR_OK;
-// HC12_CMD_SET_PARAM
-// HC12_RSP_SET_PARAM
-// HC12_ARGS_RSP_SET_PARAM
-// TODO
 
-    _currentCommand = HC12_CMD_CODE_SET_PARAM;
+    _currentCommand = HC12_CMD_CODE_GET_SERIAL;
     _commandStatus = HC12_CMD_STATUS_REQUEST;
-            _responseArgs = 0;
+    _responseArgs = 0;
+
+    if( ( databits != NULL ) && ( parity != NULL ) && ( stopbits != NULL ) )
+    {
+        retVal = HC12_ERR_OK;
+
+        *databits = _moduleParam.serialParam.databit;
+        *parity = _moduleParam.serialParam.parity;
+        *stopbits = _moduleParam.serialParam.stopbits;
+        _commandStatus = HC12_CMD_STATUS_DONE;
+        _currentCommand = HC12_CMD_CODE_NULL;
+    }
+    else
+    {
+        retVal = HC12_ERR_NULLP;
+    }
+
     return( retVal );
 }
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::setSerialParam( int databits, char parity, int stopbits )
+ * int hc12Radio::getFWVersion( int how )
  *
- * AT+Udps
- * Set data bits (d), parity (p), and stop bits (s) for serial port 
- * communication. For parity, N means none, O means odd check, and E means 
- * even check. For stop bits, 1 means one stop bit, 2 means two stop bits, 
- * and 3 means 1.5 stop bits.
- * e.g: To set the serial port format to eight data bits, odd parity, and 
- * one stop bit, send command “AT+U8O1” to the module. 
- * The module will return “OK+U8O1”.
+ * AT+V
+ * Request firmware version information from the module.
+ * e.g: Send command “AT+V” to the module, and the module returns “HC-12_V2.3”.
  *
  * return HC12_ERR_OK on succes, otherwise an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::setSerialParam( int databits, char parity, int stopbits )
+int hc12Radio::getFWVersion( int how )
 {
     int retVal = HC12_ERR_OK;
-    int newDatabits; 
-    char newParity;
-    int newStopbits;
-
-    if( _currOpMode == HC12_OP_CMD_MODE )
-    {
-        if( isValidDatabits( databits ) )
-        {
-            if( isValidParity( parity ) )
-            {
-                if( isValidStopbits( stopbits ) )
-                {
-                    sprintf( _ioBuffer, HC12_CMD_SET_SERIAL, databits, 
-                             parity, stopbits );
-
-                    _currentCommand = HC12_CMD_CODE_SET_SERIAL;
-                    _commandStatus = HC12_CMD_STATUS_REQUEST;
-                    _responseArgs = 0;
-
-                    if( (retVal = sendRequest()) == E_OK )
-                    {
-                        _commandStatus = HC12_CMD_STATUS_ACTIVE;
 
-                        if( sscanf( _ioBuffer, HC12_RSP_SET_SERIAL, 
-                                   &newDatabits, &newParity, &newStopbits ) == 
-                                   HC12_ARGS_RSP_SET_SERIAL )
-                        {
-                            if( ( databits == newDatabits ) &&
-                                ( parity == newParity ) &&
-                                ( stopbits == newStopbits ) )
-                            {    
-                                _moduleParam.serialParam.databit = databits;
-                                _moduleParam.serialParam.parity = parity;
-                                _moduleParam.serialParam.stopbits = stopbits;
-                                retVal = HC12_ERR_OK;
-                            }
-                            else
-                            {
-                                retVal = HC12_ERR_FAIL;
-                            }
-                        }
-                        else
-                        {
-                            retVal = HC12_ERR_ARGS;
-                        }
-                    }
-                    else
-                    {
-                        _commandStatus = HC12_CMD_STATUS_FAILED;
-                    }
-                }
-                else
-                {
-                    retVal = HC12_ERR_STOPBITS;
-                }
+    if( !isCached( HC12_PARAM_FIELD_VERSION, how ) )
+    {
+        if( _currOpMode == HC12_OP_CMD_MODE )
+        {
+            hc12FormatCommand( HC12_CMD_CODE_GET_VERSION, 0, _ioBuffer );
+            _currentCommand = HC12_CMD_CODE_GET_VERSION;
+            _commandStatus = HC12_CMD_STATUS_REQUEST;
+            _responseArgs = 0;
+
+            if( (retVal = sendRequest()) == E_OK )
+            {
+                _commandStatus = HC12_CMD_STATUS_ACTIVE;
             }
             else
             {
-                retVal = HC12_ERR_PARITY;
+                _commandStatus = HC12_CMD_STATUS_FAILED;
             }
         }
         else
         {
-            retVal = HC12_ERR_DATABITS;
+            retVal = HC12_ERR_OP_MODE;
         }
     }
-    else
-    {
-        retVal = HC12_ERR_OP_MODE;
-    }
 
     return( retVal );
 }
@@ -1879,48 +3313,79 @@ int hc12Radio::setSerialParam( int databits, char parity, int stopbits )
 
 /* ****************************************************************************
  *
- * AT+Ry
- * Obtain a single parameter from the module, where y is any letter among B, 
- * C, F, and P, respectively representing: baud rate, communication channel, 
- * serial port transparent transmission mode, and transmitting power.
+ * transparent transmission mode
+ * After leaving command mode everything written to the serial port is sent
+ * over the air and everything received over the air shows up on the serial
+ * port. Data is staged in the TX and RX rings, so callers may hand over
+ * arbitrary sized chunks and the wire is accessed with as few calls as
+ * possible.
  *
  * ****************************************************************************
 */
 
 /* 
  ------------------------------------------------------------------------------
- * uint32_t hc12Radio::getBaud( void )
+ * void hc12Radio::configurePacer( void )
  *
- * Example 1:
- * Send command “AT+RB” to the module, and if the module returns “OK+B9600” 
- * it is confirmed that the serial port baud rate of the module is 9600bps.
+ * rate model of the pacer from the current module settings
+ ------------------------------------------------------------------------------
+*/
+void hc12Radio::configurePacer( void )
+{
+    struct _hc12_serial_param *pSerial = &_moduleParam.serialParam;
+
+    _pacer.configure( _moduleParam.ttMode, _linkBaud,
+                      1 + pSerial->databit + pSerial->stopbits +
+                      (pSerial->parity == HC12_PARITY_NONE ? 0 : 1) );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::drainTx( void )
  *
- * return HC12_ERR_OK on succes, otherwise an error code
+ * write the TX ring out completely. With pacing this takes as long as
+ * the module needs to send it, in FU4 about 2 s per air packet.
+ *
+ * return HC12_ERR_OK if the ring is empty, HC12_ERR_TIMEOUT if the line
+ * took nothing for HC12_TX_STALL_MS, otherwise the error of the write.
+ * The data not written stays queued.
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getBaud( void )
+int hc12Radio::drainTx( void )
 {
     int retVal = HC12_ERR_OK;
+    uint32_t lastMs = hc12NowMs();
+    uint32_t delay;
+    size_t len;
+    int written;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    while( retVal == HC12_ERR_OK && (len = _txRing.used()) > 0 )
     {
-        sprintf( _ioBuffer, HC12_CMD_GET_BAUD );
-        _currentCommand = HC12_CMD_CODE_GET_BAUD;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
-
-        if( (retVal = sendRequest()) == E_OK )
+        if( (written = flush()) > 0 )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            lastMs = hc12NowMs();
         }
-        else
+        else if( written < 0 )
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
+            retVal = written;
+        }
+        else if( _txRing.used() > 0 )
+        {
+            delay = _pacer.delayUs( len < HC12_AIR_PACKET_BYTES ?
+                                    len : HC12_AIR_PACKET_BYTES );
+            if( delay > 0 )
+            {
+                hc12SleepMs( (delay + 999) / 1000 );
+            }
+            else if( hc12NowMs() - lastMs >= HC12_TX_STALL_MS )
+            {
+                retVal = HC12_ERR_TIMEOUT;
+            }
+            else
+            {
+                hc12SleepMs( 1 );
+            }
         }
-    }
-    else
-    {
-        retVal = HC12_ERR_OP_MODE;
     }
 
     return( retVal );
@@ -1928,38 +3393,52 @@ int hc12Radio::getBaud( void )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::getComChannel( void )
+ * int hc12Radio::flush( void )
  *
- * Example 2:
- * Send command “AT+RC” to the module, and if the module returns “OK+RC001” 
- * it is confirmed that the communication channel of the module is 001.
- *
- * return HC12_ERR_OK on succes, otherwise an error code
+ * write pending data of the TX ring to the serial port, as much as the
+ * pacer allows
+ * returns the amount of bytes written or an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getComChannel( void )
+int hc12Radio::flush( void )
 {
-    int retVal = HC12_ERR_OK;
+    int retVal = 0;
+    int written;
+    size_t len;
+    size_t allowed;
+    const uint8_t *pData;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( _pTransport != NULL )
     {
-        sprintf( _ioBuffer, HC12_CMD_GET_CHANNEL );
-        _currentCommand = HC12_CMD_CODE_GET_CHANNEL;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
+        allowed = _pacer.allowance();
 
-        if( (retVal = sendRequest()) == E_OK )
-        {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
-        }
-        else
+        while( allowed > 0 && (len = _txRing.peek( &pData )) > 0 )
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
+            if( len > allowed )
+            {
+                len = allowed;
+            }
+
+            if( (written = _pTransport->write( (const char*) pData, len )) > 0 )
+            {
+                _txRing.consume( written );
+                _pacer.spend( written );
+                allowed -= written;
+                retVal += written;
+            }
+            else
+            {
+                if( retVal == 0 )
+                {
+                    retVal = written;
+                }
+                break;
+            }
         }
     }
     else
     {
-        retVal = HC12_ERR_OP_MODE;
+        retVal = E_NULL_CONNECTION;
     }
 
     return( retVal );
@@ -1967,39 +3446,81 @@ int hc12Radio::getComChannel( void )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::getTTMode( void )
- *
- * Example 3:
- * Send command “AT+RF” to the module, and if the module returns “OK+FU3” 
- * it is confirmed that the module is working in serial port transparent 
- * transmission mode FU3.
+ * int hc12Radio::readAvailable( char *pData, int len )
  *
- * return HC12_ERR_OK on succes, otherwise an error code
+ * read what is waiting on the transport without blocking, from the
+ * ring of the reader thread if it runs
+ * returns the amount of bytes read, E_BUFSPACE if len bytes were read,
+ * or an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getTTMode( void )
+int hc12Radio::readAvailable( char *pData, int len )
 {
-    int retVal = HC12_ERR_OK;
+    int retVal;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+#if defined(__linux__)
+    if( readerRunning() )
     {
-        sprintf( _ioBuffer, HC12_CMD_GET_TTMODE );
-        _currentCommand = HC12_CMD_CODE_GET_TTMODE;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
-
-        if( (retVal = sendRequest()) == E_OK )
+        retVal = _rxSpsc.read( pData, len, &_rxStamp );
+        if( retVal == 0 )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            retVal = E_READ_TIMEOUT;
         }
-        else
+    }
+    else
+#endif // defined(__linux__)
+    {
+        retVal = _pTransport->read( pData, len, 0 );
+    }
+
+    if( retVal == len )
+    {
+        retVal = E_BUFSPACE;
+    }
+
+    return( retVal );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::poll( void )
+ *
+ * move data waiting on the serial port into the RX ring
+ * returns the amount of bytes stored or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Radio::poll( void )
+{
+    int retVal = 0;
+    int received = E_BUFSPACE;
+    size_t len;
+    uint8_t *pData;
+
+    if( _pTransport != NULL )
+    {
+        while( received == E_BUFSPACE && (len = _rxRing.reserve( &pData )) > 0 )
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
+            received = readAvailable( (char*) pData, len );
+
+            if( received == E_BUFSPACE )
+            {
+                // buffer filled completely, there may be more
+                _rxRing.commit( len );
+                retVal += len;
+            }
+            else
+            {
+                if( received > 0 )
+                {
+                    _rxRing.commit( received );
+                    retVal += received;
+                }
+            }
         }
     }
     else
     {
-        retVal = HC12_ERR_OP_MODE;
+        retVal = E_NULL_CONNECTION;
     }
 
     return( retVal );
@@ -2007,116 +3528,199 @@ int hc12Radio::getTTMode( void )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::getTPower( void )
+ * size_t hc12Radio::available( void )
  *
- * Example 4:
- * Send command “AT+RP” to the module, and if the module returns “OK+RP:+20dBm”
- * it is confirmed that the transmitting power of module is set to 
- * 20dBm (100mW).
+ * returns the amount of bytes waiting in the RX ring
+ ------------------------------------------------------------------------------
+*/
+size_t hc12Radio::available( void )
+{
+    return( _rxRing.used() );
+}
+
+#if defined(__linux__)
+/* 
+ ------------------------------------------------------------------------------
+ * int hc12Radio::startReader( void )
  *
- * return HC12_ERR_OK on succes, otherwise an error code
+ * start a thread that moves everything arriving on the serial port into
+ * a lock-free ring, each chunk tagged with its arrival time. From then
+ * on readChunk() and readAvailable() take their data from that ring and
+ * never enter the kernel while data is waiting.
+ * Needs the device descriptor, i.e. a successful connect().
+ * returns HC12_ERR_OK on success, otherwise HC12_ERR_FAIL
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getTPower( void )
+int hc12Radio::startReader( void )
 {
     int retVal = HC12_ERR_OK;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( !readerRunning() )
     {
-        sprintf( _ioBuffer, HC12_CMD_GET_POWER );
-        _currentCommand = HC12_CMD_CODE_GET_POWER;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
-
-        if( (retVal = sendRequest()) == E_OK )
+        if( _moduleParam.serialParam.dev_fd < 0 || _rxSpsc.open() != 0 ||
+            (_readerStopFd = eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC )) < 0 )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            _readerStopFd = -1;
+            retVal = HC12_ERR_FAIL;
         }
         else
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
+            _rxSpsc.clear();
+            _readerError.store( HC12_ERR_OK );
+            _readerRun.store( true );
+
+            if( pthread_create( &_reader, NULL, readerThread, this ) != 0 )
+            {
+                _readerRun.store( false );
+                close( _readerStopFd );
+                _readerStopFd = -1;
+                retVal = HC12_ERR_FAIL;
+            }
         }
     }
-    else
-    {
-        retVal = HC12_ERR_OP_MODE;
-    }
 
     return( retVal );
 }
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::getParam( struct _hc12_param* pParam )
- *
- * AT+RX
- * Obtain all parameters from the module. Returns serial port transparent
- * transmission mode, serial port baud rate, communication channel, and
- * transmitting power in that order.
- * e.g: Send command “AT+RX” to the module, and the module returns 
- * “OK+FU3\r\nOK+B9600\r\n OK+C001\r\n OK+RP:+20dBm\r\n”. 
- * (“\r\n” means return\newline)
+ * int hc12Radio::stopReader( void )
  *
- * return HC12_ERR_OK on succes, otherwise an error code
+ * stop the reader thread, data left in its ring is dropped
+ * returns HC12_ERR_OK
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getParam( void )
+int hc12Radio::stopReader( void )
 {
-    int retVal = HC12_ERR_OK;
+    uint64_t one = 1;
 
-    if( _currOpMode == HC12_OP_CMD_MODE )
+    if( readerRunning() )
     {
-        sprintf( _ioBuffer, HC12_CMD_GET_PARAM );
-        _currentCommand = HC12_CMD_CODE_GET_PARAM;
-        _commandStatus = HC12_CMD_STATUS_REQUEST;
-        _responseArgs = 0;
+        _readerRun.store( false );
+        if( write( _readerStopFd, &one, sizeof(one) ) < 0 )
+        {
+            ; // the thread sees the flag within its poll timeout
+        }
+        pthread_join( _reader, NULL );
+        close( _readerStopFd );
+        _readerStopFd = -1;
+        _rxSpsc.clear();
+    }
 
-        if( (retVal = sendRequest()) == E_OK )
+    return( HC12_ERR_OK );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * void* hc12Radio::readerThread( void *pArg )
+ ------------------------------------------------------------------------------
+*/
+void* hc12Radio::readerThread( void *pArg )
+{
+    ((hc12Radio*) pArg)->readerLoop();
+
+    return( NULL );
+}
+
+/* 
+ ------------------------------------------------------------------------------
+ * void hc12Radio::readerLoop( void )
+ *
+ * producer side of _rxSpsc. If the application does not keep up, the
+ * ring runs full; the overrun is counted and the thread backs off for
+ * a millisecond, the kernel buffers the bytes meanwhile.
+ * A line that hangs up (e.g. an unplugged USB adapter) keeps poll()
+ * returning at once, the thread records HC12_ERR_FAIL in readerError()
+ * and ends. stopReader() has to be called anyway.
+ ------------------------------------------------------------------------------
+*/
+void hc12Radio::readerLoop( void )
+{
+    struct pollfd pfd[2];
+    uint8_t *pData;
+    size_t space;
+    ssize_t received;
+    bool dead = false;
+
+    pfd[0].fd = _moduleParam.serialParam.dev_fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = _readerStopFd;
+    pfd[1].events = POLLIN;
+
+    while( _readerRun.load( std::memory_order_relaxed ) && !dead )
+    {
+        pfd[0].revents = pfd[1].revents = 0;
+
+        if( ::poll( pfd, 2, HC12_READER_POLL_MS ) > 0 &&
+            (pfd[0].revents & POLLIN) )
         {
-            _commandStatus = HC12_CMD_STATUS_ACTIVE;
+            if( (space = _rxSpsc.reserve( &pData )) == 0 )
+            {
+                _rxSpsc.overrun();
+                usleep( 1000 );
+            }
+            else if( (received = ::read( pfd[0].fd, pData, space )) > 0 )
+            {
+                _rxSpsc.commit( received, hc12SpscRing::now() );
+            }
+            else
+            {
+                // readable but no data is end of file
+                dead = received == 0 || (errno != EAGAIN && errno != EINTR);
+            }
         }
-        else
+        else if( pfd[0].revents & (POLLERR|POLLHUP|POLLNVAL) )
         {
-            _commandStatus = HC12_CMD_STATUS_FAILED;
+            // data still waiting is read first, see above
+            dead = true;
         }
     }
-    else
+
+    if( dead )
     {
-        retVal = HC12_ERR_OP_MODE;
+        _readerError.store( HC12_ERR_FAIL );
     }
-
-    return( retVal );
 }
+#endif // defined(__linux__)
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::getSerialParam( int *databits, char *parity, int *stopbits );
+ * int hc12Radio::send( const void *pData, size_t len )
  *
+ * queue len bytes for transmission and push as much as possible to the
+ * serial port. Data that does not fit into the TX ring is not accepted.
  *
- * return HC12_ERR_OK on succes, otherwise an error code
+ * returns the amount of bytes accepted or an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getSerialParam( int *databits, char *parity, int *stopbits )
+int hc12Radio::send( const void *pData, size_t len )
 {
     int retVal = HC12_ERR_OK;
+    const uint8_t *pSrc = (const uint8_t*) pData;
+    size_t done = 0;
 
-    _currentCommand = HC12_CMD_CODE_GET_SERIAL;
-    _commandStatus = HC12_CMD_STATUS_REQUEST;
-    _responseArgs = 0;
-
-    if( ( databits != NULL ) && ( parity != NULL ) && ( stopbits != NULL ) )
+    if( _currOpMode == HC12_OP_TT_MODE )
     {
-        retVal = HC12_ERR_OK;
+        if( pData != NULL )
+        {
+            do
+            {
+                done += _txRing.write( &pSrc[done], len - done );
+            } while( done < len && flush() > 0 );
 
-        *databits = _moduleParam.serialParam.databit;
-        *parity = _moduleParam.serialParam.parity;
-        *stopbits = _moduleParam.serialParam.stopbits;
-        _commandStatus = HC12_CMD_STATUS_DONE;
-        _currentCommand = HC12_CMD_CODE_NULL;
+            if( (retVal = flush()) >= 0 || done > 0 )
+            {
+                retVal = done;
+            }
+        }
+        else
+        {
+            retVal = HC12_ERR_NULLP;
+        }
     }
     else
     {
-        retVal = HC12_ERR_NULLP;
+        retVal = HC12_ERR_OP_MODE;
     }
 
     return( retVal );
@@ -2124,39 +3728,37 @@ int hc12Radio::getSerialParam( int *databits, char *parity, int *stopbits )
 
 /* 
  ------------------------------------------------------------------------------
- * int hc12Radio::getFWVersion( void )
+ * int hc12Radio::receive( void *pData, size_t len )
  *
- * AT+V
- * Request firmware version information from the module.
- * e.g: Send command “AT+V” to the module, and the module returns “HC-12_V2.3”.
+ * fetch up to len bytes received over the air
  *
- * return HC12_ERR_OK on succes, otherwise an error code
+ * returns the amount of bytes copied or an error code
  ------------------------------------------------------------------------------
 */
-int hc12Radio::getFWVersion( void )
+int hc12Radio::receive( void *pData, size_t len )
 {
     int retVal = HC12_ERR_OK;
 
-        if( _currOpMode == HC12_OP_CMD_MODE )
+    if( _currOpMode == HC12_OP_TT_MODE )
+    {
+        if( pData != NULL )
         {
-            sprintf( _ioBuffer, HC12_CMD_GET_VERSION );
-            _currentCommand = HC12_CMD_CODE_GET_VERSION;
-            _commandStatus = HC12_CMD_STATUS_REQUEST;
-            _responseArgs = 0;
-
-            if( (retVal = sendRequest()) == E_OK )
-            {
-                _commandStatus = HC12_CMD_STATUS_ACTIVE;
-            }
-            else
+            if( _rxRing.used() < len )
             {
-                _commandStatus = HC12_CMD_STATUS_FAILED;
+                poll();
             }
+
+            retVal = _rxRing.read( pData, len );
         }
         else
         {
-            retVal = HC12_ERR_OP_MODE;
+            retVal = HC12_ERR_NULLP;
         }
+    }
+    else
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
 
     return( retVal );
 }
@@ -24,6 +24,15 @@
 #define _HC12_RADIO_H_
 
 #include "serialConnection.h"
+#include "hc12RingBuffer.h"
+#include "hc12Parser.h"
+#include "hc12Command.h"
+#include "hc12Gpio.h"
+#include "hc12Transport.h"
+#include "hc12Log.h"
+#include "hc12Stats.h"
+#include "hc12SpscRing.h"
+#include "hc12Pacer.h"
 
 #if defined(ARDUINO)
 
@@ -51,9 +60,7 @@
     #include <netinet/in.h>
     #include <netdb.h> 
     #include <getopt.h>
-#if defined(RASPBERRY)
-    #include <pigpio.h>
-#endif // defined(RASPBERRY)
+    #include <pthread.h>
 
 #endif // defined( __linux__ )
 
@@ -79,6 +86,7 @@ using namespace std;
 #define HC12_ERR_ARGS              -3
 #define HC12_ERR_OP_MODE           -4
 #define HC12_ERR_NULLP             -5
+#define HC12_ERR_TIMEOUT           -6
 
 #define HC12_ERR_BAUD             -10
 #define HC12_ERR_PARITY           -11
@@ -91,14 +99,13 @@ using namespace std;
 #define HC12_ERR_RANGE            -18
 
 #define HC12_ERR_INIT_PIGPIO      -30
+#define HC12_ERR_GPIO             -31
 
 #if defined(ARDUINO)
     #define IO_BUFFER_SIZE         64
-    #define LOG_BUFFER_SIZE        60
 #else // NOT on Arduino platform
 //    #define IO_BUFFER_SIZE        128
     #define IO_BUFFER_SIZE         64
-    #define LOG_BUFFER_SIZE       120
 #endif // defined(ARDUINO)
 
 #define HC12_INTERFACE_HW           2
@@ -170,6 +177,19 @@ using namespace std;
 #define HC12_OP_MNU_MODE            2
 #define HC12_OP_TT_MODE             3
 
+// time the module needs after the SET pin changed, in ms
+#define HC12_SETTLE_CMD_MS         60
+#define HC12_SETTLE_TT_MS         100
+
+// fast switch to command mode: AT is probed back to back, starting at
+// the settle time learned so far. A probe sent too early goes out over
+// the air as data, so the learned time creeps down only, never below a
+// time that went unanswered before.
+#define HC12_SETTLE_PROBE_MIN_MS   10
+#define HC12_SETTLE_PROBE_MAX_MS  150
+#define HC12_SETTLE_PROBE_CHARS     8    // AT\n and OK\r\n, in char times
+#define HC12_SETTLE_PROBE_SLACK_MS 15    // the module takes ~12 ms for AT
+
 #define HC12_DEFAULT_SET_PIN       HC12_NULLPIN
 #define HC12_DEFAULT_POW_PIN       HC12_NULLPIN
 
@@ -190,78 +210,32 @@ using namespace std;
 #define HC12_DEFAULT_INTERFACE     HC12_INTERFACE_SW
 #define HC12_DEFAULT_OPMODE        HC12_OP_TT_MODE
 
-#define HC12_CMD_CODE_NULL         0
-#define HC12_CMD_CODE_TEST         20
-#define HC12_CMD_TEST              "AT\n"
-#define HC12_RSP_TEST              "OK"
-#define HC12_ARGS_RSP_TEST          0
-#define HC12_CMD_CODE_SET_DEFAULT  21
-#define HC12_CMD_SET_DEFAULT       "AT+DEFAULT\n"
-#define HC12_RSP_SET_DEFAULT       "OK+DEFAULT"
-#define HC12_ARGS_RSP_SET_DEFAULT   0
-#define HC12_CMD_CODE_SLEEP        22
-#define HC12_CMD_SLEEP             "AT+SLEEP\n"
-#define HC12_RSP_SLEEP             "OK+SLEEP"
-#define HC12_ARGS_RSP_SLEEP         0
-#define HC12_CMD_CODE_UPDATE       23
-#define HC12_CMD_UPDATE            "AT+UPDATE\n"
-#define HC12_RSP_UPDATE            ""
-#define HC12_ARGS_RSP_UPDATE        0
-#define HC12_CMD_CODE_SET_BAUD     24
-#define HC12_CMD_SET_BAUD          "AT+B%u\n"
-#define HC12_RSP_SET_BAUD          "OK+B%u"
-#define HC12_ARGS_RSP_SET_BAUD      1
-#define HC12_CMD_CODE_SET_CHANNEL  25
-#define HC12_CMD_SET_CHANNEL       "AT+C%03d\n"
-#define HC12_RSP_SET_CHANNEL       "OK+C%03d"
-#define HC12_ARGS_RSP_SET_CHANNEL   1
-#define HC12_CMD_CODE_SET_TTMODE   26
-#define HC12_CMD_SET_TTMODE        "AT+FU%d\n"
-#define HC12_RSP_SET_TTMODE        "OK+FU%d"
-#define HC12_ARGS_RSP_SET_TTMODE    1
-#define HC12_CMD_CODE_SET_POWER    27
-#define HC12_CMD_SET_POWER         "AT+P%d\n"
-#define HC12_RSP_SET_POWER         "OK+P%d"
-#define HC12_ARGS_RSP_SET_POWER     1
-#define HC12_CMD_CODE_SET_PARAM    28
-#define HC12_CMD_SET_PARAM         "AT+DEFAULT\n"
-#define HC12_RSP_SET_PARAM         "OK+DEFAULT"
-#define HC12_ARGS_RSP_SET_PARAM     0
-#define HC12_CMD_CODE_SET_SERIAL   29
-#define HC12_CMD_SET_SERIAL        "AT+U%d%c%d\n"
-#define HC12_RSP_SET_SERIAL        "OK+U%d%c%d"
-#define HC12_ARGS_RSP_SET_SERIAL    3
-#define HC12_CMD_CODE_GET_BAUD     30
-#define HC12_CMD_GET_BAUD          "AT+RB\n"
-#define HC12_RSP_GET_BAUD          "OK+B%u"
-#define HC12_ARGS_RSP_GET_BAUD      1
-#define HC12_CMD_CODE_GET_CHANNEL  31
-#define HC12_CMD_GET_CHANNEL       "AT+RC\n"
-#define HC12_RSP_GET_CHANNEL       "OK+RC%d"
-#define HC12_ARGS_RSP_GET_CHANNEL   1
-#define HC12_CMD_CODE_GET_TTMODE   32
-#define HC12_CMD_GET_TTMODE        "AT+RF\n"
-#define HC12_RSP_GET_TTMODE        "OK+FU%d"
-#define HC12_ARGS_RSP_GET_TTMODE    1
-#define HC12_CMD_CODE_GET_POWER    33
-#define HC12_CMD_GET_POWER         "AT+RP\n"
-#define HC12_RSP_GET_POWER         "OK+RP:%ddBm"
-#define HC12_ARGS_RSP_GET_POWER     1
-#define HC12_CMD_CODE_GET_PARAM    34
-#define HC12_CMD_GET_PARAM         "AT+RX\n"
-#define HC12_RSP_GET_PARAM         "OK+B%d\r\nOK+RC%d\r\nOK+RP:%ddBm\r\nOK+FU%d"
-#define HC12_ARGS_RSP_GET_PARAM     4
-#define HC12_CMD_CODE_GET_SERIAL   35
-#define HC12_CMD_GET_SERIAL        "AT+DEFAULT\n"
-#define HC12_RSP_GET_SERIAL        "OK+DEFAULT"
-#define HC12_ARGS_RSP_GET_SERIAL    0
-#define HC12_CMD_CODE_GET_VERSION  36
-#define HC12_CMD_GET_VERSION       "AT+V\n"
-#define HC12_RSP_GET_VERSION       "HC-12_V%c.%c"
-#define HC12_ARGS_RSP_GET_VERSION   2
+// commands, their replies and the parameter fields are in hc12Command.h
+
 // www.hc01.com  HC-12_V2.4
 // HC-12_V1.1
 
+// response completion: the reply is complete as soon as the expected
+// lines are in. Otherwise the first byte has to arrive within the
+// response timeout and the reply ends if the line stays idle for the
+// gap, given in character times at the current baud rate.
+#define HC12_RSP_TIMEOUT_MS       200
+#define HC12_IDLE_GAP_CHARS        16
+#define HC12_IDLE_GAP_MIN_MS       20
+
+// resync after a bad reply: input is thrown away until the line goes
+// idle, but for no longer than the deadline. Past the byte budget the
+// drain ends at the next line feed.
+#define HC12_DRAIN_MAX_MS          50
+#define HC12_DRAIN_MAX_BYTES      256
+
+// the reader thread rechecks its run flag at least this often
+#define HC12_READER_POLL_MS       100
+
+// before command mode the TX ring is written out, waiting for the
+// pacer. A line that takes nothing for this long ends the wait.
+#define HC12_TX_STALL_MS         1000
+
 #define HC12_CMD_STATUS_REQUEST     9
 #define HC12_CMD_STATUS_ACTIVE     90
 #define HC12_CMD_STATUS_DONE       99
@@ -272,6 +246,31 @@ using namespace std;
 #define HC12_DUMP_SERIAL_PARAM      1
 #define HC12_DUMP_FW_INFO           2
 #define HC12_DUMP_HC12_PARAM        3
+#define HC12_DUMP_PARAM_STATE       4
+#define HC12_DUMP_STATS             5
+#define HC12_DUMP_LOG               6
+
+// per field results of applyParam() besides the HC12_ERR_* codes
+#define HC12_PARAM_UNCHANGED        1
+#define HC12_PARAM_ROLLED_BACK      2
+
+// HC12_PARAM_FIELD_* see hc12Command.h
+#define HC12_PARAM_BIT(f)          (1 << (f))
+// fields reported by AT+RX
+#define HC12_PARAM_SEEN_RX         (HC12_PARAM_BIT(HC12_PARAM_FIELD_CHANNEL) | \
+                                    HC12_PARAM_BIT(HC12_PARAM_FIELD_POWER)   | \
+                                    HC12_PARAM_BIT(HC12_PARAM_FIELD_TTMODE)  | \
+                                    HC12_PARAM_BIT(HC12_PARAM_FIELD_BAUD))
+
+// state of a cached field
+#define HC12_PARAM_UNKNOWN          0
+#define HC12_PARAM_KNOWN            1
+#define HC12_PARAM_CONFIRMED        2
+
+// how getters use the cache
+#define HC12_READ_CACHED            0
+#define HC12_READ_CONFIRMED         1
+#define HC12_READ_REFRESH           2
 
 struct _hc12_serial_param {
 #if defined(__linux__)
@@ -311,6 +310,27 @@ struct _hc12_param {
     struct _hc12_fw_info hwInfo;
 };
 
+//
+// values collected from the response lines of the running command
+//
+struct _hc12_rsp_values {
+    uint32_t baud;
+    int channel;
+    int powerDB;
+    int ttMode;
+    int power;
+    char parity;
+    int stopbits;
+    int databits;
+    char major;
+    char minor;
+    uint8_t seen;
+};
+
+struct _hc12_param_result {
+    int field[HC12_PARAM_FIELDS];
+};
+
 struct _hc12_power {
 short pIndex;
 short dbm;
@@ -348,17 +368,80 @@ class hc12Radio {
 // SERIAL_5O1 _6O1 _7O1 _8O1
 // SERIAL_5O2 _6O2 _7O2 _8O2
 
-    int                _status;
-    int                _currentCommand;
-    int                _commandStatus;
-    int                _responseArgs;
-    serialConnection*  _connection;
+    // all command/response state is per instance, so radios driven
+    // from different threads do not interfere
+    int                _status = HC12_ERR_OK;
+    int                _currentCommand = HC12_CMD_CODE_NULL;
+    int                _commandStatus = HC12_CMD_STATUS_DONE;
+    int                _responseArgs = 0;
+    int                _responseLines = 0;
+    bool               _rspStarted = false;
+    int                _rspTimeout = HC12_RSP_TIMEOUT_MS;
+    int                _idleGapChars = HC12_IDLE_GAP_CHARS;
+    int                _drainMaxMs = HC12_DRAIN_MAX_MS;
+    int                _drainMaxBytes = HC12_DRAIN_MAX_BYTES;
+    uint32_t           _droppedBytes = 0;
+    uint32_t           _linkBaud = HC12_DEFAULT_BAUD;
+
+// instrumentation, time stamps in microseconds
+    hc12Stats          _stats;
+    uint32_t           _tWrite = 0;
+    uint32_t           _tFirst = 0;
+    uint32_t           _tModeSwitch = 0;
+
+// SET and power pin control, see setGpio() and enterCommandMode()
+    hc12Gpio          *_pGpio = NULL;
+    bool               _pinsRequested = false;
+    bool               _fastModeSwitch = true;
+    bool               _manualModeSwitch = false;
+    int                _settleLearned = HC12_SETTLE_CMD_MS;
+    int                _settleFloor = HC12_SETTLE_PROBE_MIN_MS - 1;
+
+// non-blocking command in flight, see startRequest()
+    bool               _nonBlocking = false;
+// replies to pipelined commands follow a bad one, see applyFields()
+    bool               _pipelined = false;
+    int                _requestCommand = HC12_CMD_CODE_NULL;
+    int                _requestArg = 0;
+    int                _requestLines = 0;
+    struct _hc12_rsp_values _rspValues;
+    hc12Transport     *_pTransport;
+    bool               _ownTransport;
 
     struct _hc12_param _moduleParam;
+    uint8_t            _paramState[HC12_PARAM_CACHED_FIELDS] = {
+                           HC12_PARAM_UNKNOWN, HC12_PARAM_UNKNOWN,
+                           HC12_PARAM_UNKNOWN, HC12_PARAM_UNKNOWN,
+                           HC12_PARAM_UNKNOWN, HC12_PARAM_UNKNOWN };
     int8_t             _interfaceType;
     int8_t             _currOpMode;
     char               _ioBuffer[IO_BUFFER_SIZE];
+    uint8_t            _ioPos = 0;
+    uint8_t            _ioLen = 0;
+    hc12Parser         _parser;
+
+// transparent mode data path
+    uint8_t            _txStorage[HC12_TX_RING_SIZE];
+    uint8_t            _rxStorage[HC12_RX_RING_SIZE];
+    hc12RingBuffer     _txRing{ _txStorage, HC12_TX_RING_SIZE };
+    hc12RingBuffer     _rxRing{ _rxStorage, HC12_RX_RING_SIZE };
+    hc12Pacer          _pacer;
 
+    void configurePacer( void );
+    int drainTx( void );
+
+#if defined(__linux__)
+// optional background reader, see startReader()
+    hc12SpscRing       _rxSpsc;
+    pthread_t          _reader;
+    std::atomic<bool>  _readerRun{ false };
+    int                _readerStopFd = -1;
+    std::atomic<int>   _readerError{ HC12_ERR_OK };
+    uint64_t           _rxStamp = 0;
+
+    static void* readerThread( void *pArg );
+    void readerLoop( void );
+#endif // defined(__linux__)
 
 
   public:
@@ -371,6 +454,12 @@ class hc12Radio {
     hc12Radio(int setPin = HC12_DEFAULT_SET_PIN,
               int powerPin = HC12_DEFAULT_POW_PIN);
 #endif // defined(ARDUINO)
+// any other line to the module, it stays with the caller
+    hc12Radio(hc12Transport *pTransport, int setPin = HC12_NULLPIN,
+              int powerPin = HC12_NULLPIN);
+    ~hc12Radio( void );
+
+    hc12Transport* transport( void ) { return( _pTransport ); }
 
 
     bool isValidBaud( uint32_t baud );
@@ -387,18 +476,68 @@ class hc12Radio {
 
     void dump( int what );
 
+    int expectedLines( int command );
+    int idleGap( void );
+    int readChunk( int timeoutMs );
+    int drainInput( void );
+    void setResponseTimeout( int ms ) { _rspTimeout = ms; }
+    void setIdleGap( int chars ) { _idleGapChars = chars; }
+    void setDrainLimits( int ms, int bytes )
+                          { _drainMaxMs = ms; _drainMaxBytes = bytes; }
+    uint32_t droppedBytes( void ) { return( _droppedBytes ); }
+    void recordCommand( int command, int readResult );
+    int getStats( struct _hc12_stats *pStats );
+    void resetStats( void );
     int getResponse( void );
     int parseResponse( void );
+    const struct _hc12_response* lastResponse( void ) 
+                                         { return( _parser.response() ); }
     short powerDB2Mode( int powerDB );
     short powerMode2DB( int power );
 
     int sendRequest( void );
+
+// non-blocking commands, the caller moves the bytes and keeps the time
+    int startRequest( int command, int arg = 0 );
+    int feedResponse( const char *pData, int len );
+    int expireRequest( void );
+    int finishRequest( int readResult );
+    bool requestPending( void ) { return( _nonBlocking ); }
+    int requestTimeout( void ) 
+                          { return( _rspStarted ? idleGap() : _rspTimeout ); }
+    int beginModeSwitch( int mode );
+    int endModeSwitch( int mode );
+    bool pinAutomated( void ) { return( _pGpio != NULL ); }
+    int setGpio( hc12Gpio *pGpio );
+    hc12Gpio* gpio( void ) { return( _pGpio ); }
+    int requestPins( void );
+    int writePin( int pin, int level );
+    int switchPower( bool on );
+    int probeCommandMode( void );
+    int relinkBaud( void );
+    void setFastModeSwitch( bool on ) { _fastModeSwitch = on; }
+// without GPIO backend the user moves the SET pin, enterCommandMode()
+// and leaveCommandMode() ask on stdout
+    void setManualModeSwitch( bool on ) { _manualModeSwitch = on; }
+    int settleTime( void ) { return( _settleLearned ); }
+    int opMode( void ) { return( _currOpMode ); }
+#if defined(__linux__)
+    int deviceFd( void ) { return( _moduleParam.serialParam.dev_fd ); }
+#endif // defined(__linux__)
+    int formatSetCommand( int field, int value, char *pBuffer );
+    int getParamField( int field );
+    int applyFields( const int *pFields, const int *pValues, int count,
+                     int *pResults );
     int connect( struct _hc12_serial_param *pParam );
     int disconnect( void );
 
     void init( void );
     void reset( void );
 
+    bool isCached( int field, int how );
+    int getParamState( int field );
+    int getCachedParam( struct _hc12_param* pParam );
+
     int enterCommandMode( void );
     int leaveCommandMode( void );
 
@@ -413,22 +552,54 @@ class hc12Radio {
     int setTTMode( int mode );
     int setTPower( int power );
 
-// not applicable!
     int setParam( struct _hc12_param* pParam );
+    int applyParam( struct _hc12_param* pParam,
+                    struct _hc12_param_result *pResult = NULL );
 
     int setSerialParam( int databits, char parity, int stopbits );
 
 /* ********************* */
 
-    int getBaud( void );
-    int getComChannel( void );
-    int getTTMode( void );
-    int getTPower( void );
-    int getParam( void );
-    int getFWVersion( void );
+    int getBaud( int how = HC12_READ_CACHED );
+    int getComChannel( int how = HC12_READ_CACHED );
+    int getTTMode( int how = HC12_READ_CACHED );
+    int getTPower( int how = HC12_READ_CACHED );
+    int getParam( int how = HC12_READ_CACHED );
+    int getFWVersion( int how = HC12_READ_CACHED );
 
     int getSerialParam( int *databits, char *parity, int *stopbits );
 
+/* ********************* */
+
+// transparent mode (HC12_OP_TT_MODE) data path
+    int send( const void *pData, size_t len );
+    int receive( void *pData, size_t len );
+    int flush( void );
+    int readAvailable( char *pData, int len );
+    int poll( void );
+    size_t available( void );
+
+// zero copy access to the rings, see hc12RingBuffer
+    hc12RingBuffer* txRing( void ) { return( &_txRing ); }
+    hc12RingBuffer* rxRing( void ) { return( &_rxRing ); }
+
+// TX pacing to the air rate of the FU mode, see hc12Pacer
+    hc12Pacer* pacer( void ) { return( &_pacer ); }
+    uint32_t airtimeUs( size_t len ) { return( _pacer.airtimeUs( len ) ); }
+
+#if defined(__linux__)
+// background reader thread feeding a lock-free ring, see hc12SpscRing
+    int startReader( void );
+    int stopReader( void );
+    bool readerRunning( void )
+              { return( _readerRun.load( std::memory_order_relaxed ) ); }
+    uint64_t readerOverruns( void ) { return( _rxSpsc.overruns() ); }
+// HC12_ERR_FAIL once the thread ended on a dead line
+    int readerError( void ) { return( _readerError.load() ); }
+// CLOCK_MONOTONIC ns of the first byte of the last read
+    uint64_t rxTimestamp( void ) { return( _rxStamp ); }
+#endif // defined(__linux__)
+
 
 };
 
@@ -0,0 +1,897 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Reactor.cpp - drive many hc12Radio instances from one thread
+ *                    (Linux only)
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Reactor.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define HC12_REACTOR_WAKE_ID       HC12_REACTOR_MAX_RADIOS
+
+// epoll data of a slot: id in the low, generation in the high half
+#define HC12_REACTOR_EV_DATA(id, generation) \
+                         ((uint64_t) (generation) << 32 | (uint32_t) (id))
+#define HC12_REACTOR_QUEUE_MASK    (HC12_REACTOR_QUEUE - 1)
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Reactor::hc12Reactor( void )
+ ------------------------------------------------------------------------------
+*/
+hc12Reactor::hc12Reactor( void )
+{
+    _epollFd = -1;
+    _wakeFd = -1;
+    _stop = false;
+    _active = 0;
+    memset( _slot, '\0', sizeof(_slot) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Reactor::~hc12Reactor( void )
+ ------------------------------------------------------------------------------
+*/
+hc12Reactor::~hc12Reactor( void )
+{
+    close();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint64_t hc12Reactor::nowMs( void )
+ ------------------------------------------------------------------------------
+*/
+uint64_t hc12Reactor::nowMs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000 );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * bool hc12Reactor::live( uint32_t id, uint32_t generation )
+ *
+ * check whether an event for slot id of the given generation is still
+ * to be handled, i.e. the radio has neither been removed nor failed
+ ------------------------------------------------------------------------------
+*/
+bool hc12Reactor::live( uint32_t id, uint32_t generation )
+{
+    return( id < HC12_REACTOR_MAX_RADIOS &&
+            _slot[id].generation == generation &&
+            _slot[id].state != HC12_SLOT_FREE &&
+            _slot[id].state != HC12_SLOT_DEAD );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::open( void )
+ *
+ * create the epoll set
+ * returns HC12_ERR_OK on success, otherwise HC12_ERR_FAIL
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::open( void )
+{
+    int retVal = HC12_ERR_OK;
+    struct epoll_event ev;
+
+    if( _epollFd < 0 )
+    {
+        if( (_epollFd = epoll_create1( EPOLL_CLOEXEC )) < 0 ||
+            (_wakeFd = eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC )) < 0 )
+        {
+            close();
+            retVal = HC12_ERR_FAIL;
+        }
+        else
+        {
+            ev.events = EPOLLIN;
+            ev.data.u64 = 0;
+            ev.data.u32 = HC12_REACTOR_WAKE_ID;
+            if( epoll_ctl( _epollFd, EPOLL_CTL_ADD, _wakeFd, &ev ) != 0 )
+            {
+                close();
+                retVal = HC12_ERR_FAIL;
+            }
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::close( void )
+ *
+ * remove all radios and release the epoll set
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::close( void )
+{
+    int id;
+
+    for( id = 0; id < HC12_REACTOR_MAX_RADIOS; id++ )
+    {
+        remove( id );
+    }
+
+    if( _wakeFd >= 0 )
+    {
+        ::close( _wakeFd );
+        _wakeFd = -1;
+    }
+
+    if( _epollFd >= 0 )
+    {
+        ::close( _epollFd );
+        _epollFd = -1;
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::add( hc12Radio *pRadio, hc12CommandDone pDone,
+ *                       hc12DataReady pData, void *pUser )
+ *
+ * take over a connected radio. Its descriptor is switched to non-blocking
+ * mode while it belongs to the reactor. The reader thread must not run.
+ * returns the id of the radio or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::add( hc12Radio *pRadio, hc12CommandDone pDone,
+                      hc12DataReady pData, void *pUser )
+{
+    int retVal = HC12_ERR_FAIL;
+    struct _hc12_reactor_slot *pSlot;
+    struct epoll_event ev;
+    uint32_t generation;
+    int id;
+
+    if( pRadio == NULL )
+    {
+        return( HC12_ERR_NULLP );
+    }
+
+    if( _epollFd < 0 || pRadio->deviceFd() < 0 || pRadio->readerRunning() )
+    {
+        return( HC12_ERR_FAIL );
+    }
+
+    for( id = 0; id < HC12_REACTOR_MAX_RADIOS && retVal < 0; id++ )
+    {
+        pSlot = &_slot[id];
+
+        if( pSlot->state == HC12_SLOT_FREE )
+        {
+            generation = pSlot->generation;
+            memset( pSlot, '\0', sizeof(*pSlot) );
+            pSlot->generation = generation;
+            pSlot->pRadio = pRadio;
+            pSlot->fd = pRadio->deviceFd();
+            pSlot->fdFlags = fcntl( pSlot->fd, F_GETFL );
+            pSlot->pDone = pDone;
+            pSlot->pData = pData;
+            pSlot->pUser = pUser;
+            pSlot->events = EPOLLIN;
+
+            ev.events = pSlot->events;
+            ev.data.u64 = HC12_REACTOR_EV_DATA( id, generation );
+
+            if( pSlot->fdFlags >= 0 &&
+                fcntl( pSlot->fd, F_SETFL, pSlot->fdFlags | O_NONBLOCK ) == 0 &&
+                epoll_ctl( _epollFd, EPOLL_CTL_ADD, pSlot->fd, &ev ) == 0 )
+            {
+                pSlot->state = HC12_SLOT_IDLE;
+                _active++;
+                retVal = id;
+            }
+            else
+            {
+                if( pSlot->fdFlags >= 0 )
+                {
+                    fcntl( pSlot->fd, F_SETFL, pSlot->fdFlags );
+                }
+                break;
+            }
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::cancel( int id )
+ *
+ * give up the command in flight and drop the queued ones, no callback
+ * is called. A mode switch in progress is completed, the pin has been
+ * switched already.
+ * returns HC12_ERR_OK or HC12_ERR_ARGS
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::cancel( int id )
+{
+    int retVal = HC12_ERR_OK;
+    struct _hc12_reactor_slot *pSlot;
+
+    if( id < 0 || id >= HC12_REACTOR_MAX_RADIOS ||
+        _slot[id].state == HC12_SLOT_FREE )
+    {
+        return( HC12_ERR_ARGS );
+    }
+
+    pSlot = &_slot[id];
+
+    if( pSlot->state == HC12_SLOT_COMMAND )
+    {
+        pSlot->pRadio->expireRequest();
+    }
+    else if( pSlot->state == HC12_SLOT_SETTLE )
+    {
+        endModeSwitch( id );
+    }
+
+    if( pSlot->state != HC12_SLOT_DEAD )
+    {
+        pSlot->state = HC12_SLOT_IDLE;
+    }
+    pSlot->deadline = 0;
+    pSlot->qTail = pSlot->qHead;
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::remove( int id )
+ *
+ * hand the radio back for blocking use, see cancel()
+ * returns HC12_ERR_OK or HC12_ERR_ARGS
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::remove( int id )
+{
+    int retVal;
+    struct _hc12_reactor_slot *pSlot;
+
+    if( (retVal = cancel( id )) != HC12_ERR_OK )
+    {
+        return( retVal );
+    }
+
+    pSlot = &_slot[id];
+
+    if( pSlot->state != HC12_SLOT_DEAD )
+    {
+        epoll_ctl( _epollFd, EPOLL_CTL_DEL, pSlot->fd, NULL );
+    }
+
+    fcntl( pSlot->fd, F_SETFL, pSlot->fdFlags );
+    pSlot->state = HC12_SLOT_FREE;
+    // events of this round for the slot are stale now
+    pSlot->generation++;
+    _active--;
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * static uint32_t txDelayUs( hc12Radio *pRadio )
+ *
+ * us until the pacer lets the next packet out of the TX ring
+ ------------------------------------------------------------------------------
+*/
+static uint32_t txDelayUs( hc12Radio *pRadio )
+{
+    size_t len = pRadio->txRing()->used();
+
+    return( pRadio->pacer()->delayUs( len < HC12_AIR_PACKET_BYTES ?
+                                      len : HC12_AIR_PACKET_BYTES ) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::updateEvents( int id )
+ *
+ * watch for input unless the RX ring is full, and for output while
+ * transparent mode data is queued and the pacer lets it out
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::updateEvents( int id )
+{
+    int retVal = HC12_ERR_OK;
+    struct _hc12_reactor_slot *pSlot = &_slot[id];
+    hc12Radio *pRadio = pSlot->pRadio;
+    struct epoll_event ev;
+    uint32_t events = EPOLLIN;
+
+    if( pSlot->state == HC12_SLOT_IDLE &&
+        pRadio->opMode() == HC12_OP_TT_MODE )
+    {
+        if( pRadio->rxRing()->isFull() )
+        {
+            events = 0;
+        }
+        if( !pRadio->txRing()->isEmpty() && txDelayUs( pRadio ) == 0 )
+        {
+            events |= EPOLLOUT;
+        }
+    }
+
+    if( pSlot->state != HC12_SLOT_DEAD && events != pSlot->events )
+    {
+        pSlot->events = ev.events = events;
+        ev.data.u64 = HC12_REACTOR_EV_DATA( id, pSlot->generation );
+        retVal = epoll_ctl( _epollFd, EPOLL_CTL_MOD, pSlot->fd, &ev );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::complete( int id, int result )
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::complete( int id, int result )
+{
+    struct _hc12_reactor_slot *pSlot = &_slot[id];
+
+    if( pSlot->state != HC12_SLOT_DEAD )
+    {
+        pSlot->state = HC12_SLOT_IDLE;
+    }
+    pSlot->deadline = 0;
+
+    if( pSlot->pDone != NULL )
+    {
+        pSlot->pDone( pSlot->pRadio, pSlot->current.command,
+                      pSlot->current.arg, result, pSlot->pUser );
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::endModeSwitch( int id )
+ *
+ * finish the mode switch of the current command. Leaving command mode
+ * may bring the line to a new baud rate, a transport that opens it
+ * again for that leaves the reactor with a stale descriptor.
+ * returns HC12_ERR_OK or HC12_ERR_FAIL if the line is lost
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::endModeSwitch( int id )
+{
+    int retVal = HC12_ERR_OK;
+    struct _hc12_reactor_slot *pSlot = &_slot[id];
+
+    if( pSlot->current.command == HC12_REACTOR_ENTER_CMD )
+    {
+        pSlot->pRadio->endModeSwitch( HC12_OP_CMD_MODE );
+    }
+    else if( pSlot->pRadio->endModeSwitch( HC12_OP_TT_MODE ) !=
+                                                             HC12_ERR_OK ||
+             pSlot->pRadio->deviceFd() != pSlot->fd )
+    {
+        retVal = HC12_ERR_FAIL;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::startNext( int id )
+ *
+ * start queued commands until one of them has to wait
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::startNext( int id )
+{
+    struct _hc12_reactor_slot *pSlot = &_slot[id];
+    hc12Radio *pRadio = pSlot->pRadio;
+    int result;
+    int mode;
+
+    while( pSlot->state == HC12_SLOT_IDLE && pSlot->qTail != pSlot->qHead )
+    {
+        // data queued in transparent mode goes out before command mode,
+        // handleOutput() starts the switch once the TX ring is empty
+        if( pSlot->queue[pSlot->qTail & HC12_REACTOR_QUEUE_MASK].command ==
+                                                    HC12_REACTOR_ENTER_CMD &&
+            pRadio->opMode() == HC12_OP_TT_MODE &&
+            !pRadio->txRing()->isEmpty() )
+        {
+            break;
+        }
+
+        pSlot->current = pSlot->queue[pSlot->qTail++ & HC12_REACTOR_QUEUE_MASK];
+
+        if( pSlot->current.command == HC12_REACTOR_ENTER_CMD ||
+            pSlot->current.command == HC12_REACTOR_LEAVE_CMD )
+        {
+            mode = pSlot->current.command == HC12_REACTOR_ENTER_CMD ?
+                                         HC12_OP_CMD_MODE : HC12_OP_TT_MODE;
+
+            if( (result = pRadio->beginModeSwitch( mode )) > 0 )
+            {
+                pSlot->state = HC12_SLOT_SETTLE;
+                pSlot->deadline = nowMs() + result;
+            }
+            else
+            {
+                if( result == 0 )
+                {
+                    result = endModeSwitch( id );
+                }
+                complete( id, result );
+            }
+        }
+        else
+        {
+            if( (result = pRadio->startRequest( pSlot->current.command,
+                                                pSlot->current.arg )) ==
+                                                                HC12_ERR_OK &&
+                (result = pRadio->feedResponse( NULL, 0 )) ==
+                                                       HC12_CMD_STATUS_ACTIVE )
+            {
+                pSlot->state = HC12_SLOT_COMMAND;
+                pSlot->deadline = nowMs() + pRadio->requestTimeout();
+            }
+            else
+            {
+                complete( id, result );
+            }
+        }
+    }
+
+    updateEvents( id );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::handleInput( int id )
+ *
+ * feed a pending reply, fill the RX ring in transparent mode, drop
+ * everything else
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::handleInput( int id )
+{
+    struct _hc12_reactor_slot *pSlot = &_slot[id];
+    hc12Radio *pRadio = pSlot->pRadio;
+    char buffer[IO_BUFFER_SIZE];
+    int result = HC12_CMD_STATUS_ACTIVE;
+    int received;
+
+    if( pSlot->state == HC12_SLOT_COMMAND )
+    {
+        do
+        {
+            if( (received = pRadio->readAvailable( buffer,
+                                                 sizeof(buffer) )) > 0 ||
+                received == E_BUFSPACE )
+            {
+                result = pRadio->feedResponse( buffer,
+                           received > 0 ? received : (int) sizeof(buffer) );
+            }
+        } while( received == E_BUFSPACE && result == HC12_CMD_STATUS_ACTIVE );
+
+        if( result == HC12_CMD_STATUS_ACTIVE )
+        {
+            pSlot->deadline = nowMs() + pRadio->requestTimeout();
+        }
+        else
+        {
+            complete( id, result );
+            startNext( id );
+        }
+    }
+    else if( pSlot->state == HC12_SLOT_IDLE &&
+             pRadio->opMode() == HC12_OP_TT_MODE )
+    {
+        if( pRadio->poll() > 0 && pSlot->pData != NULL )
+        {
+            pSlot->pData( pRadio, pRadio->available(), pSlot->pUser );
+        }
+        updateEvents( id );
+    }
+    else
+    {
+        while( pRadio->readAvailable( buffer, sizeof(buffer) ) == E_BUFSPACE )
+        {
+            ;
+        }
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::handleOutput( int id )
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::handleOutput( int id )
+{
+    struct _hc12_reactor_slot *pSlot = &_slot[id];
+
+    if( pSlot->pRadio->opMode() == HC12_OP_TT_MODE )
+    {
+        pSlot->pRadio->flush();
+    }
+    // a switch to command mode may wait for the TX ring to run empty
+    startNext( id );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::handleError( int id )
+ *
+ * the port is gone, fail everything pending on it
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::handleError( int id )
+{
+    struct _hc12_reactor_slot *pSlot = &_slot[id];
+    int state = pSlot->state;
+
+    epoll_ctl( _epollFd, EPOLL_CTL_DEL, pSlot->fd, NULL );
+    pSlot->state = HC12_SLOT_DEAD;
+
+    if( state == HC12_SLOT_COMMAND )
+    {
+        pSlot->pRadio->expireRequest();
+    }
+
+    if( state == HC12_SLOT_COMMAND || state == HC12_SLOT_SETTLE )
+    {
+        complete( id, HC12_ERR_FAIL );
+    }
+
+    while( pSlot->qTail != pSlot->qHead )
+    {
+        pSlot->current = pSlot->queue[pSlot->qTail++ & HC12_REACTOR_QUEUE_MASK];
+        complete( id, HC12_ERR_FAIL );
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::checkDeadlines( void )
+ *
+ * finish mode switches that have settled and expire replies that did
+ * not complete in time
+ * returns the ms until the nearest deadline or paced write, -1 if there
+ * is none
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::checkDeadlines( void )
+{
+    int retVal = -1;
+    struct _hc12_reactor_slot *pSlot;
+    uint64_t now = nowMs();
+    int wait;
+    int id;
+
+    for( id = 0; id < HC12_REACTOR_MAX_RADIOS; id++ )
+    {
+        pSlot = &_slot[id];
+
+        if( pSlot->deadline != 0 && pSlot->deadline <= now )
+        {
+            if( pSlot->state == HC12_SLOT_SETTLE )
+            {
+                complete( id, endModeSwitch( id ) );
+            }
+            else
+            {
+                complete( id, pSlot->pRadio->expireRequest() );
+            }
+            startNext( id );
+        }
+
+        if( pSlot->deadline != 0 )
+        {
+            wait = pSlot->deadline > now ? pSlot->deadline - now : 0;
+            if( retVal < 0 || wait < retVal )
+            {
+                retVal = wait;
+            }
+        }
+
+        // the application may have made room in the RX ring
+        if( pSlot->state == HC12_SLOT_IDLE )
+        {
+            updateEvents( id );
+
+            // paced output goes on once the pacer has the credit
+            if( pSlot->pRadio->opMode() == HC12_OP_TT_MODE &&
+                !pSlot->pRadio->txRing()->isEmpty() )
+            {
+                wait = (txDelayUs( pSlot->pRadio ) + 999) / 1000;
+                if( wait > 0 && (retVal < 0 || wait < retVal) )
+                {
+                    retVal = wait;
+                }
+            }
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::submit( int id, int command, int arg )
+ *
+ * queue a HC12_CMD_CODE_* command or HC12_REACTOR_ENTER_CMD /
+ * HC12_REACTOR_LEAVE_CMD for a radio. The callback reports the result.
+ * returns HC12_ERR_OK if queued, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::submit( int id, int command, int arg )
+{
+    int retVal = HC12_ERR_OK;
+    struct _hc12_reactor_slot *pSlot;
+
+    if( id < 0 || id >= HC12_REACTOR_MAX_RADIOS ||
+        _slot[id].state == HC12_SLOT_FREE )
+    {
+        return( HC12_ERR_ARGS );
+    }
+
+    pSlot = &_slot[id];
+
+    if( pSlot->state == HC12_SLOT_DEAD ||
+        pSlot->qHead - pSlot->qTail >= HC12_REACTOR_QUEUE )
+    {
+        retVal = HC12_ERR_FAIL;
+    }
+    else
+    {
+        pSlot->queue[pSlot->qHead & HC12_REACTOR_QUEUE_MASK].command = command;
+        pSlot->queue[pSlot->qHead & HC12_REACTOR_QUEUE_MASK].arg = arg;
+        pSlot->qHead++;
+
+        startNext( id );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::send( int id, const void *pData, size_t len )
+ *
+ * queue transparent mode data, the rest is written as the port drains
+ * returns the amount of bytes accepted or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::send( int id, const void *pData, size_t len )
+{
+    int retVal;
+
+    if( id < 0 || id >= HC12_REACTOR_MAX_RADIOS ||
+        _slot[id].state == HC12_SLOT_FREE )
+    {
+        return( HC12_ERR_ARGS );
+    }
+
+    if( _slot[id].state == HC12_SLOT_DEAD )
+    {
+        retVal = HC12_ERR_FAIL;
+    }
+    else if( _slot[id].state != HC12_SLOT_IDLE )
+    {
+        retVal = HC12_ERR_OP_MODE;
+    }
+    else
+    {
+        // the write never blocks, the descriptor is non-blocking
+        retVal = _slot[id].pRadio->send( pData, len );
+        updateEvents( id );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::pending( int id )
+ *
+ * returns the amount of commands queued or in flight for a radio
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::pending( int id )
+{
+    int retVal = 0;
+
+    if( id >= 0 && id < HC12_REACTOR_MAX_RADIOS &&
+        _slot[id].state != HC12_SLOT_FREE )
+    {
+        retVal = _slot[id].qHead - _slot[id].qTail;
+        if( _slot[id].state == HC12_SLOT_COMMAND ||
+            _slot[id].state == HC12_SLOT_SETTLE )
+        {
+            retVal++;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::pending( void )
+ *
+ * returns the amount of commands queued or in flight for all radios
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::pending( void )
+{
+    int retVal = 0;
+    int id;
+
+    for( id = 0; id < HC12_REACTOR_MAX_RADIOS; id++ )
+    {
+        retVal += pending( id );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::runOnce( int timeoutMs )
+ *
+ * wait for events up to timeoutMs (-1 forever), or the next deadline if
+ * that is nearer, and dispatch them
+ * returns the amount of events handled or HC12_ERR_FAIL
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::runOnce( int timeoutMs )
+{
+    int retVal;
+    struct epoll_event events[HC12_REACTOR_EVENTS];
+    uint64_t count;
+    uint32_t id;
+    uint32_t generation;
+    int wait;
+    int i;
+
+    if( _epollFd < 0 )
+    {
+        return( HC12_ERR_FAIL );
+    }
+
+    wait = checkDeadlines();
+    if( wait < 0 || (timeoutMs >= 0 && timeoutMs < wait) )
+    {
+        wait = timeoutMs;
+    }
+
+    retVal = epoll_wait( _epollFd, events, HC12_REACTOR_EVENTS, wait );
+
+    for( i = 0; i < retVal; i++ )
+    {
+        id = (uint32_t) events[i].data.u64;
+        generation = (uint32_t) (events[i].data.u64 >> 32);
+
+        if( id == HC12_REACTOR_WAKE_ID )
+        {
+            if( read( _wakeFd, &count, sizeof(count) ) < 0 )
+            {
+                ; // nothing pending
+            }
+        }
+        else
+        {
+            // a callback run by a handler may remove the radio
+            if( (events[i].events & EPOLLIN) && live( id, generation ) )
+            {
+                handleInput( id );
+            }
+            if( (events[i].events & EPOLLOUT) && live( id, generation ) )
+            {
+                handleOutput( id );
+            }
+            if( (events[i].events & (EPOLLERR|EPOLLHUP)) &&
+                live( id, generation ) )
+            {
+                handleError( id );
+            }
+        }
+    }
+
+    if( retVal < 0 )
+    {
+        retVal = errno == EINTR ? 0 : HC12_ERR_FAIL;
+    }
+
+    checkDeadlines();
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Reactor::run( void )
+ *
+ * dispatch events until stop() is called
+ * returns HC12_ERR_OK or HC12_ERR_FAIL
+ ------------------------------------------------------------------------------
+*/
+int hc12Reactor::run( void )
+{
+    int retVal = HC12_ERR_OK;
+
+    _stop = false;
+
+    while( !_stop && retVal >= 0 )
+    {
+        retVal = runOnce( -1 );
+    }
+
+    return( retVal < 0 ? retVal : HC12_ERR_OK );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::stop( void )
+ *
+ * let run() return, may be called from any thread or a callback
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::stop( void )
+{
+    _stop = true;
+    wakeup();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Reactor::wakeup( void )
+ *
+ * let a runOnce() waiting in another thread return early
+ ------------------------------------------------------------------------------
+*/
+void hc12Reactor::wakeup( void )
+{
+    uint64_t one = 1;
+
+    if( _wakeFd >= 0 && write( _wakeFd, &one, sizeof(one) ) < 0 )
+    {
+        ; // counter overflow, a wake up is pending anyway
+    }
+}
+
+#endif // defined(__linux__)
@@ -0,0 +1,138 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Reactor.h - drive many hc12Radio instances from one thread
+ *                  (Linux only)
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_REACTOR_H_
+#define _HC12_REACTOR_H_
+
+#if defined(__linux__)
+
+#include "hc12Radio.h"
+
+#define HC12_REACTOR_MAX_RADIOS    64
+// commands queued per radio, MUST be a power of two
+#define HC12_REACTOR_QUEUE         16
+#define HC12_REACTOR_EVENTS        32
+
+// pseudo commands, queued like the HC12_CMD_CODE_* ones
+#define HC12_REACTOR_ENTER_CMD     10
+#define HC12_REACTOR_LEAVE_CMD     11
+
+#define HC12_SLOT_FREE              0
+#define HC12_SLOT_IDLE              1
+#define HC12_SLOT_COMMAND           2
+#define HC12_SLOT_SETTLE            3
+#define HC12_SLOT_DEAD              4
+
+//
+// result is HC12_ERR_OK or an error code, the values read are in the
+// parameter cache of the radio
+//
+typedef void (*hc12CommandDone)( hc12Radio *pRadio, int command, int arg,
+                                 int result, void *pUser );
+//
+// transparent mode data has arrived in the RX ring of the radio
+//
+typedef void (*hc12DataReady)( hc12Radio *pRadio, size_t available,
+                               void *pUser );
+
+struct _hc12_reactor_cmd {
+    int command;
+    int arg;
+};
+
+struct _hc12_reactor_slot {
+    hc12Radio      *pRadio;
+    int             fd;
+    int             fdFlags;
+    int             state;
+    uint32_t        generation;           // changes with every remove()
+    uint32_t        events;
+    uint64_t        deadline;             // ms, 0 if none
+    hc12CommandDone pDone;
+    hc12DataReady   pData;
+    void           *pUser;
+    struct _hc12_reactor_cmd current;
+    uint32_t        qHead;
+    uint32_t        qTail;
+    struct _hc12_reactor_cmd queue[HC12_REACTOR_QUEUE];
+};
+
+//
+// One epoll set holds the descriptors of all radios. Each radio runs a
+// small state machine: commands are queued and started one after the
+// other with hc12Radio::startRequest(), replies are fed in as they
+// arrive, mode switches wait for their settle time without sleeping.
+// Timeouts are deadlines per radio, the nearest one bounds epoll_wait().
+// In transparent mode received data goes to the RX ring of the radio,
+// queued TX data is written whenever the port can take it.
+//
+// All calls but stop() and wakeup() have to come from the thread running
+// the loop, the callbacks may submit further commands.
+//
+class hc12Reactor {
+
+  protected:
+    int      _epollFd;
+    int      _wakeFd;
+    std::atomic<bool> _stop;
+    int      _active;
+    struct _hc12_reactor_slot _slot[HC12_REACTOR_MAX_RADIOS];
+
+    static uint64_t nowMs( void );
+    bool live( uint32_t id, uint32_t generation );
+
+    int  updateEvents( int id );
+    int  endModeSwitch( int id );
+    void startNext( int id );
+    void complete( int id, int result );
+    void handleInput( int id );
+    void handleOutput( int id );
+    void handleError( int id );
+    int  checkDeadlines( void );
+
+  public:
+    hc12Reactor( void );
+    ~hc12Reactor( void );
+
+    int  open( void );
+    void close( void );
+
+    int  add( hc12Radio *pRadio, hc12CommandDone pDone = NULL,
+              hc12DataReady pData = NULL, void *pUser = NULL );
+    int  remove( int id );
+    int  cancel( int id );
+
+    int  submit( int id, int command, int arg = 0 );
+    int  send( int id, const void *pData, size_t len );
+    int  pending( int id );
+    int  pending( void );
+
+    int  runOnce( int timeoutMs );
+    int  run( void );
+    void stop( void );
+    void wakeup( void );
+};
+
+#endif // defined(__linux__)
+
+#endif // _HC12_REACTOR_H_
@@ -0,0 +1,193 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12RingBuffer.cpp - byte ring buffer for hc-12 transparent data
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include <string.h>
+
+#include "hc12RingBuffer.h"
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12RingBuffer::hc12RingBuffer( uint8_t *pStorage, size_t size )
+ *
+ * size has to be a power of two
+ ------------------------------------------------------------------------------
+*/
+hc12RingBuffer::hc12RingBuffer( uint8_t *pStorage, size_t size )
+{
+    _data = pStorage;
+    _mask = size - 1;
+    _head = 0;
+    _tail = 0;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12RingBuffer::clear( void )
+ *
+ * drop all data
+ ------------------------------------------------------------------------------
+*/
+void hc12RingBuffer::clear( void )
+{
+    _head = 0;
+    _tail = 0;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12RingBuffer::peek( const uint8_t **ppData )
+ *
+ * point to the oldest data in the buffer
+ * returns the amount of bytes readable without wrapping around
+ ------------------------------------------------------------------------------
+*/
+size_t hc12RingBuffer::peek( const uint8_t **ppData )
+{
+    size_t pos = _tail & _mask;
+    size_t len = used();
+
+    if( len > size() - pos )
+    {
+        len = size() - pos;
+    }
+
+    *ppData = &_data[pos];
+
+    return( len );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12RingBuffer::consume( size_t len )
+ *
+ * release len bytes previously obtained by peek()
+ ------------------------------------------------------------------------------
+*/
+void hc12RingBuffer::consume( size_t len )
+{
+    if( len > used() )
+    {
+        len = used();
+    }
+
+    _tail += len;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12RingBuffer::reserve( uint8_t **ppData )
+ *
+ * point to the free space in the buffer
+ * returns the amount of bytes writable without wrapping around
+ ------------------------------------------------------------------------------
+*/
+size_t hc12RingBuffer::reserve( uint8_t **ppData )
+{
+    size_t pos = _head & _mask;
+    size_t len = space();
+
+    if( len > size() - pos )
+    {
+        len = size() - pos;
+    }
+
+    *ppData = &_data[pos];
+
+    return( len );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12RingBuffer::commit( size_t len )
+ *
+ * publish len bytes previously written to the area obtained by reserve()
+ ------------------------------------------------------------------------------
+*/
+void hc12RingBuffer::commit( size_t len )
+{
+    if( len > space() )
+    {
+        len = space();
+    }
+
+    _head += len;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12RingBuffer::write( const void *pData, size_t len )
+ *
+ * copy as much of pData as fits into the buffer
+ * returns the amount of bytes stored
+ ------------------------------------------------------------------------------
+*/
+size_t hc12RingBuffer::write( const void *pData, size_t len )
+{
+    const uint8_t *pSrc = (const uint8_t*) pData;
+    uint8_t *pDst;
+    size_t chunk;
+    size_t done = 0;
+
+    while( done < len && (chunk = reserve( &pDst )) > 0 )
+    {
+        if( chunk > len - done )
+        {
+            chunk = len - done;
+        }
+
+        memcpy( pDst, &pSrc[done], chunk );
+        commit( chunk );
+        done += chunk;
+    }
+
+    return( done );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12RingBuffer::read( void *pData, size_t len )
+ *
+ * move up to len bytes out of the buffer
+ * returns the amount of bytes copied
+ ------------------------------------------------------------------------------
+*/
+size_t hc12RingBuffer::read( void *pData, size_t len )
+{
+    uint8_t *pDst = (uint8_t*) pData;
+    const uint8_t *pSrc;
+    size_t chunk;
+    size_t done = 0;
+
+    while( done < len && (chunk = peek( &pSrc )) > 0 )
+    {
+        if( chunk > len - done )
+        {
+            chunk = len - done;
+        }
+
+        memcpy( &pDst[done], pSrc, chunk );
+        consume( chunk );
+        done += chunk;
+    }
+
+    return( done );
+}
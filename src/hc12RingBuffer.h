@@ -0,0 +1,83 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12RingBuffer.h - byte ring buffer for hc-12 transparent data
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_RING_BUFFER_H_
+#define _HC12_RING_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// storage sizes MUST be a power of two, the index arithmetic
+// relies on masking instead of modulo
+//
+#if defined(ARDUINO)
+    #define HC12_TX_RING_SIZE      64
+    #define HC12_RX_RING_SIZE      64
+#else // NOT on Arduino platform
+    #define HC12_TX_RING_SIZE    4096
+    #define HC12_RX_RING_SIZE    4096
+#endif // defined(ARDUINO)
+
+//
+// head and tail are free running counters, the amount of data in
+// the buffer is always head - tail. The storage is owned by the
+// caller, so no heap is needed on small controllers.
+//
+class hc12RingBuffer {
+
+  protected:
+    uint8_t *_data;
+    size_t   _mask;
+    size_t   _head;
+    size_t   _tail;
+
+  public:
+    hc12RingBuffer( uint8_t *pStorage, size_t size );
+
+    void clear( void );
+
+    size_t size( void )    { return( _mask + 1 ); }
+    size_t used( void )    { return( _head - _tail ); }
+    size_t space( void )   { return( size() - used() ); }
+    bool   isEmpty( void ) { return( _head == _tail ); }
+    bool   isFull( void )  { return( used() == size() ); }
+
+    size_t write( const void *pData, size_t len );
+    size_t read( void *pData, size_t len );
+
+// zero copy access, contiguous parts only
+    size_t peek( const uint8_t **ppData );
+    void   consume( size_t len );
+    size_t reserve( uint8_t **ppData );
+    void   commit( size_t len );
+
+// single bytes offset positions behind head resp. tail, for coders
+// working in place across the wrap around. offset MUST be below
+// space() resp. used().
+    uint8_t* headAt( size_t offset )
+                          { return( &_data[(_head + offset) & _mask] ); }
+    uint8_t* tailAt( size_t offset )
+                          { return( &_data[(_tail + offset) & _mask] ); }
+};
+
+#endif // _HC12_RING_BUFFER_H_
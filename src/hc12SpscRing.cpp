@@ -0,0 +1,401 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12SpscRing.cpp - lock-free receive ring between a reader thread
+ *                     and the application (Linux only)
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12SpscRing.h"
+
+#if defined(__linux__)
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
+
+#define HC12_SPSC_MASK          (HC12_SPSC_RING_SIZE - 1)
+#define HC12_SPSC_CHUNK_MASK    (HC12_SPSC_CHUNKS - 1)
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12SpscRing::hc12SpscRing( void )
+ ------------------------------------------------------------------------------
+*/
+hc12SpscRing::hc12SpscRing( void )
+{
+    _wakeFd = -1;
+    _data = NULL;
+    _chunks = NULL;
+    _overruns = 0;
+    _waiting = false;
+    clear();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12SpscRing::~hc12SpscRing( void )
+ ------------------------------------------------------------------------------
+*/
+hc12SpscRing::~hc12SpscRing( void )
+{
+    close();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12SpscRing::open( void )
+ *
+ * allocate the cache line aligned storage and the wake up descriptor
+ * returns 0 on success, otherwise -1
+ ------------------------------------------------------------------------------
+*/
+int hc12SpscRing::open( void )
+{
+    int retVal = 0;
+    void *pData = NULL;
+    void *pChunks = NULL;
+
+    if( _data == NULL )
+    {
+        if( posix_memalign( &pData, HC12_CACHE_LINE,
+                            HC12_SPSC_RING_SIZE ) != 0 ||
+            posix_memalign( &pChunks, HC12_CACHE_LINE,
+                            HC12_SPSC_CHUNKS *
+                            sizeof(struct _hc12_rx_chunk) ) != 0 ||
+            (_wakeFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC )) < 0 )
+        {
+            free( pData );
+            free( pChunks );
+            _wakeFd = -1;
+            retVal = -1;
+        }
+        else
+        {
+            _data = (uint8_t*) pData;
+            _chunks = (struct _hc12_rx_chunk*) pChunks;
+            clear();
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12SpscRing::close( void )
+ ------------------------------------------------------------------------------
+*/
+void hc12SpscRing::close( void )
+{
+    if( _wakeFd >= 0 )
+    {
+        ::close( _wakeFd );
+        _wakeFd = -1;
+    }
+
+    free( _data );
+    free( _chunks );
+    _data = NULL;
+    _chunks = NULL;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12SpscRing::clear( void )
+ ------------------------------------------------------------------------------
+*/
+void hc12SpscRing::clear( void )
+{
+    _head.store( 0, std::memory_order_relaxed );
+    _tail.store( 0, std::memory_order_relaxed );
+    _chunkHead.store( 0, std::memory_order_relaxed );
+    _chunkTail.store( 0, std::memory_order_relaxed );
+    _tailCache = 0;
+    _headCache = 0;
+    _lastStamp = 0;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint64_t hc12SpscRing::now( void )
+ *
+ * returns CLOCK_MONOTONIC in nanoseconds
+ ------------------------------------------------------------------------------
+*/
+uint64_t hc12SpscRing::now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12SpscRing::reserve( uint8_t **ppData )
+ *
+ * producer: point to the free space
+ * returns the amount of bytes writable without wrapping around
+ ------------------------------------------------------------------------------
+*/
+size_t hc12SpscRing::reserve( uint8_t **ppData )
+{
+    size_t head = _head.load( std::memory_order_relaxed );
+    size_t pos = head & HC12_SPSC_MASK;
+    size_t space = HC12_SPSC_RING_SIZE - (head - _tailCache);
+
+    if( space < HC12_SPSC_RING_SIZE / 4 )
+    {
+        _tailCache = _tail.load( std::memory_order_acquire );
+        space = HC12_SPSC_RING_SIZE - (head - _tailCache);
+    }
+
+    if( space > HC12_SPSC_RING_SIZE - pos )
+    {
+        space = HC12_SPSC_RING_SIZE - pos;
+    }
+
+    *ppData = &_data[pos];
+
+    return( space );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12SpscRing::commit( size_t len, uint64_t stampNs )
+ *
+ * producer: publish len bytes received at stampNs. If the stamp ring is
+ * full the bytes are counted to the next chunk.
+ ------------------------------------------------------------------------------
+*/
+void hc12SpscRing::commit( size_t len, uint64_t stampNs )
+{
+    size_t head = _head.load( std::memory_order_relaxed ) + len;
+    size_t chunk = _chunkHead.load( std::memory_order_relaxed );
+
+    if( chunk - _chunkTail.load( std::memory_order_acquire ) <
+                                                      HC12_SPSC_CHUNKS )
+    {
+        _chunks[chunk & HC12_SPSC_CHUNK_MASK].stampNs = stampNs;
+        _chunks[chunk & HC12_SPSC_CHUNK_MASK].end = head;
+        _chunkHead.store( chunk + 1, std::memory_order_release );
+    }
+
+    _head.store( head, std::memory_order_release );
+
+    // pairs with the fence in waitData(), either the consumer sees the
+    // new head or we see it waiting
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( _waiting.load( std::memory_order_relaxed ) )
+    {
+        uint64_t one = 1;
+        if( write( _wakeFd, &one, sizeof(one) ) < 0 )
+        {
+            ; // counter overflow only, the consumer is awake anyway
+        }
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12SpscRing::used( void )
+ *
+ * consumer: returns the amount of bytes waiting
+ ------------------------------------------------------------------------------
+*/
+size_t hc12SpscRing::used( void )
+{
+    _headCache = _head.load( std::memory_order_acquire );
+
+    return( _headCache - _tail.load( std::memory_order_relaxed ) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12SpscRing::peek( const uint8_t **ppData )
+ *
+ * consumer: point to the data waiting, without copying it
+ * returns the amount of bytes readable without wrapping around
+ ------------------------------------------------------------------------------
+*/
+size_t hc12SpscRing::peek( const uint8_t **ppData )
+{
+    size_t tail = _tail.load( std::memory_order_relaxed );
+    size_t pos = tail & HC12_SPSC_MASK;
+    size_t avail = _headCache - tail;
+
+    if( avail == 0 )
+    {
+        _headCache = _head.load( std::memory_order_acquire );
+        avail = _headCache - tail;
+    }
+
+    if( avail > HC12_SPSC_RING_SIZE - pos )
+    {
+        avail = HC12_SPSC_RING_SIZE - pos;
+    }
+
+    *ppData = &_data[pos];
+
+    return( avail );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12SpscRing::consume( size_t len )
+ *
+ * consumer: release len bytes returned by peek() resp. copied by read()
+ * and remember the arrival time of the first of them
+ ------------------------------------------------------------------------------
+*/
+void hc12SpscRing::consume( size_t len )
+{
+    size_t tail = _tail.load( std::memory_order_relaxed );
+    size_t chunk;
+    size_t chunkHead;
+
+    // find the chunk of the first byte, drop the ones consumed
+    chunk = _chunkTail.load( std::memory_order_relaxed );
+    chunkHead = _chunkHead.load( std::memory_order_acquire );
+
+    while( chunk != chunkHead &&
+           _chunks[chunk & HC12_SPSC_CHUNK_MASK].end <= tail )
+    {
+        chunk++;
+    }
+
+    if( chunk != chunkHead )
+    {
+        _lastStamp = _chunks[chunk & HC12_SPSC_CHUNK_MASK].stampNs;
+    }
+
+    while( chunk != chunkHead &&
+           _chunks[chunk & HC12_SPSC_CHUNK_MASK].end <= tail + len )
+    {
+        chunk++;
+    }
+
+    _chunkTail.store( chunk, std::memory_order_release );
+    _tail.store( tail + len, std::memory_order_release );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * size_t hc12SpscRing::read( void *pData, size_t len, uint64_t *pStampNs )
+ *
+ * consumer: move up to len bytes out of the ring, no syscall involved.
+ * pStampNs (may be NULL) receives the arrival time of the first byte.
+ * returns the amount of bytes copied
+ ------------------------------------------------------------------------------
+*/
+size_t hc12SpscRing::read( void *pData, size_t len, uint64_t *pStampNs )
+{
+    uint8_t *pDst = (uint8_t*) pData;
+    size_t tail = _tail.load( std::memory_order_relaxed );
+    size_t avail = _headCache - tail;
+    size_t pos = tail & HC12_SPSC_MASK;
+    size_t first;
+
+    if( avail < len )
+    {
+        _headCache = _head.load( std::memory_order_acquire );
+        avail = _headCache - tail;
+    }
+
+    if( len > avail )
+    {
+        len = avail;
+    }
+
+    if( len > 0 )
+    {
+        first = HC12_SPSC_RING_SIZE - pos;
+        if( first > len )
+        {
+            first = len;
+        }
+
+        memcpy( pDst, &_data[pos], first );
+        memcpy( &pDst[first], _data, len - first );
+
+        consume( len );
+    }
+
+    if( pStampNs != NULL )
+    {
+        *pStampNs = _lastStamp;
+    }
+
+    return( len );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * bool hc12SpscRing::waitData( int timeoutMs )
+ *
+ * consumer: sleep until data is available or timeoutMs passed
+ * returns true if data is available
+ ------------------------------------------------------------------------------
+*/
+bool hc12SpscRing::waitData( int timeoutMs )
+{
+    bool retVal = used() > 0;
+    uint64_t deadline;
+    uint64_t stamp;
+    uint64_t count;
+    struct pollfd pfd;
+    int remaining;
+
+    if( !retVal && timeoutMs > 0 )
+    {
+        deadline = now() + (uint64_t) timeoutMs * 1000000ULL;
+
+        _waiting.store( true, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+
+        while( !retVal && (stamp = now()) < deadline )
+        {
+            // drop stale wake ups before looking at the head again
+            if( ::read( _wakeFd, &count, sizeof(count) ) < 0 )
+            {
+                ; // nothing pending
+            }
+
+            if( !(retVal = used() > 0) )
+            {
+                remaining = (int) ((deadline - stamp + 999999) / 1000000);
+                pfd.fd = _wakeFd;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+                ::poll( &pfd, 1, remaining );
+                retVal = used() > 0;
+            }
+        }
+
+        _waiting.store( false, std::memory_order_relaxed );
+    }
+
+    return( retVal );
+}
+
+#endif // defined(__linux__)
@@ -0,0 +1,112 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12SpscRing.h - lock-free receive ring between a reader thread and
+ *                   the application (Linux only)
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_SPSC_RING_H_
+#define _HC12_SPSC_RING_H_
+
+#if defined(__linux__)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// MUST be powers of two
+#define HC12_SPSC_RING_SIZE     65536
+#define HC12_SPSC_CHUNKS         1024
+
+#define HC12_CACHE_LINE            64
+
+//
+// arrival time of the bytes up to (not including) end
+//
+struct _hc12_rx_chunk {
+    uint64_t stampNs;
+    size_t   end;
+};
+
+//
+// Exactly one producer (the reader thread) and one consumer (the
+// application). Both indices are free running like in hc12RingBuffer
+// and live on cache lines of their own. Each side keeps a private copy
+// of the other side's index and reloads it only if the copy says the
+// ring is full resp. empty, so the shared lines are touched rarely.
+//
+// The consumer only sleeps in waitData(), and the producer only makes
+// a syscall to wake it up if it really sleeps. While data is flowing
+// neither side enters the kernel for the ring.
+//
+class hc12SpscRing {
+
+  protected:
+    // producer side
+    alignas(HC12_CACHE_LINE) std::atomic<size_t> _head;
+    std::atomic<size_t> _chunkHead;
+    size_t   _tailCache;
+    std::atomic<uint64_t> _overruns;
+
+    // consumer side
+    alignas(HC12_CACHE_LINE) std::atomic<size_t> _tail;
+    std::atomic<size_t> _chunkTail;
+    size_t   _headCache;
+    uint64_t _lastStamp;
+
+    // shared, rarely written
+    alignas(HC12_CACHE_LINE) std::atomic<bool> _waiting;
+    int      _wakeFd;
+    uint8_t *_data;
+    struct _hc12_rx_chunk *_chunks;
+
+  public:
+    hc12SpscRing( void );
+    ~hc12SpscRing( void );
+
+    int  open( void );
+    void close( void );
+// only while the producer is stopped
+    void clear( void );
+
+    bool isOpen( void ) { return( _data != NULL ); }
+    int  wakeFd( void ) { return( _wakeFd ); }
+
+// producer
+    size_t reserve( uint8_t **ppData );
+    void   commit( size_t len, uint64_t stampNs );
+    void   overrun( void )
+               { _overruns.fetch_add( 1, std::memory_order_relaxed ); }
+    uint64_t overruns( void )
+               { return( _overruns.load( std::memory_order_relaxed ) ); }
+
+// consumer
+    size_t used( void );
+    size_t read( void *pData, size_t len, uint64_t *pStampNs );
+// zero copy counterpart of read()
+    size_t peek( const uint8_t **ppData );
+    void   consume( size_t len );
+    bool   waitData( int timeoutMs );
+
+    static uint64_t now( void );
+};
+
+#endif // defined(__linux__)
+
+#endif // _HC12_SPSC_RING_H_
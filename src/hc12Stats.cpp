@@ -0,0 +1,299 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Stats.cpp - latency histograms and counters for hc-12 commands
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include <string.h>
+
+#include "hc12Stats.h"
+
+#if defined(HC12_WITH_STATS)
+
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__linux__)
+static const char *hc12StatModeNames[HC12_STAT_MODE_SWITCHES] = {
+    "enterCommandMode", "leaveCommandMode"
+};
+#endif // defined(__linux__)
+
+/*
+ ------------------------------------------------------------------------------
+ * hc12Stats::hc12Stats( void )
+ ------------------------------------------------------------------------------
+*/
+hc12Stats::hc12Stats( void )
+{
+    reset();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Stats::reset( void )
+ *
+ * clear all counters and histograms
+ ------------------------------------------------------------------------------
+*/
+void hc12Stats::reset( void )
+{
+    memset( &_stats, '\0', sizeof(_stats) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Stats::now( void )
+ *
+ * returns a monotonic time stamp in microseconds, wrapping around
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Stats::now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return( (uint32_t) ts.tv_sec * 1000000u + ts.tv_nsec / 1000 );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Stats::bucket( uint32_t us )
+ *
+ * returns the histogram bucket of a duration, that is its log2
+ ------------------------------------------------------------------------------
+*/
+int hc12Stats::bucket( uint32_t us )
+{
+    int retVal = 0;
+
+    while( us > 1 && retVal < HC12_STAT_BUCKETS - 1 )
+    {
+        us >>= 1;
+        retVal++;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * uint32_t hc12Stats::percentile( const struct _hc12_histogram *pHist,
+ *                                 int percent )
+ *
+ * returns the upper bound of the bucket holding the given percentile
+ ------------------------------------------------------------------------------
+*/
+uint32_t hc12Stats::percentile( const struct _hc12_histogram *pHist,
+                                int percent )
+{
+    uint32_t retVal = 0;
+    uint64_t wanted;
+    uint64_t seen = 0;
+    int i;
+
+    if( pHist != NULL && pHist->count > 0 )
+    {
+        wanted = ((uint64_t) pHist->count * percent + 99) / 100;
+
+        for( i = 0; i < HC12_STAT_BUCKETS && seen < wanted; i++ )
+        {
+            seen += pHist->bucket[i];
+            retVal = (2u << i) - 1;
+        }
+
+        if( retVal > pHist->maxUs )
+        {
+            retVal = pHist->maxUs;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Stats::add( struct _hc12_histogram *pHist, uint32_t us )
+ ------------------------------------------------------------------------------
+*/
+void hc12Stats::add( struct _hc12_histogram *pHist, uint32_t us )
+{
+    pHist->count++;
+    pHist->sumUs += us;
+    if( us > pHist->maxUs )
+    {
+        pHist->maxUs = us;
+    }
+    pHist->bucket[bucket( us )]++;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Stats::command( int code, int result, uint32_t firstUs,
+ *                          uint32_t totalUs )
+ *
+ * record one command. firstUs is 0 if no byte came back at all.
+ ------------------------------------------------------------------------------
+*/
+void hc12Stats::command( int code, int result, uint32_t firstUs,
+                         uint32_t totalUs )
+{
+    struct _hc12_cmd_stats *pCmd;
+
+    if( code >= HC12_STAT_FIRST_CODE &&
+        code < HC12_STAT_FIRST_CODE + HC12_STAT_COMMANDS )
+    {
+        pCmd = &_stats.cmd[code - HC12_STAT_FIRST_CODE];
+
+        switch( result )
+        {
+            case HC12_STAT_OK:
+                pCmd->success++;
+                break;
+            case HC12_STAT_TIMEOUT:
+                pCmd->timeouts++;
+                break;
+            case HC12_STAT_UNKNOWN:
+                pCmd->unknown++;
+                break;
+            default:
+                pCmd->failed++;
+                break;
+        }
+
+        if( firstUs > 0 )
+        {
+            add( &pCmd->firstByte, firstUs );
+        }
+        add( &pCmd->complete, totalUs );
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Stats::modeSwitch( int which, uint32_t us )
+ *
+ * record the duration of a HC12_STAT_ENTER_CMD / HC12_STAT_LEAVE_CMD
+ ------------------------------------------------------------------------------
+*/
+void hc12Stats::modeSwitch( int which, uint32_t us )
+{
+    if( which >= 0 && which < HC12_STAT_MODE_SWITCHES )
+    {
+        add( &_stats.modeSwitch[which], us );
+    }
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Stats::drain( uint32_t bytes, bool cut, uint32_t us )
+ *
+ * record one resync, cut is set if it did not end on an idle line
+ ------------------------------------------------------------------------------
+*/
+void hc12Stats::drain( uint32_t bytes, bool cut, uint32_t us )
+{
+    _stats.drain.bytes += bytes;
+    if( cut )
+    {
+        _stats.drain.cut++;
+    }
+    add( &_stats.drain.duration, us );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Stats::snapshot( struct _hc12_stats *pStats )
+ *
+ * copy the current figures, the caller may evaluate them at leisure
+ ------------------------------------------------------------------------------
+*/
+void hc12Stats::snapshot( struct _hc12_stats *pStats )
+{
+    if( pStats != NULL )
+    {
+        memcpy( pStats, &_stats, sizeof(_stats) );
+    }
+}
+
+#if defined(__linux__)
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Stats::dump( void )
+ *
+ * print a line per command and mode switch that has been used
+ ------------------------------------------------------------------------------
+*/
+void hc12Stats::dump( void )
+{
+    const struct _hc12_cmd_stats *pCmd;
+    const struct _hc12_histogram *pHist;
+    int i;
+
+    fprintf(stderr, "\ndumpStats (us)\n");
+    fprintf(stderr, "--------------\n");
+    // the commands the module does not have share AT+DEFAULT, the code
+    // tells them apart
+    fprintf(stderr, "%4s %-12s %6s %5s %5s %5s %8s %8s %8s %8s\n",
+            "code", "command", "ok", "tmo", "unkn", "fail",
+            "first50", "p50", "p99", "max" );
+
+    for( i = 0; i < HC12_STAT_COMMANDS; i++ )
+    {
+        pCmd = &_stats.cmd[i];
+        if( pCmd->complete.count > 0 )
+        {
+            fprintf(stderr, "%4d %-12s %6u %5u %5u %5u %8u %8u %8u %8u\n",
+                    HC12_STAT_FIRST_CODE + i,
+                    hc12CommandDesc( HC12_STAT_FIRST_CODE + i )->prefix,
+                    pCmd->success, pCmd->timeouts,
+                    pCmd->unknown, pCmd->failed,
+                    percentile( &pCmd->firstByte, 50 ),
+                    percentile( &pCmd->complete, 50 ),
+                    percentile( &pCmd->complete, 99 ),
+                    pCmd->complete.maxUs );
+        }
+    }
+
+    for( i = 0; i < HC12_STAT_MODE_SWITCHES; i++ )
+    {
+        pHist = &_stats.modeSwitch[i];
+        if( pHist->count > 0 )
+        {
+            fprintf(stderr, "%-16s %6u %8u %8u %8u\n",
+                    hc12StatModeNames[i], pHist->count,
+                    percentile( pHist, 50 ), percentile( pHist, 99 ),
+                    pHist->maxUs );
+        }
+    }
+
+    pHist = &_stats.drain.duration;
+    if( pHist->count > 0 )
+    {
+        fprintf(stderr, "%-16s %6u %8u %8u %8u cut %u bytes %llu\n",
+                "drainInput", pHist->count,
+                percentile( pHist, 50 ), percentile( pHist, 99 ),
+                pHist->maxUs, _stats.drain.cut,
+                (unsigned long long) _stats.drain.bytes );
+    }
+}
+#endif // defined(__linux__)
+
+#endif // defined(HC12_WITH_STATS)
@@ -0,0 +1,133 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Stats.h - latency histograms and counters for hc-12 commands
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_STATS_H_
+#define _HC12_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hc12Command.h"
+
+//
+// the histograms need some kB, too much for small controllers.
+// Define HC12_NO_STATS to drop them on other platforms as well.
+//
+#if !defined(ARDUINO) && !defined(HC12_NO_STATS)
+    #define HC12_WITH_STATS
+#endif
+
+// one entry per code of the command table
+#define HC12_STAT_FIRST_CODE       HC12_CMD_CODE_FIRST
+#define HC12_STAT_COMMANDS         (HC12_CMD_CODE_LAST - \
+                                    HC12_CMD_CODE_FIRST + 1)
+
+// bucket n counts durations of 2^n up to 2^(n+1)-1 microseconds,
+// the last one everything above
+#define HC12_STAT_BUCKETS          24
+
+#define HC12_STAT_OK                0
+#define HC12_STAT_TIMEOUT           1
+#define HC12_STAT_UNKNOWN           2
+#define HC12_STAT_FAILED            3
+
+#define HC12_STAT_ENTER_CMD         0
+#define HC12_STAT_LEAVE_CMD         1
+#define HC12_STAT_MODE_SWITCHES     2
+
+struct _hc12_histogram {
+    uint32_t count;
+    uint32_t maxUs;
+    uint64_t sumUs;
+    uint32_t bucket[HC12_STAT_BUCKETS];
+};
+
+struct _hc12_cmd_stats {
+    uint32_t success;
+    uint32_t timeouts;
+    uint32_t unknown;
+    uint32_t failed;
+    struct _hc12_histogram firstByte;     // write start -> first byte
+    struct _hc12_histogram complete;      // write start -> reply complete
+};
+
+struct _hc12_drain_stats {
+    uint32_t cut;                         // ended by deadline or budget
+    uint64_t bytes;                       // dropped in total
+    struct _hc12_histogram duration;
+};
+
+struct _hc12_stats {
+    struct _hc12_cmd_stats cmd[HC12_STAT_COMMANDS];
+    struct _hc12_histogram modeSwitch[HC12_STAT_MODE_SWITCHES];
+    struct _hc12_drain_stats drain;
+};
+
+#if defined(HC12_WITH_STATS)
+
+class hc12Stats {
+
+  protected:
+    struct _hc12_stats _stats;
+
+    void add( struct _hc12_histogram *pHist, uint32_t us );
+
+  public:
+    hc12Stats( void );
+
+    void reset( void );
+
+    static uint32_t now( void );
+    static int bucket( uint32_t us );
+    static uint32_t percentile( const struct _hc12_histogram *pHist,
+                                int percent );
+
+    void command( int code, int result, uint32_t firstUs, uint32_t totalUs );
+    void modeSwitch( int which, uint32_t us );
+    void drain( uint32_t bytes, bool cut, uint32_t us );
+
+    void snapshot( struct _hc12_stats *pStats );
+#if defined(__linux__)
+    void dump( void );
+#endif // defined(__linux__)
+};
+
+#else // NOT defined(HC12_WITH_STATS)
+
+//
+// same interface, nothing recorded
+//
+class hc12Stats {
+
+  public:
+    void reset( void ) {}
+
+    static uint32_t now( void ) { return( 0 ); }
+
+    void command( int, int, uint32_t, uint32_t ) {}
+    void modeSwitch( int, uint32_t ) {}
+    void drain( uint32_t, bool, uint32_t ) {}
+};
+
+#endif // defined(HC12_WITH_STATS)
+
+#endif // _HC12_STATS_H_
@@ -0,0 +1,637 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Transport.cpp - byte pipes between hc12Radio and the module
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Transport.h"
+#include "hc12Radio.h"
+
+#if defined(__linux__)
+    #include <errno.h>
+    #include <poll.h>
+    #include <dirent.h>
+    #include <limits.h>
+    #include <termios.h>
+    #include <sys/ioctl.h>
+#endif // defined(__linux__)
+
+#if defined(__linux__)
+
+/*
+ ------------------------------------------------------------------------------
+ * static int findDeviceFd( const char *pDevice )
+ *
+ * serialConnection does not hand out its file descriptor, so look it up
+ * in /proc/self/fd. If the device is open more than once, the highest
+ * descriptor is taken.
+ * returns the descriptor or -1
+ ------------------------------------------------------------------------------
+*/
+static int findDeviceFd( const char *pDevice )
+{
+    int retVal = -1;
+    char devPath[PATH_MAX];
+    char linkPath[PATH_MAX];
+    char fdPath[sizeof("/proc/self/fd/") + NAME_MAX];
+    DIR *pDir;
+    struct dirent *pEntry;
+    ssize_t len;
+    int fd;
+
+    if( pDevice != NULL && realpath( pDevice, devPath ) != NULL &&
+        (pDir = opendir( "/proc/self/fd" )) != NULL )
+    {
+        while( (pEntry = readdir( pDir )) != NULL )
+        {
+            if( pEntry->d_name[0] >= '0' && pEntry->d_name[0] <= '9' &&
+                (fd = atoi( pEntry->d_name )) > retVal )
+            {
+                snprintf( fdPath, sizeof(fdPath), "/proc/self/fd/%s",
+                          pEntry->d_name );
+                len = readlink( fdPath, linkPath, sizeof(linkPath) - 1 );
+                if( len > 0 )
+                {
+                    linkPath[len] = '\0';
+                    if( strcmp( linkPath, devPath ) == 0 )
+                    {
+                        retVal = fd;
+                    }
+                }
+            }
+        }
+        closedir( pDir );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * static int pollRead( int fd, char *pData, int len, int timeoutMs )
+ *
+ * wait up to timeoutMs for input on fd and read what is there
+ * returns the amount of bytes read or E_READ_TIMEOUT
+ ------------------------------------------------------------------------------
+*/
+static int pollRead( int fd, char *pData, int len, int timeoutMs )
+{
+    int retVal;
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    retVal = ::poll( &pfd, 1, timeoutMs );
+    if( retVal > 0 )
+    {
+        retVal = ::read( fd, pData, len );
+    }
+
+    if( retVal <= 0 )
+    {
+        retVal = E_READ_TIMEOUT;
+    }
+
+    return( retVal );
+}
+
+#endif // defined(__linux__)
+
+/*
+ ***********************************************************************
+ | hc12SerialTransport
+ ***********************************************************************
+*/
+
+#if defined(ARDUINO)
+
+hc12SerialTransport::hc12SerialTransport( HardwareSerial *port )
+{
+    _pConnection = new serialConnection( port );
+    _fd = -1;
+}
+
+hc12SerialTransport::hc12SerialTransport( SoftwareSerial *port )
+{
+    _pConnection = new serialConnection( port );
+    _fd = -1;
+}
+
+#else // NOT on Arduino platform
+
+hc12SerialTransport::hc12SerialTransport( void )
+{
+    _pConnection = new serialConnection();
+    _fd = -1;
+}
+
+#endif // defined(ARDUINO)
+
+hc12SerialTransport::~hc12SerialTransport( void )
+{
+    delete _pConnection;
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12SerialTransport::open( struct _hc12_serial_param *pParam )
+ *
+ * open the port with the settings of pParam
+ * return E_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12SerialTransport::open( struct _hc12_serial_param *pParam )
+{
+    int retVal = E_NULL_CONNECTION;
+
+#if defined(__linux__)
+    retVal = _pConnection->ser_open( pParam->device, pParam->baud,
+                                     pParam->databit, pParam->parity,
+                                     pParam->stopbits, pParam->handshake );
+    if( retVal == E_OK )
+    {
+        _fd = findDeviceFd( pParam->device );
+    }
+#else // NOT defined(__linux__)
+    #if defined(ARDUINO)
+    if( pParam->isHWPort )
+    {
+        retVal = _pConnection->ser_open( pParam->pHPort, pParam->baud,
+                                         pParam->databit, pParam->parity,
+                                         pParam->stopbits );
+    }
+    else
+    {
+        retVal = _pConnection->ser_open( pParam->pSPort, pParam->baud );
+    }
+    #endif // defined(ARDUINO)
+#endif // defined(__linux__)
+
+    return( retVal );
+}
+
+#if defined(__linux__)
+/*
+ ------------------------------------------------------------------------------
+ * int hc12SerialTransport::setBaud( struct _hc12_serial_param *pParam )
+ *
+ * the speed is changed on the descriptor serialConnection opened, so
+ * fd() stays the same. Without a descriptor the port is opened again.
+ * return E_OK on succes, otherwise an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12SerialTransport::setBaud( struct _hc12_serial_param *pParam )
+{
+    int retVal = E_NULL_CONNECTION;
+    struct termios tio;
+    speed_t speed;
+
+    switch( pParam->baud )
+    {
+        case HC12_BAUD_1200:   speed = B1200;   break;
+        case HC12_BAUD_2400:   speed = B2400;   break;
+        case HC12_BAUD_4800:   speed = B4800;   break;
+        case HC12_BAUD_9600:   speed = B9600;   break;
+        case HC12_BAUD_19200:  speed = B19200;  break;
+        case HC12_BAUD_38400:  speed = B38400;  break;
+        case HC12_BAUD_57600:  speed = B57600;  break;
+        case HC12_BAUD_115200: speed = B115200; break;
+        default:               speed = B0;      break;
+    }
+
+    if( _fd < 0 )
+    {
+        close();
+        retVal = open( pParam );
+    }
+    else if( speed != B0 && tcgetattr( _fd, &tio ) == 0 &&
+             cfsetispeed( &tio, speed ) == 0 &&
+             cfsetospeed( &tio, speed ) == 0 &&
+             tcsetattr( _fd, TCSADRAIN, &tio ) == 0 )
+    {
+        retVal = E_OK;
+    }
+
+    return( retVal );
+}
+#endif // defined(__linux__)
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12SerialTransport::close( void )
+ ------------------------------------------------------------------------------
+*/
+int hc12SerialTransport::close( void )
+{
+    _fd = -1;
+
+    return( _pConnection->ser_close() );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12SerialTransport::write( const char *pData, int len )
+ ------------------------------------------------------------------------------
+*/
+int hc12SerialTransport::write( const char *pData, int len )
+{
+    return( _pConnection->ser_write( (char*) pData, len ) );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12SerialTransport::read( char *pData, int len, int timeoutMs )
+ *
+ * with a descriptor the wait is a poll() on it, otherwise the
+ * timeout of serialConnection applies
+ ------------------------------------------------------------------------------
+*/
+int hc12SerialTransport::read( char *pData, int len, int timeoutMs )
+{
+    int retVal;
+
+#if defined(__linux__)
+    if( _fd >= 0 )
+    {
+        retVal = pollRead( _fd, pData, len, timeoutMs );
+    }
+    else
+#endif // defined(__linux__)
+    {
+        retVal = _pConnection->readBuffer( pData, len );
+        if( retVal == E_BUFSPACE )
+        {
+            retVal = len;
+        }
+    }
+
+    return( retVal );
+}
+
+#if defined(__linux__)
+
+/*
+ ***********************************************************************
+ | hc12TtyTransport
+ ***********************************************************************
+*/
+
+hc12TtyTransport::hc12TtyTransport( void )
+{
+    _fd = -1;
+    memset( &_info, '\0', sizeof(_info) );
+    _info.latencyTimer = -1;
+}
+
+hc12TtyTransport::~hc12TtyTransport( void )
+{
+    close();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12TtyTransport::open( struct _hc12_serial_param *pParam )
+ *
+ * open the port exclusively and set it up, see hc12TtyConfigure()
+ * return E_OK on succes, otherwise E_NULL_CONNECTION
+ ------------------------------------------------------------------------------
+*/
+int hc12TtyTransport::open( struct _hc12_serial_param *pParam )
+{
+    int retVal = E_NULL_CONNECTION;
+
+    close();
+
+    if( pParam->device != NULL &&
+        (_fd = ::open( pParam->device,
+                       O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC )) >= 0 )
+    {
+        if( ioctl( _fd, TIOCEXCL ) == 0 &&
+            hc12TtyConfigure( _fd, pParam->baud, pParam->databit,
+                              pParam->parity, pParam->stopbits,
+                              pParam->handshake, &_info ) == HC12_TTY_OK )
+        {
+            _info.latencyTimer = hc12TtyLatencyTimer( pParam->device,
+                                                      HC12_TTY_LATENCY_MS );
+            retVal = E_OK;
+        }
+        else
+        {
+            close();
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12TtyTransport::setBaud( struct _hc12_serial_param *pParam )
+ *
+ * set up the open descriptor again with the new rate
+ * return E_OK on succes, otherwise E_NULL_CONNECTION
+ ------------------------------------------------------------------------------
+*/
+int hc12TtyTransport::setBaud( struct _hc12_serial_param *pParam )
+{
+    int retVal = E_NULL_CONNECTION;
+
+    if( _fd >= 0 &&
+        hc12TtyConfigure( _fd, pParam->baud, pParam->databit,
+                          pParam->parity, pParam->stopbits,
+                          pParam->handshake, &_info ) == HC12_TTY_OK )
+    {
+        retVal = E_OK;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12TtyTransport::close( void )
+ ------------------------------------------------------------------------------
+*/
+int hc12TtyTransport::close( void )
+{
+    if( _fd >= 0 )
+    {
+        ioctl( _fd, TIOCNXCL );
+        ::close( _fd );
+        _fd = -1;
+    }
+
+    return( E_OK );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12TtyTransport::write( const char *pData, int len )
+ *
+ * returns the amount of bytes taken, 0 if the driver's buffer is full
+ ------------------------------------------------------------------------------
+*/
+int hc12TtyTransport::write( const char *pData, int len )
+{
+    int retVal = E_NULL_CONNECTION;
+
+    if( _fd >= 0 && (retVal = ::write( _fd, pData, len )) < 0 )
+    {
+        retVal = errno == EAGAIN ? 0 : E_NULL_CONNECTION;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12TtyTransport::read( char *pData, int len, int timeoutMs )
+ *
+ * while data is streaming in the read alone does the job, poll() is
+ * only needed to wait for the first byte
+ ------------------------------------------------------------------------------
+*/
+int hc12TtyTransport::read( char *pData, int len, int timeoutMs )
+{
+    int retVal = E_NULL_CONNECTION;
+
+    if( _fd >= 0 )
+    {
+        if( (retVal = ::read( _fd, pData, len )) <= 0 )
+        {
+            retVal = timeoutMs > 0 ? pollRead( _fd, pData, len, timeoutMs ) :
+                                     E_READ_TIMEOUT;
+        }
+    }
+
+    return( retVal );
+}
+
+/*
+ ***********************************************************************
+ | hc12PtyTransport
+ ***********************************************************************
+*/
+
+hc12PtyTransport::hc12PtyTransport( bool createPair )
+{
+    _createPair = createPair;
+    _fd = -1;
+    _peerName[0] = '\0';
+}
+
+hc12PtyTransport::~hc12PtyTransport( void )
+{
+    close();
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12PtyTransport::open( struct _hc12_serial_param *pParam )
+ *
+ * open pParam->device resp. a new master, both raw and non-blocking
+ * return E_OK on succes, otherwise E_NULL_CONNECTION
+ ------------------------------------------------------------------------------
+*/
+int hc12PtyTransport::open( struct _hc12_serial_param *pParam )
+{
+    int retVal = E_NULL_CONNECTION;
+    struct termios tio;
+    char *pName;
+
+    close();
+
+    if( _createPair )
+    {
+        if( (_fd = posix_openpt( O_RDWR | O_NOCTTY | O_NONBLOCK )) >= 0 &&
+            (grantpt( _fd ) != 0 || unlockpt( _fd ) != 0 ||
+             (pName = ptsname( _fd )) == NULL) )
+        {
+            ::close( _fd );
+            _fd = -1;
+        }
+        else if( _fd >= 0 )
+        {
+            snprintf( _peerName, sizeof(_peerName), "%s", pName );
+        }
+    }
+    else if( pParam->device != NULL )
+    {
+        _fd = ::open( pParam->device, O_RDWR | O_NOCTTY | O_NONBLOCK );
+    }
+
+    if( _fd >= 0 && tcgetattr( _fd, &tio ) == 0 )
+    {
+        cfmakeraw( &tio );
+        tcsetattr( _fd, TCSANOW, &tio );
+        retVal = E_OK;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12PtyTransport::close( void )
+ ------------------------------------------------------------------------------
+*/
+int hc12PtyTransport::close( void )
+{
+    if( _fd >= 0 )
+    {
+        ::close( _fd );
+        _fd = -1;
+    }
+    _peerName[0] = '\0';
+
+    return( E_OK );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12PtyTransport::write( const char *pData, int len )
+ *
+ * returns the amount of bytes taken, 0 if the pty is full
+ ------------------------------------------------------------------------------
+*/
+int hc12PtyTransport::write( const char *pData, int len )
+{
+    int retVal = E_NULL_CONNECTION;
+
+    if( _fd >= 0 && (retVal = ::write( _fd, pData, len )) < 0 )
+    {
+        retVal = errno == EAGAIN ? 0 : E_NULL_CONNECTION;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12PtyTransport::read( char *pData, int len, int timeoutMs )
+ ------------------------------------------------------------------------------
+*/
+int hc12PtyTransport::read( char *pData, int len, int timeoutMs )
+{
+    return( _fd >= 0 ? pollRead( _fd, pData, len, timeoutMs ) :
+                       E_NULL_CONNECTION );
+}
+
+/*
+ ***********************************************************************
+ | hc12LoopbackEnd / hc12Loopback
+ ***********************************************************************
+*/
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12LoopbackEnd::open( struct _hc12_serial_param * )
+ *
+ * the settings do not matter, the rings have to be there
+ ------------------------------------------------------------------------------
+*/
+int hc12LoopbackEnd::open( struct _hc12_serial_param * )
+{
+    return( _pRx->isOpen() && _pTx->isOpen() ? E_OK : E_NULL_CONNECTION );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12LoopbackEnd::write( const char *pData, int len )
+ *
+ * copy into the peer's ring, in two pieces if it wraps around
+ * returns the amount of bytes taken, less than len if the ring is full
+ ------------------------------------------------------------------------------
+*/
+int hc12LoopbackEnd::write( const char *pData, int len )
+{
+    int retVal = 0;
+    uint64_t stamp = hc12SpscRing::now();
+    uint8_t *pDst;
+    size_t space;
+
+    while( retVal < len && (space = _pTx->reserve( &pDst )) > 0 )
+    {
+        if( space > (size_t) (len - retVal) )
+        {
+            space = len - retVal;
+        }
+
+        memcpy( pDst, &pData[retVal], space );
+        _pTx->commit( space, stamp );
+        retVal += space;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12LoopbackEnd::read( char *pData, int len, int timeoutMs )
+ ------------------------------------------------------------------------------
+*/
+int hc12LoopbackEnd::read( char *pData, int len, int timeoutMs )
+{
+    int retVal = E_READ_TIMEOUT;
+
+    if( _pRx->waitData( timeoutMs ) )
+    {
+        retVal = (int) _pRx->read( pData, len, NULL );
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12Loopback::open( void )
+ *
+ * allocate the rings, both ends work afterwards
+ * returns 0 on success, otherwise -1
+ ------------------------------------------------------------------------------
+*/
+int hc12Loopback::open( void )
+{
+    int retVal = 0;
+
+    if( _ab.open() != 0 || _ba.open() != 0 )
+    {
+        close();
+        retVal = -1;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * void hc12Loopback::close( void )
+ *
+ * only while neither end is in use
+ ------------------------------------------------------------------------------
+*/
+void hc12Loopback::close( void )
+{
+    _ab.close();
+    _ba.close();
+}
+
+#endif // defined(__linux__)
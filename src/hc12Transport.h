@@ -0,0 +1,229 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Transport.h - byte pipes between hc12Radio and the module
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_TRANSPORT_H_
+#define _HC12_TRANSPORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "serialConnection.h"
+
+#if defined(ARDUINO)
+    #if ARDUINO > 22
+        #include "Arduino.h"
+    #else
+        #include "WProgram.h"
+    #endif
+
+    #include "SoftwareSerial.h"
+#endif // defined(ARDUINO)
+
+#if defined(__linux__)
+    #include "hc12SpscRing.h"
+    #include "hc12Tty.h"
+#endif // defined(__linux__)
+
+// see hc12Radio.h
+struct _hc12_serial_param;
+
+//
+// Everything hc12Radio needs from the line to the module. Results use
+// the E_* codes of serialConnection:
+//
+//   open()   E_OK or an error code, the settings come from connect()
+//   write()  bytes taken, may be less than len
+//   read()   bytes stored (len if the buffer was filled), E_READ_TIMEOUT
+//            if nothing arrived within timeoutMs
+//   fd()     descriptor to poll for input, -1 if there is none. The
+//            reactor and the background reader need one.
+//   setBaud() switch the open line to pParam->baud, after the module
+//            changed its rate. By default the line is opened again,
+//            which may change fd().
+//
+// A transport is handed to the hc12Radio constructor. Radios create
+// their own hc12SerialTransport if none is given.
+//
+class hc12Transport {
+
+  public:
+    virtual ~hc12Transport( void ) {}
+
+    virtual int open( struct _hc12_serial_param *pParam ) = 0;
+    virtual int close( void ) = 0;
+    virtual int write( const char *pData, int len ) = 0;
+    virtual int read( char *pData, int len, int timeoutMs ) = 0;
+    virtual int fd( void ) { return( -1 ); }
+    virtual int setBaud( struct _hc12_serial_param *pParam )
+                                      { close(); return( open( pParam ) ); }
+};
+
+//
+// the serialConnection library, a tty on Linux, HardwareSerial or
+// SoftwareSerial on the Arduino
+//
+class hc12SerialTransport : public hc12Transport {
+
+  protected:
+    serialConnection *_pConnection;
+    int               _fd;
+
+  public:
+#if defined(ARDUINO)
+    hc12SerialTransport( HardwareSerial *port );
+    hc12SerialTransport( SoftwareSerial *port );
+#else // NOT on Arduino platform
+    hc12SerialTransport( void );
+#endif // defined(ARDUINO)
+    ~hc12SerialTransport( void );
+
+    int open( struct _hc12_serial_param *pParam );
+    int close( void );
+    int write( const char *pData, int len );
+    int read( char *pData, int len, int timeoutMs );
+    int fd( void ) { return( _fd ); }
+#if defined(__linux__)
+    int setBaud( struct _hc12_serial_param *pParam );
+#endif // defined(__linux__)
+};
+
+#if defined(__linux__)
+//
+// A serial port driven by the library itself instead of serialConnection:
+// raw mode with the exact rate through termios2, ASYNC_LOW_LATENCY and
+// a 1 ms latency timer on USB adapters where the driver and sysfs allow
+// it. The descriptor is non-blocking; read() tries the descriptor first
+// and only polls if nothing is there, write() takes what fits into the
+// driver's buffer. There is no buffer of its own, the caller's one is
+// filled, so the descriptor stays usable for the reactor and the
+// reader thread.
+//
+class hc12TtyTransport : public hc12Transport {
+
+  protected:
+    int  _fd;
+    struct _hc12_tty_info _info;
+
+  public:
+    hc12TtyTransport( void );
+    ~hc12TtyTransport( void );
+
+    int open( struct _hc12_serial_param *pParam );
+    int close( void );
+    int write( const char *pData, int len );
+    int read( char *pData, int len, int timeoutMs );
+    int fd( void ) { return( _fd ); }
+    int setBaud( struct _hc12_serial_param *pParam );
+
+    // valid after open()
+    const struct _hc12_tty_info* info( void ) { return( &_info ); }
+};
+
+//
+// a pseudo terminal in raw mode, the baud rate is of no interest. By
+// default the device of connect() is opened, e.g. the link of
+// hc12Emulator. With createPair the transport makes a new pty on
+// open() and the other side attaches to peerName().
+//
+class hc12PtyTransport : public hc12Transport {
+
+  protected:
+    bool  _createPair;
+    int   _fd;
+    char  _peerName[64];
+
+  public:
+    hc12PtyTransport( bool createPair = false );
+    ~hc12PtyTransport( void );
+
+    int open( struct _hc12_serial_param *pParam );
+    int close( void );
+    int write( const char *pData, int len );
+    int read( char *pData, int len, int timeoutMs );
+    int fd( void ) { return( _fd ); }
+    int setBaud( struct _hc12_serial_param * ) { return( E_OK ); }
+
+    // slave side of a created pair, empty before open()
+    const char* peerName( void ) { return( _peerName ); }
+};
+
+//
+// One end of an hc12Loopback. What is written to one end is read from
+// the other, through an hc12SpscRing per direction, without a syscall
+// while data is flowing. Each end may be driven by a thread of its own.
+//
+// read() and write() copy as any transport does. Code on the far end
+// of a radio, an emulated module or a protocol layer under test, can
+// use the rings directly instead: reserve()/commit() to produce into
+// the peer's input and peek()/consume() to parse its output in place.
+//
+// There is no descriptor, so neither the reactor nor the background
+// reader of hc12Radio work on a loopback.
+//
+class hc12LoopbackEnd : public hc12Transport {
+
+  protected:
+    hc12SpscRing *_pRx;
+    hc12SpscRing *_pTx;
+
+  public:
+    hc12LoopbackEnd( hc12SpscRing *pRx, hc12SpscRing *pTx )
+                                           : _pRx( pRx ), _pTx( pTx ) {}
+
+    int open( struct _hc12_serial_param *pParam );
+    int close( void ) { return( E_OK ); }
+    int write( const char *pData, int len );
+    int read( char *pData, int len, int timeoutMs );
+    int setBaud( struct _hc12_serial_param * ) { return( E_OK ); }
+
+// zero copy, see hc12SpscRing
+    size_t reserve( uint8_t **ppData ) { return( _pTx->reserve( ppData ) ); }
+    void   commit( size_t len )
+                      { _pTx->commit( len, hc12SpscRing::now() ); }
+    size_t peek( const uint8_t **ppData ) { return( _pRx->peek( ppData ) ); }
+    void   consume( size_t len ) { _pRx->consume( len ); }
+    bool   waitData( int timeoutMs ) { return( _pRx->waitData( timeoutMs ) ); }
+};
+
+//
+// the two ends and the rings between them, open() before use
+//
+class hc12Loopback {
+
+  protected:
+    hc12SpscRing    _ab;
+    hc12SpscRing    _ba;
+    hc12LoopbackEnd _a;
+    hc12LoopbackEnd _b;
+
+  public:
+    hc12Loopback( void ) : _a( &_ba, &_ab ), _b( &_ab, &_ba ) {}
+
+    int open( void );
+    void close( void );
+
+    hc12LoopbackEnd* a( void ) { return( &_a ); }
+    hc12LoopbackEnd* b( void ) { return( &_b ); }
+};
+#endif // defined(__linux__)
+
+#endif // _HC12_TRANSPORT_H_
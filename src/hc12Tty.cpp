@@ -0,0 +1,216 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Tty.cpp - low latency setup of Linux serial ports
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#include "hc12Tty.h"
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include <linux/serial.h>
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12TtyConfigure( int fd, uint32_t baud, int databits, int parity,
+ *                       int stopbits, int handshake,
+ *                       struct _hc12_tty_info *pInfo )
+ *
+ * set up the line, ask the driver for low latency and read back what
+ * it made of the rate. pInfo may be NULL.
+ * returns HC12_TTY_OK or an error code
+ ------------------------------------------------------------------------------
+*/
+int hc12TtyConfigure( int fd, uint32_t baud, int databits, int parity,
+                      int stopbits, int handshake,
+                      struct _hc12_tty_info *pInfo )
+{
+    int retVal = HC12_TTY_OK;
+    struct termios2 tio;
+    struct serial_struct serial;
+    uint32_t diff;
+
+    if( pInfo != NULL )
+    {
+        pInfo->baud = 0;
+        pInfo->lowLatency = false;
+    }
+
+    if( baud == 0 || databits < 5 || databits > 8 )
+    {
+        return( HC12_TTY_ERR_ARGS );
+    }
+
+    if( ioctl( fd, TCGETS2, &tio ) != 0 )
+    {
+        return( HC12_TTY_ERR_ATTR );
+    }
+
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_cflag = CREAD | CLOCAL | BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ispeed = tio.c_ospeed = baud;
+
+    switch( databits )
+    {
+        case 5:
+            tio.c_cflag |= CS5;
+            break;
+        case 6:
+            tio.c_cflag |= CS6;
+            break;
+        case 7:
+            tio.c_cflag |= CS7;
+            break;
+        default:
+            tio.c_cflag |= CS8;
+            break;
+    }
+
+    switch( parity )
+    {
+        case 'O':
+        case 'o':
+            tio.c_cflag |= PARENB | PARODD;
+            break;
+        case 'E':
+        case 'e':
+            tio.c_cflag |= PARENB;
+            break;
+    }
+
+    // 2 and 1.5, the UART picks 1.5 with five data bits
+    if( stopbits > 1 )
+    {
+        tio.c_cflag |= CSTOPB;
+    }
+
+    switch( handshake )
+    {
+        case 'H':
+        case 'h':
+            tio.c_cflag |= CRTSCTS;
+            break;
+        case 'S':
+        case 's':
+        case 'X':
+        case 'x':
+            tio.c_iflag |= IXON | IXOFF;
+            break;
+    }
+
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+
+    if( ioctl( fd, TCSETS2, &tio ) != 0 || ioctl( fd, TCGETS2, &tio ) != 0 )
+    {
+        return( HC12_TTY_ERR_ATTR );
+    }
+
+    diff = tio.c_ospeed > baud ? tio.c_ospeed - baud : baud - tio.c_ospeed;
+    if( (uint64_t) diff * 100 > (uint64_t) baud * HC12_TTY_BAUD_TOLERANCE )
+    {
+        retVal = HC12_TTY_ERR_BAUD;
+    }
+
+    // serial drivers without the flag (ptys, CDC ACM) simply refuse it
+    if( ioctl( fd, TIOCGSERIAL, &serial ) == 0 )
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if( ioctl( fd, TIOCSSERIAL, &serial ) == 0 && pInfo != NULL )
+        {
+            pInfo->lowLatency = true;
+        }
+    }
+
+    // bytes of an earlier session are of no interest
+    ioctl( fd, TCFLSH, TCIOFLUSH );
+
+    if( pInfo != NULL )
+    {
+        pInfo->baud = tio.c_ospeed;
+    }
+
+    return( retVal );
+}
+
+/*
+ ------------------------------------------------------------------------------
+ * int hc12TtyLatencyTimer( const char *pDevice, int ms )
+ *
+ * USB serial adapters like the FTDI ones send what they received after
+ * 16 ms by default, which makes up most of a command round trip. Set
+ * the timer of the usb-serial driver to ms (needs write access to
+ * sysfs, usually root or a udev rule).
+ * returns the timer in effect afterwards, -1 if the device has none
+ ------------------------------------------------------------------------------
+*/
+int hc12TtyLatencyTimer( const char *pDevice, int ms )
+{
+    int retVal = -1;
+    char devPath[PATH_MAX];
+    char sysPath[sizeof("/sys/bus/usb-serial/devices/") + NAME_MAX +
+                 sizeof("/latency_timer")];
+    char value[16];
+    const char *pName;
+    ssize_t len;
+    int fd;
+
+    if( pDevice != NULL && realpath( pDevice, devPath ) != NULL )
+    {
+        pName = strrchr( devPath, '/' );
+        pName = pName != NULL ? pName + 1 : devPath;
+
+        // a name that does not fit is no usb-serial device
+        if( snprintf( sysPath, sizeof(sysPath),
+                      "/sys/bus/usb-serial/devices/%s/latency_timer",
+                      pName ) < (int) sizeof(sysPath) &&
+            ((fd = open( sysPath, O_RDWR | O_CLOEXEC )) >= 0 ||
+             (fd = open( sysPath, O_RDONLY | O_CLOEXEC )) >= 0) )
+        {
+            len = snprintf( value, sizeof(value), "%d", ms );
+            if( write( fd, value, len ) < 0 )
+            {
+                ; // read only, report what is set
+            }
+
+            if( lseek( fd, 0, SEEK_SET ) == 0 &&
+                (len = read( fd, value, sizeof(value) - 1 )) > 0 )
+            {
+                value[len] = '\0';
+                retVal = atoi( value );
+            }
+
+            close( fd );
+        }
+    }
+
+    return( retVal );
+}
+
+#endif // defined(__linux__)
@@ -0,0 +1,71 @@
+/*
+ ***********************************************************************
+ *
+ *  hc12Tty.h - low latency setup of Linux serial ports
+ *
+ *  Copyright (C) 2018 Dreamshader (aka Dirk Schanz)
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***********************************************************************
+ */
+
+#ifndef _HC12_TTY_H_
+#define _HC12_TTY_H_
+
+#if defined(__linux__)
+
+#include <stdint.h>
+
+//
+// termios2 from <asm/termbits.h> cannot live together with the
+// <termios.h> the rest of the library includes, so this unit only
+// deals with descriptors and plain numbers.
+//
+
+#define HC12_TTY_OK                 0
+#define HC12_TTY_ERR_ATTR          -1    // TCGETS2/TCSETS2 failed
+#define HC12_TTY_ERR_BAUD          -2    // driver is off by more than below
+#define HC12_TTY_ERR_ARGS          -3
+
+// the UART may miss the requested rate by this many percent
+#define HC12_TTY_BAUD_TOLERANCE     2
+// usb-serial latency timer set by hc12TtyLatencyTimer(), ms
+#define HC12_TTY_LATENCY_MS         1
+
+// what the setup got from the driver
+struct _hc12_tty_info {
+    uint32_t baud;                        // rate really in use
+    bool     lowLatency;                  // ASYNC_LOW_LATENCY accepted
+    int      latencyTimer;                // ms, -1 if the device has none
+};
+
+//
+// raw 8 bit clean line with the exact rate through BOTHER.
+// parity and handshake take the letters of HC12_PARITY_* resp.
+// HC12_HANDSHAKE_* ('X' counts as software handshake as well).
+// VMIN and VTIME are 0: the descriptor is non-blocking and a read
+// returns at once with all the driver has, the waiting is done by
+// poll()/epoll, which wakes up with the first byte.
+//
+int hc12TtyConfigure( int fd, uint32_t baud, int databits, int parity,
+                      int stopbits, int handshake,
+                      struct _hc12_tty_info *pInfo );
+
+// ms the usb-serial driver of pDevice collects data before it hands
+// it over (FTDI latency_timer), -1 if there is no such timer
+int hc12TtyLatencyTimer( const char *pDevice, int ms );
+
+#endif // defined(__linux__)
+
+#endif // _HC12_TTY_H_